@@ -18,9 +18,11 @@
 #include <time.h>
 #include <unistd.h>
 #include <sys/types.h>
+#include <pthread.h>
 
 #define BCK2835_LIBRARY_BUILD
 #include "bcm2835.h"
+#include "bcm2835sim.h"
 
 /* This define enables a little test program (by default a blinking output on pin RPI_GPIO_PIN_11)
 // You can do some safe, non-destructive testing on any platform with:
@@ -119,6 +121,7 @@ uint32_t bcm2835_peri_read(volatile uint32_t* paddr)
     }
     else
     {
+       BCM2835_SIM_READ(paddr);
        __sync_synchronize();
        ret = *paddr;
        __sync_synchronize();
@@ -141,6 +144,7 @@ uint32_t bcm2835_peri_read_nb(volatile uint32_t* paddr)
     }
     else
     {
+	BCM2835_SIM_READ(paddr);
 	return *paddr;
     }
 }
@@ -159,6 +163,7 @@ void bcm2835_peri_write(volatile uint32_t* paddr, uint32_t value)
         __sync_synchronize();
         *paddr = value;
         __sync_synchronize();
+        BCM2835_SIM_WRITE(paddr);
     }
 }
 
@@ -173,9 +178,28 @@ void bcm2835_peri_write_nb(volatile uint32_t* paddr, uint32_t value)
     else
     {
 	*paddr = value;
+	BCM2835_SIM_WRITE(paddr);
     }
 }
 
+/* Burst of accesses to one peripheral: a single barrier before the first
+// and after the last access, bcm2835_burst_read() / bcm2835_burst_write()
+// in between go without.
+*/
+void bcm2835_burst_begin(void)
+{
+    if (debug)
+	printf("bcm2835_burst_begin\n");
+    __sync_synchronize();
+}
+
+void bcm2835_burst_end(void)
+{
+    if (debug)
+	printf("bcm2835_burst_end\n");
+    __sync_synchronize();
+}
+
 /* Set/clear only the bits in value covered by the mask
  * This is not atomic - can be interrupted.
  */
@@ -1309,8 +1333,46 @@ static void unmapmem(void **pmem, size_t size)
     *pmem = MAP_FAILED;
 }
 
+/* The mapping is shared by all users in the process (several sensor sessions, threads, or an
+// application using this library itself next to libsht): the peripherals are mapped by the
+// first bcm2835_init() and unmapped by the bcm2835_close() matching it.
+*/
+static pthread_mutex_t bcm2835_lock = PTHREAD_MUTEX_INITIALIZER;
+static unsigned int bcm2835_users;
+
+static int bcm2835_map(void);
+static int bcm2835_unmap(void);
+
 /* Initialise this library. */
 int bcm2835_init(void)
+{
+    int ok = 1;
+
+    pthread_mutex_lock(&bcm2835_lock);
+    if (bcm2835_users == 0)
+        ok = bcm2835_map();
+    if (ok)
+        bcm2835_users++;
+    pthread_mutex_unlock(&bcm2835_lock);
+    return ok;
+}
+
+/* Close this library, the last user deallocates everything */
+int bcm2835_close(void)
+{
+    int ok = 1;
+
+    pthread_mutex_lock(&bcm2835_lock);
+    if (bcm2835_users == 1)
+        ok = bcm2835_unmap();
+    if (ok && bcm2835_users)
+        bcm2835_users--;
+    pthread_mutex_unlock(&bcm2835_lock);
+    return ok;
+}
+
+/* Map the peripherals, lock held */
+static int bcm2835_map(void)
 {
     int  memfd;
     int  ok;
@@ -1331,6 +1393,25 @@ int bcm2835_init(void)
 	return 1; /* Success */
     }
 
+#ifdef BCM2835_SIM
+    /* Simulation: the peripherals block is plain memory, see bcm2835sim.c.
+    // The GPIO pins and the BSC1 controller are modelled, BSC0 is only memory.
+    */
+    bcm2835_peripherals = mmap(NULL, bcm2835_peripherals_size, PROT_READ|PROT_WRITE,
+                               MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+    if (bcm2835_peripherals == MAP_FAILED)
+        return 0;
+    bcm2835_pads = bcm2835_peripherals + BCM2835_GPIO_PADS/4;
+    bcm2835_clk  = bcm2835_peripherals + BCM2835_CLOCK_BASE/4;
+    bcm2835_gpio = bcm2835_peripherals + BCM2835_GPIO_BASE/4;
+    bcm2835_pwm  = bcm2835_peripherals + BCM2835_GPIO_PWM/4;
+    bcm2835_spi0 = bcm2835_peripherals + BCM2835_SPI0_BASE/4;
+    bcm2835_bsc0 = bcm2835_peripherals + BCM2835_BSC0_BASE/4;
+    bcm2835_bsc1 = bcm2835_peripherals + BCM2835_BSC1_BASE/4;
+    bcm2835_st   = bcm2835_peripherals + BCM2835_ST_BASE/4;
+    return 1; /* Success */
+#endif
+
     /* Figure out the base and size of the peripheral address block
     // using the device-tree. Required for RPi2, optional for RPi 1
     */
@@ -1407,13 +1488,13 @@ exit:
         close(memfd);
 
     if (!ok)
-	bcm2835_close();
+	bcm2835_unmap();
 
     return ok;
 }
 
-/* Close this library and deallocate everything */
-int bcm2835_close(void)
+/* Deallocate everything, lock held */
+static int bcm2835_unmap(void)
 {
     if (debug) return 1; /* Success */
 
@@ -481,6 +481,10 @@
 
 #include <stdint.h>
 
+#ifdef BCM2835_SIM
+#include "bcm2835sim.h"
+#endif
+
 #define BCM2835_VERSION 10052 /* Version 1.52 */
 
 /* RPi 2 is ARM v7, and has DMB instruction for memory barriers.
@@ -1064,11 +1068,14 @@ extern "C" {
       If bcm2835_init() succeeds but you are not running as root, then only gpio operations
       are permitted, and calling any other functions may result in crashes or other failures. .
       Prints messages to stderr in case of errors.
+      Calls are counted and may come from several threads: the registers are mapped by the first
+      call and stay mapped until the matching number of bcm2835_close() calls.
       \return 1 if successful else 0
     */
     extern int bcm2835_init(void);
 
     /*! Close the library, deallocating any allocated memory and closing /dev/mem
+      with the last of the users counted by bcm2835_init()
       \return 1 if successful else 0
     */
     extern int bcm2835_close(void);
@@ -1167,6 +1174,48 @@ extern "C" {
       \sa Physical Addresses
     */
     extern void bcm2835_peri_set_bits(volatile uint32_t* paddr, uint32_t value, uint32_t mask);
+
+    /*! Starts a burst of accesses to a single peripheral (e.g. the GPIO block).
+      Issues the one memory barrier needed before the first access, so that any in-flight access
+      to another peripheral completes. Within the burst, use bcm2835_burst_read() and
+      bcm2835_burst_write(), which have no barriers and no debug check, and end it with
+      bcm2835_burst_end() before touching another peripheral.
+      Not for debug mode, the accesses go straight to the mapped registers.
+      \sa bcm2835_burst_end()
+    */
+    extern void bcm2835_burst_begin(void);
+
+    /*! Ends a burst of accesses started by bcm2835_burst_begin()
+      Issues the memory barrier after the last access, so that accesses to another peripheral
+      see the effect of the burst.
+    */
+    extern void bcm2835_burst_end(void);
+
+    /*! Reads 32 bit value from a peripheral address within a burst, without barriers
+      \param[in] paddr Physical address to read from. See BCM2835_GPIO_BASE etc.
+      \return the value read from the 32 bit register
+      \sa bcm2835_burst_begin()
+    */
+    static inline uint32_t bcm2835_burst_read(volatile uint32_t* paddr)
+    {
+#ifdef BCM2835_SIM
+        SIM_Sync();
+#endif
+        return *paddr;
+    }
+
+    /*! Writes 32 bit value to a peripheral address within a burst, without barriers
+      \param[in] paddr Physical address to write to. See BCM2835_GPIO_BASE etc.
+      \param[in] value The 32 bit value to write
+      \sa bcm2835_burst_begin()
+    */
+    static inline void bcm2835_burst_write(volatile uint32_t* paddr, uint32_t value)
+    {
+        *paddr = value;
+#ifdef BCM2835_SIM
+        SIM_Sync();
+#endif
+    }
     /*! @}    end of lowlevel */
 
     /*! \defgroup gpio GPIO register access
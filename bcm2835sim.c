@@ -0,0 +1,773 @@
+//--------------------------------------------------------------------------------------------------
+//
+// Filename:    bcm2835sim.c
+// Description: Simulated BCM2835 peripheral block with SHT21 device models
+//              The GPIO registers live in plain memory (mapped by bcm2835_init() when built with
+//              -DBCM2835_SIM). After every register access SIM_Sync() resolves the open drain
+//              lines from GPFSEL, the output latches and the devices pulling them low, and steps
+//              the device models on each START, STOP and clock edge. A model acknowledges its
+//              address, stretches the clock in hold master mode, refuses to be read while
+//              converting in no hold master mode and returns CRC protected data, just like the
+//              sensor. The results are stored back to GPLEV.
+//              The BSC1 controller (GPIO 2 / 3) is modelled at register level: writes to its FIFO
+//              fill the transmit FIFO, a write of C_ST runs the whole transfer at once on the
+//              device models (without taking any time) and leaves the bytes read in the receive
+//              FIFO, each read of the FIFO register takes one out. DONE, ERR (no acknowledge)
+//              and CLKT (clock held low by a device) are reported in the status register. A
+//              repeated start of bcm2835_i2c_write_read_rs() becomes STOP and START, which the
+//              SHT21 does not mind.
+//
+// Open Source Licensing 
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// Author:      agent
+// History:     17.10.2026 Initial version
+//              17.10.2026 Conversion time depends on the resolution
+//              17.10.2026 BSC1 controller model
+//--------------------------------------------------------------------------------------------------
+
+//=== Includes =====================================================================================
+
+#include <stdint.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/mman.h>
+#include "bcm2835.h"
+#include "bcm2835sim.h"
+
+//=== Preprocessing directives (#define) ===========================================================
+
+#define SIM_NPINS	54
+
+#define SIM_BSC_SDA	2		// pins of BSC1 (ALT0)
+#define SIM_BSC_SCL	3
+#define SIM_BSC_FIFO	16		// depth of the BSC FIFOs
+
+#define SIM_ADDR	0x40		// I2C address of the SHT21
+#define SIM_USER_REG	0x02		// user register after reset
+
+// Raw values after power up: 23.4C / 46.0%RH
+#define SIM_RAW_TMP	0x6668
+#define SIM_RAW_HUM	0x6A94		// status bit added by the model
+
+//=== Type definitions (typedef) ===================================================================
+
+enum
+{
+   ST_IDLE,		// waiting for START
+   ST_RX,		// receiving a byte
+   ST_RX_ACK,		// acknowledging a received byte
+   ST_TX,		// sending a byte
+   ST_TX_ACK,		// waiting for the acknowledge of the master
+   ST_STRETCH		// holding the clock low until the measurement is done
+};
+
+typedef struct
+{
+   uint8_t scl;			// pins the device is connected to
+   uint8_t sda;
+   uint8_t scl_low;		// lines pulled low by the device
+   uint8_t sda_low;
+   uint8_t scl_lev;		// line levels last seen by the device
+   uint8_t sda_lev;
+   uint8_t state;		// ST_xxx
+   uint8_t bits;		// bits of the current byte transferred
+   uint8_t shift;		// byte being received
+   uint8_t nrx;			// bytes received since START, address included
+   uint8_t read;		// addressed for reading
+   uint8_t acked;		// master acknowledged the last byte
+   uint8_t cmd;			// last command
+   uint8_t user_reg;
+   uint8_t tx[3];		// data to send
+   uint8_t txpos;
+   uint16_t raw_t;		// raw measurement results
+   uint16_t raw_h;
+   uint64_t ready_at;		// time the measurement is done (in us)
+} SIM_Dev;
+
+//=== Global constants =============================================================================
+
+//=== Global variables =============================================================================
+
+uint32_t SIM_TempConvUs = 85000;
+uint32_t SIM_HumConvUs = 29000;
+
+//=== Local constants  =============================================================================
+
+// Conversions at lower resolutions take about half the time per bit less. Index is bit 7 and
+// bit 0 of the user register: RH12/T14, RH8/T12, RH10/T13, RH11/T11
+#define SIM_RES(d)	((((d)->user_reg >> 6) & 0x02) | ((d)->user_reg & 0x01))
+static const uint8_t SIM_TempShift[4] = { 0, 2, 1, 3 };
+static const uint8_t SIM_HumShift[4]  = { 0, 3, 2, 1 };
+
+//=== Local variables ==============================================================================
+
+static pthread_mutex_t sim_lock = PTHREAD_MUTEX_INITIALIZER;
+static SIM_Dev sim_dev[SIM_MAX_DEV];
+static int sim_ndev;
+static uint64_t sim_latch;		// output latches set through GPSET / GPCLR
+static uint64_t sim_bsc_low;		// lines pulled low by the BSC master
+
+// BSC1 controller, the FIFO and status registers are updated from this after every access
+static uint8_t bsc_tx[SIM_BSC_FIFO];
+static uint8_t bsc_ntx;
+static uint8_t bsc_rx[SIM_BSC_FIFO];
+static uint8_t bsc_nrx;
+static uint8_t bsc_rxpos;		// next byte taken out of the receive FIFO
+static uint32_t bsc_status;		// S_DONE, S_ERR, S_CLKT
+
+//=== Local function prototypes ====================================================================
+
+static uint64_t SIM_Settle(void);
+static uint64_t SIM_Levels(void);
+static void SIM_BscAccess(uint32_t reg,uint8_t write);
+static void SIM_BscRun(uint8_t read);
+static uint8_t SIM_BscSend(uint8_t b);
+static uint8_t SIM_BscRecv(uint8_t *b,uint8_t ack);
+static uint8_t SIM_BscClock(uint8_t sda);
+static uint64_t SIM_BscLines(uint8_t scl,uint8_t sda);
+static void SIM_Step(SIM_Dev *d,uint8_t scl,uint8_t sda);
+static void SIM_Rise(SIM_Dev *d);
+static void SIM_Fall(SIM_Dev *d);
+static uint8_t SIM_Byte(SIM_Dev *d);
+static void SIM_Command(SIM_Dev *d,uint8_t cmd);
+static void SIM_TxBegin(SIM_Dev *d);
+static void SIM_TxBit(SIM_Dev *d);
+static void SIM_Load(SIM_Dev *d,uint16_t raw);
+static uint8_t SIM_Crc(const uint8_t *data,uint8_t len);
+static uint64_t SIM_Now(void);
+
+//--------------------------------------------------------------------------------------------------
+// Name:	SIM_AddSHT21
+// Function:  	Connect a simulated SHT21 to two pins
+//		Several devices may share the clock pin, each needs its own data pin.
+//            
+// Parameter: 	scl and sda pin number
+// Return:    	device number, -1 if no more devices can be added
+//--------------------------------------------------------------------------------------------------
+int SIM_AddSHT21(uint8_t scl,uint8_t sda)
+{
+   SIM_Dev *d;
+   int n = -1;
+   
+   pthread_mutex_lock(&sim_lock);
+   if(sim_ndev < SIM_MAX_DEV && scl < SIM_NPINS && sda < SIM_NPINS)
+   {
+      n = sim_ndev++;
+      d = &sim_dev[n];
+      d->scl = scl;
+      d->sda = sda;
+      d->scl_low = 0;
+      d->sda_low = 0;
+      d->scl_lev = 1;
+      d->sda_lev = 1;
+      d->state = ST_IDLE;
+      d->cmd = 0;
+      d->user_reg = SIM_USER_REG;
+      d->raw_t = SIM_RAW_TMP;
+      d->raw_h = SIM_RAW_HUM | 0x02;
+      d->ready_at = 0;
+   }
+   pthread_mutex_unlock(&sim_lock);
+   
+   return n;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Name:	SIM_SetRaw
+// Function:  	Set the raw values returned by the next measurements of a device
+//            
+// Parameter: 	device number, raw temperature and humidity (status bits are set by the model)
+// Return:    	-
+//--------------------------------------------------------------------------------------------------
+void SIM_SetRaw(int dev,uint16_t temp,uint16_t hum)
+{
+   pthread_mutex_lock(&sim_lock);
+   if(dev >= 0 && dev < sim_ndev)
+   {
+      sim_dev[dev].raw_t = temp & 0xFFFC;
+      sim_dev[dev].raw_h = (hum & 0xFFFC) | 0x02;
+   }
+   pthread_mutex_unlock(&sim_lock);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Name:	SIM_Clear
+// Function:  	Remove all simulated devices
+//            
+// Parameter: 	-
+// Return:    	-
+//--------------------------------------------------------------------------------------------------
+void SIM_Clear(void)
+{
+   pthread_mutex_lock(&sim_lock);
+   sim_ndev = 0;
+   pthread_mutex_unlock(&sim_lock);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Name:	SIM_Sync
+// Function:  	Bring the simulated bus up to date with the GPIO registers
+//		Takes over writes to GPSET / GPCLR, steps the devices until the lines are stable
+//		and stores the line levels to GPLEV.
+//            
+// Parameter: 	-
+// Return:    	-
+//--------------------------------------------------------------------------------------------------
+void SIM_Sync(void)
+{
+   volatile uint32_t *gpio = bcm2835_gpio;
+   SIM_Dev *d;
+   uint64_t now;
+   int i;
+   
+   if(gpio == MAP_FAILED) return;
+   
+   pthread_mutex_lock(&sim_lock);
+   
+   // Set and clear registers are write only, move their bits to the latches
+   for(i=0;i<2;i++)
+   {
+      sim_latch |= (uint64_t)gpio[BCM2835_GPSET0/4 + i] << (32*i);
+      sim_latch &= ~((uint64_t)gpio[BCM2835_GPCLR0/4 + i] << (32*i));
+      gpio[BCM2835_GPSET0/4 + i] = 0;
+      gpio[BCM2835_GPCLR0/4 + i] = 0;
+   }
+   
+   // A stretching device lets the clock go once its measurement is done
+   now = 0;
+   for(i=0;i<sim_ndev;i++)
+   {
+      d = &sim_dev[i];
+      if(d->state != ST_STRETCH) continue;
+      if(!now) now = SIM_Now();
+      if(now >= d->ready_at)
+      {
+         d->scl_low = 0;
+         d->state = ST_TX;
+         SIM_TxBit(d);
+      }
+   }
+   
+   SIM_Settle();
+   pthread_mutex_unlock(&sim_lock);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Name:	SIM_Read / SIM_Write
+// Function:  	Hooks of the peripheral accesses of bcm2835.c: before a load from / after a store
+//		to a register. Accesses to BSC1 go to its model, all others bring the GPIO lines
+//		up to date, see SIM_Sync().
+//            
+// Parameter: 	register address
+// Return:    	-
+//--------------------------------------------------------------------------------------------------
+void SIM_Read(volatile uint32_t *paddr)
+{
+   if(bcm2835_bsc1 != MAP_FAILED && paddr >= bcm2835_bsc1 && paddr < bcm2835_bsc1 + 8)
+   {
+      pthread_mutex_lock(&sim_lock);
+      SIM_BscAccess(paddr - bcm2835_bsc1,0);
+      pthread_mutex_unlock(&sim_lock);
+   }
+   else SIM_Sync();
+}
+
+void SIM_Write(volatile uint32_t *paddr)
+{
+   if(bcm2835_bsc1 != MAP_FAILED && paddr >= bcm2835_bsc1 && paddr < bcm2835_bsc1 + 8)
+   {
+      pthread_mutex_lock(&sim_lock);
+      SIM_BscAccess(paddr - bcm2835_bsc1,1);
+      pthread_mutex_unlock(&sim_lock);
+   }
+   else SIM_Sync();
+}
+
+//--------------------------------------------------------------------------------------------------
+// Name:	SIM_Settle
+// Function:  	Let the devices react to the lines, they may pull them in turn, until the lines
+//		are stable, and store the levels to GPLEV (lock held)
+//            
+// Parameter: 	-
+// Return:    	bit n = level of pin n
+//--------------------------------------------------------------------------------------------------
+static uint64_t SIM_Settle(void)
+{
+   volatile uint32_t *gpio = bcm2835_gpio;
+   SIM_Dev *d;
+   uint64_t lev;
+   uint8_t changed,pulls,iter;
+   int i;
+   
+   iter = 0;
+   do
+   {
+      lev = SIM_Levels();
+      changed = 0;
+      for(i=0;i<sim_ndev;i++)
+      {
+         d = &sim_dev[i];
+         pulls = d->scl_low << 1 | d->sda_low;
+         SIM_Step(d,(lev >> d->scl) & 1,(lev >> d->sda) & 1);
+         if(pulls != (d->scl_low << 1 | d->sda_low)) changed = 1;
+      }
+   } while(changed && ++iter < 8);
+   if(changed) lev = SIM_Levels();
+   
+   gpio[BCM2835_GPLEV0/4] = (uint32_t)lev;
+   gpio[BCM2835_GPLEV1/4] = (uint32_t)(lev >> 32);
+   return lev;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Name:	SIM_BscAccess
+// Function:  	Access to a BSC1 register (lock held)
+//		A load from the FIFO register takes the next byte out of the receive FIFO, a store
+//		puts one into the transmit FIFO. Writing 1 to S_DONE, S_ERR or S_CLKT clears it.
+//		C_CLEAR empties both FIFOs, C_ST runs a transfer of DLEN bytes with the address
+//		in A, see SIM_BscRun().
+//            
+// Parameter: 	register (offset in words), 0 = load, 1 = store
+// Return:    	-
+//--------------------------------------------------------------------------------------------------
+static void SIM_BscAccess(uint32_t reg,uint8_t write)
+{
+   volatile uint32_t *bsc = bcm2835_bsc1;
+   uint32_t v = bsc[reg];
+   uint32_t st;
+   
+   switch(reg * 4)
+   {
+      case BCM2835_BSC_FIFO:
+         if(write)
+         {
+            if(bsc_ntx < SIM_BSC_FIFO) bsc_tx[bsc_ntx++] = v;
+         }
+         else if(bsc_rxpos < bsc_nrx) bsc[reg] = bsc_rx[bsc_rxpos++];
+         break;
+         
+      case BCM2835_BSC_S:
+         if(write) bsc_status &= ~(v & (BCM2835_BSC_S_CLKT | BCM2835_BSC_S_ERR | BCM2835_BSC_S_DONE));
+         break;
+         
+      case BCM2835_BSC_C:
+         if(!write) break;
+         if(v & (BCM2835_BSC_C_CLEAR_1 | BCM2835_BSC_C_CLEAR_2))
+         {
+            bsc_ntx = 0;
+            bsc_nrx = 0;
+            bsc_rxpos = 0;
+         }
+         if((v & BCM2835_BSC_C_ST) && (v & BCM2835_BSC_C_I2CEN)) SIM_BscRun(v & BCM2835_BSC_C_READ);
+         bsc[reg] = v & ~(BCM2835_BSC_C_ST | BCM2835_BSC_C_CLEAR_1 | BCM2835_BSC_C_CLEAR_2);
+         break;
+   }
+   
+   st = bsc_status;
+   if(bsc_rxpos < bsc_nrx) st |= BCM2835_BSC_S_RXD;
+   if(bsc_ntx < SIM_BSC_FIFO) st |= BCM2835_BSC_S_TXD;
+   if(bsc_ntx == 0) st |= BCM2835_BSC_S_TXE;
+   bsc[BCM2835_BSC_S/4] = st;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Name:	SIM_BscRun
+// Function:  	Run a BSC transfer on the device models, START to STOP (lock held)
+//		A write sends what is in the transmit FIFO (at most DLEN bytes), the controller
+//		does not wait for it to be refilled. A read acknowledges all bytes but the last.
+//            
+// Parameter: 	1 = read, 0 = write
+// Return:    	-
+//--------------------------------------------------------------------------------------------------
+static void SIM_BscRun(uint8_t read)
+{
+   volatile uint32_t *bsc = bcm2835_bsc1;
+   uint8_t addr = bsc[BCM2835_BSC_A/4] & 0x7F;
+   uint32_t len = bsc[BCM2835_BSC_DLEN/4] & 0xFFFF;
+   uint32_t i;
+   uint8_t r,b;
+   
+   if(read)
+   {
+      bsc_nrx = 0;
+      bsc_rxpos = 0;
+   }
+   
+   SIM_BscLines(1,1);
+   SIM_BscLines(1,0);
+   SIM_BscLines(0,0);
+   r = SIM_BscSend((addr << 1) | read);
+   for(i=0;i<len && r == 0;i++)
+   {
+      if(read)
+      {
+         r = SIM_BscRecv(&b,i + 1 < len);
+         if(r == 0 && bsc_nrx < SIM_BSC_FIFO) bsc_rx[bsc_nrx++] = b;
+      }
+      else if(i < bsc_ntx) r = SIM_BscSend(bsc_tx[i]);
+      else break;
+   }
+   if(!read) bsc_ntx = 0;
+   
+   if(r == 1) bsc_status |= BCM2835_BSC_S_ERR;
+   if(r == 2) bsc_status |= BCM2835_BSC_S_CLKT;
+   bsc_status |= BCM2835_BSC_S_DONE;
+   
+   SIM_BscLines(0,0);
+   SIM_BscLines(1,0);
+   SIM_BscLines(1,1);
+   sim_bsc_low = 0;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Name:	SIM_BscSend / SIM_BscRecv
+// Function:  	Send a byte and read its acknowledge / read a byte and acknowledge it
+//            
+// Parameter: 	byte / where to store it, 1 = acknowledge (more bytes follow)
+// Return:    	0 = acknowledged (SIM_BscSend) or read, 1 = not acknowledged, 2 = clock held low
+//--------------------------------------------------------------------------------------------------
+static uint8_t SIM_BscSend(uint8_t b)
+{
+   uint8_t i;
+   
+   for(i=0;i<8;i++)
+   {
+      if(SIM_BscClock((b >> (7 - i)) & 1) == 2) return 2;
+   }
+   return SIM_BscClock(1);
+}
+
+static uint8_t SIM_BscRecv(uint8_t *b,uint8_t ack)
+{
+   uint8_t i,r;
+   uint8_t d = 0;
+   
+   for(i=0;i<8;i++)
+   {
+      r = SIM_BscClock(1);
+      if(r == 2) return 2;
+      d = (d << 1) | r;
+   }
+   *b = d;
+   return (SIM_BscClock(!ack) == 2) ? 2 : 0;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Name:	SIM_BscClock
+// Function:  	One clock pulse of the BSC master, data set up while the clock is low
+//            
+// Parameter: 	SDA driven by the master (1 = released)
+// Return:    	SDA sampled with the clock high, 2 = clock held low by a device
+//--------------------------------------------------------------------------------------------------
+static uint8_t SIM_BscClock(uint8_t sda)
+{
+   uint64_t lev;
+   
+   SIM_BscLines(0,sda);
+   lev = SIM_BscLines(1,sda);
+   if(!((lev >> SIM_BSC_SCL) & 1)) return 2;
+   SIM_BscLines(0,sda);
+   return (lev >> SIM_BSC_SDA) & 1;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Name:	SIM_BscLines
+// Function:  	Drive the BSC lines (1 = released, 0 = low) and let the devices react
+//            
+// Parameter: 	SCL, SDA
+// Return:    	bit n = level of pin n
+//--------------------------------------------------------------------------------------------------
+static uint64_t SIM_BscLines(uint8_t scl,uint8_t sda)
+{
+   sim_bsc_low = (scl ? 0 : (uint64_t)1 << SIM_BSC_SCL) | (sda ? 0 : (uint64_t)1 << SIM_BSC_SDA);
+   return SIM_Settle();
+}
+
+//--------------------------------------------------------------------------------------------------
+// Name:	SIM_Levels
+// Function:  	Resolve the levels of all lines: an output follows its latch, an input is pulled
+//		up, and the BSC master or any device can pull a line low
+//            
+// Parameter: 	-
+// Return:    	bit n = level of pin n
+//--------------------------------------------------------------------------------------------------
+static uint64_t SIM_Levels(void)
+{
+   volatile uint32_t *gpio = bcm2835_gpio;
+   uint64_t out = 0;
+   uint64_t lev;
+   uint32_t fsel;
+   int pin,i;
+   
+   for(pin=0;pin<SIM_NPINS;pin++)
+   {
+      fsel = (gpio[BCM2835_GPFSEL0/4 + pin/10] >> ((pin % 10) * 3)) & BCM2835_GPIO_FSEL_MASK;
+      if(fsel == BCM2835_GPIO_FSEL_OUTP) out |= (uint64_t)1 << pin;
+   }
+   lev = (~out | (out & sim_latch)) & ~sim_bsc_low;
+   
+   for(i=0;i<sim_ndev;i++)
+   {
+      if(sim_dev[i].scl_low) lev &= ~((uint64_t)1 << sim_dev[i].scl);
+      if(sim_dev[i].sda_low) lev &= ~((uint64_t)1 << sim_dev[i].sda);
+   }
+   return lev & (((uint64_t)1 << SIM_NPINS) - 1);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Name:	SIM_Step
+// Function:  	Let a device see the current line levels
+//		A change of SDA is judged against the previous SCL level, so a device changing
+//		SDA while releasing the clock is not taken for a START or STOP.
+//            
+// Parameter: 	device, SCL and SDA level
+// Return:    	-
+//--------------------------------------------------------------------------------------------------
+static void SIM_Step(SIM_Dev *d,uint8_t scl,uint8_t sda)
+{
+   if(sda != d->sda_lev)
+   {
+      d->sda_lev = sda;
+      if(d->scl_lev)
+      {
+         if(!sda)			// START (or repeated START)
+         {
+            d->state = ST_RX;
+            d->bits = 0;
+            d->nrx = 0;
+            d->sda_low = 0;
+         }
+         else				// STOP
+         {
+            d->state = ST_IDLE;
+            d->sda_low = 0;
+         }
+      }
+   }
+   if(scl != d->scl_lev)
+   {
+      d->scl_lev = scl;
+      if(scl) SIM_Rise(d);
+      else    SIM_Fall(d);
+   }
+}
+
+//--------------------------------------------------------------------------------------------------
+// Name:	SIM_Rise / SIM_Fall
+// Function:  	Rising clock edge: sample SDA. Falling clock edge: drive SDA for the next bit.
+//            
+// Parameter: 	device
+// Return:    	-
+//--------------------------------------------------------------------------------------------------
+static void SIM_Rise(SIM_Dev *d)
+{
+   if(d->state == ST_RX)
+   {
+      d->shift = d->shift << 1 | d->sda_lev;
+      d->bits++;
+   }
+   else if(d->state == ST_TX_ACK)
+   {
+      d->acked = !d->sda_lev;
+   }
+}
+
+static void SIM_Fall(SIM_Dev *d)
+{
+   switch(d->state)
+   {
+      case ST_RX:
+         if(d->bits == 8)
+         {
+            if(SIM_Byte(d))
+            {
+               d->sda_low = 1;
+               d->state = ST_RX_ACK;
+            }
+            else d->state = ST_IDLE;
+         }
+         break;
+         
+      case ST_RX_ACK:
+         d->sda_low = 0;
+         if(d->read) SIM_TxBegin(d);
+         else
+         {
+            d->state = ST_RX;
+            d->bits = 0;
+         }
+         break;
+         
+      case ST_TX:
+         if(++d->bits < 8) SIM_TxBit(d);
+         else
+         {
+            d->sda_low = 0;
+            d->state = ST_TX_ACK;
+         }
+         break;
+         
+      case ST_TX_ACK:
+         if(d->acked)
+         {
+            d->txpos++;
+            d->bits = 0;
+            d->state = ST_TX;
+            SIM_TxBit(d);
+         }
+         else d->state = ST_IDLE;
+         break;
+   }
+}
+
+//--------------------------------------------------------------------------------------------------
+// Name:	SIM_Byte
+// Function:  	Handle a received byte
+//            
+// Parameter: 	device
+// Return:    	1 = acknowledge, 0 = not
+//--------------------------------------------------------------------------------------------------
+static uint8_t SIM_Byte(SIM_Dev *d)
+{
+   uint8_t b = d->shift;
+   
+   if(d->nrx++ == 0)
+   {
+      if((b >> 1) != SIM_ADDR) return 0;
+      d->read = b & 1;
+      
+      // No hold master: the address is not acknowledged while converting
+      if(d->read && (d->cmd == 0xF3 || d->cmd == 0xF5) && SIM_Now() < d->ready_at) return 0;
+      return 1;
+   }
+   
+   if(d->nrx == 2) SIM_Command(d,b);
+   else if(d->nrx == 3 && d->cmd == 0xE6) d->user_reg = b;
+   return 1;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Name:	SIM_Command
+// Function:  	Execute a command of the SHT21
+//            
+// Parameter: 	device, command
+// Return:    	-
+//--------------------------------------------------------------------------------------------------
+static void SIM_Command(SIM_Dev *d,uint8_t cmd)
+{
+   d->cmd = cmd;
+   switch(cmd)
+   {
+      case 0xFE:					// soft reset
+         d->user_reg = SIM_USER_REG;
+         break;
+      case 0xE3:					// temperature
+      case 0xF3:
+         SIM_Load(d,d->raw_t);
+         d->ready_at = SIM_Now() + (SIM_TempConvUs >> SIM_TempShift[SIM_RES(d)]);
+         break;
+      case 0xE5:					// humidity
+      case 0xF5:
+         SIM_Load(d,d->raw_h);
+         d->ready_at = SIM_Now() + (SIM_HumConvUs >> SIM_HumShift[SIM_RES(d)]);
+         break;
+      case 0xE7:					// read user register
+         d->tx[0] = d->user_reg;
+         d->tx[1] = SIM_Crc(d->tx,1);
+         d->tx[2] = 0xFF;
+         break;
+   }
+}
+
+//--------------------------------------------------------------------------------------------------
+// Name:	SIM_TxBegin / SIM_TxBit
+// Function:  	Start sending after the read address was acknowledged (in hold master mode the
+//		clock is held low until the result is ready) / drive SDA for the current bit
+//            
+// Parameter: 	device
+// Return:    	-
+//--------------------------------------------------------------------------------------------------
+static void SIM_TxBegin(SIM_Dev *d)
+{
+   d->txpos = 0;
+   d->bits = 0;
+   if((d->cmd == 0xE3 || d->cmd == 0xE5) && SIM_Now() < d->ready_at)
+   {
+      d->scl_low = 1;
+      d->state = ST_STRETCH;
+   }
+   else
+   {
+      d->state = ST_TX;
+      SIM_TxBit(d);
+   }
+}
+
+static void SIM_TxBit(SIM_Dev *d)
+{
+   uint8_t b = (d->txpos < sizeof(d->tx)) ? d->tx[d->txpos] : 0xFF;
+   
+   d->sda_low = !((b << d->bits) & 0x80);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Name:	SIM_Load
+// Function:  	Prepare a measurement result with its CRC for sending
+//            
+// Parameter: 	device, raw value
+// Return:    	-
+//--------------------------------------------------------------------------------------------------
+static void SIM_Load(SIM_Dev *d,uint16_t raw)
+{
+   d->tx[0] = raw >> 8;
+   d->tx[1] = raw & 0xFF;
+   d->tx[2] = SIM_Crc(d->tx,2);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Name:	SIM_Crc
+// Function:  	CRC-8 of the SHT21, polynomial x^8 + x^5 + x^4 + 1
+//            
+// Parameter: 	data, number of bytes
+// Return:    	CRC
+//--------------------------------------------------------------------------------------------------
+static uint8_t SIM_Crc(const uint8_t *data,uint8_t len)
+{
+   uint8_t crc = 0;
+   uint8_t bit;
+   
+   while(len--)
+   {
+      crc ^= *data++;
+      for(bit=8;bit>0;bit--) crc = (crc & 0x80) ? (crc << 1) ^ 0x31 : (crc << 1);
+   }
+   return crc;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Name:	SIM_Now
+// Function:  	Monotonic time
+//            
+// Parameter: 	-
+// Return:    	time in us
+//--------------------------------------------------------------------------------------------------
+static uint64_t SIM_Now(void)
+{
+   struct timespec ts;
+   
+   clock_gettime(CLOCK_MONOTONIC,&ts);
+   return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
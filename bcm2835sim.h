@@ -0,0 +1,54 @@
+//--------------------------------------------------------------------------------------------------
+//
+// Filename:    bcm2835sim.h
+// Description: Simulated BCM2835 peripheral block with SHT21 device models
+//              Built into the library with -DBCM2835_SIM (make SIM=1). bcm2835_init() then maps
+//              plain memory instead of /dev/mem and the models react to the GPIO registers as
+//              real sensors on the bus would, so the library runs on any host.
+//              
+// Author:      agent
+// History:     17.10.2026 Initial version
+//              17.10.2026 BSC1 controller model
+//--------------------------------------------------------------------------------------------------
+
+#ifndef BCM2835SIM_H
+#define BCM2835SIM_H
+
+//=== Includes =====================================================================================	
+
+#include <stdint.h>
+
+//=== Preprocessing directives (#define) ===========================================================
+
+#define SIM_MAX_DEV	32		// max number of simulated sensors
+
+// Called before every load from and after every store to a peripheral register, so the
+// device models see each edge and the BSC model each FIFO access. Compile to nothing in a
+// normal build.
+#ifdef BCM2835_SIM
+#define BCM2835_SIM_READ(paddr)		SIM_Read(paddr)
+#define BCM2835_SIM_WRITE(paddr)	SIM_Write(paddr)
+#else
+#define BCM2835_SIM_READ(paddr)
+#define BCM2835_SIM_WRITE(paddr)
+#endif
+
+//=== Type definitions (typedef) ===================================================================
+
+//=== Global constants (extern) ====================================================================
+
+//=== Global variables (extern) ====================================================================
+
+extern uint32_t SIM_TempConvUs;		// conversion time of a temperature measurement (14 bit)
+extern uint32_t SIM_HumConvUs;		// conversion time of a humidity measurement (12 bit)
+
+//=== Global function prototypes ===================================================================
+
+int     SIM_AddSHT21(uint8_t scl,uint8_t sda);
+void    SIM_SetRaw(int dev,uint16_t temp,uint16_t hum);
+void    SIM_Clear(void);
+void    SIM_Sync(void);
+void    SIM_Read(volatile uint32_t *paddr);
+void    SIM_Write(volatile uint32_t *paddr);
+
+#endif
@@ -0,0 +1,129 @@
+/************************************************************************
+  Micro-benchmark of the batch conversions of raw SHT21 values
+
+  Converts a buffer of raw temperature and humidity values, once one
+  value at a time with the scalar fixed point formulas and once with
+  SHT21_BatchTemp()/SHT21_BatchHum() and their float variants, which
+  use SSE2/AVX2 or NEON where available. The buffer (-b values) is
+  converted over and over until n values are done, so a buffer that
+  fits the cache measures the ALU cost, a large one the memory bandwidth.
+
+  Author: agent
+  
+  Usage: convbench [-n values] [-b buffer values]
+  
+************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "sht21.h"
+
+static double now_s(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void report(const char *name, long n, double t, int outsize)
+{
+   printf("%-8s %10ld values %8.3f s %8.1f Mvalues/s %6.2f GB/s\n",
+          name, n, t, n / t / 1e6, n * (2.0 + outsize) / t / 1e9);
+}
+
+int main(int argc, char* argv[])
+{
+   long n = 100000000;
+   long b = 16384;
+   long i, k, passes;
+   int opt;
+   uint16_t *raw, *hum, *hum2;
+   int16_t *temp, *temp2;
+   float *f;
+   uint32_t val;
+   long bad = 0;
+   double t0, t_scalar, t_batch;
+
+   while ((opt = getopt(argc, argv, "n:b:")) != -1)
+   {
+      switch (opt)
+      {
+         case 'n': n = atol(optarg); break;
+         case 'b': b = atol(optarg); break;
+         default:
+            fprintf(stderr, "Usage: %s [-n values] [-b buffer values]\n", argv[0]);
+            return 1;
+      }
+   }
+
+   if (b <= 0 || b > n) b = n;
+   passes = n / b;
+   n = passes * b;
+
+   raw = malloc(b * sizeof(*raw));
+   hum = malloc(b * sizeof(*hum));
+   hum2 = malloc(b * sizeof(*hum2));
+   temp = malloc(b * sizeof(*temp));
+   temp2 = malloc(b * sizeof(*temp2));
+   f = malloc(b * sizeof(*f));
+   if (!raw || !hum || !hum2 || !temp || !temp2 || !f) return 1;
+
+   srand(1);
+   for (i = 0; i < b; i++) raw[i] = rand();
+   memset(hum, 0, b * sizeof(*hum));
+   memset(hum2, 0, b * sizeof(*hum2));
+   memset(temp, 0, b * sizeof(*temp));
+   memset(temp2, 0, b * sizeof(*temp2));
+   memset(f, 0, b * sizeof(*f));
+
+   /* One value at a time, as in the read path */
+   t0 = now_s();
+   for (k = 0; k < passes; k++)
+   {
+      for (i = 0; i < b; i++)
+      {
+         val = raw[i] & 0xFFFC;
+         temp[i] = (int16_t)(((val * 4393) >> 14) - 4685);
+         val = (625 * val) >> 15;
+         hum[i] = (val > 60) ? val - 60 : 0;
+      }
+      __asm__ __volatile__("" : : "r" (temp), "r" (hum) : "memory");
+   }
+   t_scalar = now_s() - t0;
+   report("scalar", 2 * n, t_scalar, 2);
+
+   t0 = now_s();
+   for (k = 0; k < passes; k++)
+   {
+      SHT21_BatchTemp(raw, temp2, b);
+      SHT21_BatchHum(raw, hum2, b);
+   }
+   t_batch = now_s() - t0;
+   report("batch", 2 * n, t_batch, 2);
+   printf("speedup  %.2fx\n", t_scalar / t_batch);
+
+   for (i = 0; i < b; i++)
+      bad += (temp[i] != temp2[i]) + (hum[i] != hum2[i]);
+
+   t0 = now_s();
+   for (k = 0; k < passes; k++)
+   {
+      SHT21_BatchTempFloat(raw, f, b);
+      SHT21_BatchHumFloat(raw, f, b);
+   }
+   report("float", 2 * n, now_s() - t0, 4);
+
+   if (bad) printf("%ld values differ\n", bad);
+   free(raw);
+   free(hum);
+   free(hum2);
+   free(temp);
+   free(temp2);
+   free(f);
+   return bad != 0;
+}
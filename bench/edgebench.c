@@ -0,0 +1,194 @@
+/************************************************************************
+  Micro-benchmark of the open drain edge rate
+
+  Toggles one pin between input and output, once with
+  bcm2835_gpio_fsel() (a barriered read-modify-write of GPFSEL per
+  edge, as the bit-bang code did before) and once through the shadow
+  GPFSEL registers of an SI2C bus (one store per edge).
+
+  Then runs a whole SHT21 measurement transaction (write command,
+  repeated start, read 3 bytes) at full speed, once composed from the
+  byte primitives and once through SI2C_Transfer(), which adds the
+  register locks of a transport call (no jitter histogram, that is
+  recorded in real-time mode only).
+
+  Both are repeated on a bus with the pins fixed at build time
+  (i2cfix.h, SCL 4 / SDA 5), where every edge is an inlined store to
+  a constant register.
+
+  Without -H the GPIO registers are backed by plain memory, which
+  measures the CPU cost of the code path on any host. With -H the
+  real peripherals are mapped (Raspberry Pi only, the pin toggles!).
+
+  Author: agent
+  
+  Usage: edgebench [-n edges] [-p pin] [-H]
+  
+************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "bcm2835.h"
+#include "i2c.h"
+
+#define SI2C_FIX_SCL 4
+#define SI2C_FIX_SDA 5
+#include "i2cfix.h"
+
+static uint32_t fake_regs[BCM2835_BLOCK_SIZE/4];
+
+static void transaction_bytes(SI2C_Bus *bus, uint8_t *d)
+{
+   SI2C_Start(bus);
+   SI2C_SendByte(bus, 0x40 << 1);
+   SI2C_SendByte(bus, 0xE3);
+   SI2C_Start(bus);
+   SI2C_SendByte(bus, (0x40 << 1) + 1);
+   SI2C_SetSclState(bus, 1);
+   while (SI2C_GetSclState(bus) == 0);
+   d[0] = SI2C_ReadByte(bus, 1);
+   d[1] = SI2C_ReadByte(bus, 1);
+   d[2] = SI2C_ReadByte(bus, 0);
+   SI2C_Stop(bus);
+}
+
+static double now_s(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void report(const char *name, long n, double t)
+{
+   printf("%-8s %10ld edges %8.3f s %8.2f Medges/s %7.1f ns/edge\n",
+          name, n, t, n / t / 1e6, t * 1e9 / n);
+}
+
+static void report_tr(const char *name, long n, double t)
+{
+   printf("%-8s %10ld trans %8.3f s %8.2f Mtrans/s %7.1f ns/trans\n",
+          name, n, t, n / t / 1e6, t * 1e9 / n);
+}
+
+int main(int argc, char* argv[])
+{
+   SI2C_Bus bus;
+   long n = 10000000;
+   long i;
+   int pin = 4;
+   int hw = 0;
+   int opt;
+   double t0, t_fsel, t_shadow, t_fixed, t_bytes, t_transfer, t_fixtr;
+   SI2C_FixCtx fix;
+   uint8_t cmd = 0xE3;
+   uint8_t d[3];
+   I2C_Msg msgs[2] = { { 0x40, 0, 1, &cmd }, { 0x40, I2C_MSG_RD, 3, d } };
+
+   while ((opt = getopt(argc, argv, "n:p:H")) != -1)
+   {
+      switch (opt)
+      {
+         case 'n': n = atol(optarg); break;
+         case 'p': pin = atoi(optarg); break;
+         case 'H': hw = 1; break;
+         default:
+            fprintf(stderr, "Usage: %s [-n edges] [-p pin] [-H]\n", argv[0]);
+            return 1;
+      }
+   }
+
+   if (hw)
+   {
+      if (!bcm2835_init()) return 1;
+   }
+   else
+   {
+      bcm2835_gpio = fake_regs;
+   }
+
+   /* Clock and data on the same pin, only the clock is toggled */
+   SI2C_Init(&bus, pin, pin);
+
+   t0 = now_s();
+   for (i = 0; i < n; i += 2)
+   {
+      bcm2835_gpio_fsel(pin, BCM2835_GPIO_FSEL_OUTP);
+      bcm2835_gpio_fsel(pin, BCM2835_GPIO_FSEL_INPT);
+   }
+   t_fsel = now_s() - t0;
+   report("fsel", n, t_fsel);
+
+   t0 = now_s();
+   for (i = 0; i < n; i += 2)
+   {
+      SI2C_SetSclState(&bus, 0);
+      SI2C_SetSclState(&bus, 1);
+   }
+   t_shadow = now_s() - t0;
+   report("shadow", n, t_shadow);
+
+   printf("speedup  %.2fx\n", t_fsel / t_shadow);
+
+   /* Same pin fixed at build time */
+   if (pin == SI2C_FIX_SCL)
+   {
+      SI2C_FixInit(0);
+      SI2C_LockBanks(SI2C_FIX_BANKS);
+      SI2C_FixBegin(&fix);
+      t0 = now_s();
+      for (i = 0; i < n; i += 2)
+      {
+         SI2C_FixScl(&fix, 0);
+         SI2C_FixScl(&fix, 1);
+      }
+      t_fixed = now_s() - t0;
+      SI2C_FixEnd(&fix);
+      SI2C_UnlockBanks(SI2C_FIX_BANKS);
+      report("fixed", n, t_fixed);
+      printf("speedup  %.2fx over shadow\n", t_shadow / t_fixed);
+   }
+
+   /* Whole transactions without delays. In memory SCL reads high and
+      SDA low, so every byte is acknowledged and nothing is stretched. */
+   if (!hw)
+   {
+      fake_regs[BCM2835_GPLEV0/4] = 1 << pin;
+      SI2C_Init(&bus, pin, pin + 1);
+      SI2C_SetSpeed(&bus, 0);
+      n /= 200;
+
+      t0 = now_s();
+      for (i = 0; i < n; i++)
+         transaction_bytes(&bus, d);
+      t_bytes = now_s() - t0;
+      report_tr("bytes", n, t_bytes);
+
+      t0 = now_s();
+      for (i = 0; i < n; i++)
+         SI2C_Transfer(&bus, msgs, 2);
+      t_transfer = now_s() - t0;
+      report_tr("transfer", n, t_transfer);
+
+      printf("speedup  %.2fx\n", t_bytes / t_transfer);
+
+      if (pin == SI2C_FIX_SCL)
+      {
+         SI2C_FixInit(0);
+         fake_regs[BCM2835_GPLEV0/4] = 1 << pin;
+         t0 = now_s();
+         for (i = 0; i < n; i++)
+            SI2C_FixTransfer(NULL, msgs, 2);
+         t_fixtr = now_s() - t0;
+         report_tr("fixed", n, t_fixtr);
+         printf("speedup  %.2fx over bytes\n", t_bytes / t_fixtr);
+      }
+   }
+
+   if (hw) bcm2835_close();
+   return 0;
+}
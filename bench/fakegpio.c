@@ -0,0 +1,255 @@
+/************************************************************************
+  Fake GPIO character device for the libsht benchmarks
+
+  Preloaded shim (LD_PRELOAD=./fakegpio.so) that stands in for the
+  kernel GPIO driver: opening /dev/gpiochipN gives a placeholder file,
+  line N of the chip is pin N of a private simulated peripheral block
+  (bcm2835sim.c, built into the shim with hidden symbols, so it does
+  not mix with the one of the program). A line request is served as
+  open drain: writing 0 drives the pin low, writing 1 releases it.
+  GPIO_V2_LINE_SET_VALUES and GET_VALUES act on all requested lines at
+  once, as the kernel does.
+
+  The sensors are set with FAKEGPIO_SENSORS="scl:sda,scl:sda,..."
+  (line offsets, several may share one SCL line), FAKEGPIO_CONV_US
+  overrides the conversion times of the model. The number of value
+  ioctls is printed at exit.
+
+  Author: agent
+
+************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdarg.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <dlfcn.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <linux/gpio.h>
+
+#include "bcm2835.h"
+#include "bcm2835sim.h"
+
+#define MAX_FD  1024
+#define NLINES  54
+
+#define EXPORT  __attribute__((visibility("default")))
+
+/* Type of a placeholder file */
+#define FD_NONE   0
+#define FD_CHIP   1
+#define FD_LINES  2
+
+/* Registers of the simulated block, only GPIO is used (no BSC) */
+volatile uint32_t *bcm2835_gpio;
+volatile uint32_t *bcm2835_bsc1 = (uint32_t *)MAP_FAILED;
+static uint32_t regs[BCM2835_BLOCK_SIZE/4];
+
+static uint8_t  fd_type[MAX_FD];
+static uint8_t  fd_nlines[MAX_FD];
+static uint8_t  fd_offset[MAX_FD][GPIO_V2_LINES_MAX];
+static unsigned long sets, gets;
+
+static void configure(void)
+{
+   static int done;
+   const char *s;
+   char *end;
+   long scl, sda;
+
+   if (done)
+      return;
+   done = 1;
+   bcm2835_gpio = regs;
+   if ((s = getenv("FAKEGPIO_CONV_US")) != NULL)
+      SIM_TempConvUs = SIM_HumConvUs = atoi(s);
+   if ((s = getenv("FAKEGPIO_SENSORS")) == NULL)
+      s = "0:1";
+   while (*s)
+   {
+      scl = strtol(s, &end, 10);
+      if (*end != ':')
+         break;
+      sda = strtol(end + 1, &end, 10);
+      SIM_AddSHT21(scl, sda);
+      if (*end != ',')
+         break;
+      s = end + 1;
+   }
+   SIM_Sync();
+}
+
+/* Open drain: 0 = output low (the latch stays cleared), 1 = input */
+static void set_line(uint8_t pin, int value)
+{
+   volatile uint32_t *fsel = &regs[BCM2835_GPFSEL0/4 + pin/10];
+   uint8_t shift = (pin % 10) * 3;
+
+   *fsel &= ~(BCM2835_GPIO_FSEL_MASK << shift);
+   if (!value)
+      *fsel |= BCM2835_GPIO_FSEL_OUTP << shift;
+}
+
+static int get_level(uint8_t pin)
+{
+   return (regs[BCM2835_GPLEV0/4 + pin/32] >> (pin % 32)) & 1;
+}
+
+static int fake_open(const char *path, int flags, mode_t mode, const char *sym)
+{
+   int (*real_open)(const char *, int, ...) = dlsym(RTLD_NEXT, sym);
+   int fd;
+
+   if (strncmp(path, "/dev/gpiochip", 13) != 0)
+      return real_open(path, flags, mode);
+
+   fd = real_open("/dev/null", O_RDWR | (flags & O_CLOEXEC));
+   if (fd >= 0 && fd < MAX_FD)
+      fd_type[fd] = FD_CHIP;
+   return fd;
+}
+
+EXPORT int open(const char *path, int flags, ...)
+{
+   va_list ap;
+   mode_t mode;
+
+   va_start(ap, flags);
+   mode = va_arg(ap, mode_t);
+   va_end(ap);
+   return fake_open(path, flags, mode, "open");
+}
+
+EXPORT int open64(const char *path, int flags, ...)
+{
+   va_list ap;
+   mode_t mode;
+
+   va_start(ap, flags);
+   mode = va_arg(ap, mode_t);
+   va_end(ap);
+   return fake_open(path, flags, mode, "open64");
+}
+
+EXPORT int close(int fd)
+{
+   int (*real_close)(int) = dlsym(RTLD_NEXT, "close");
+   uint32_t i;
+
+   if (fd >= 0 && fd < MAX_FD)
+   {
+      /* Released lines go back to inputs */
+      if (fd_type[fd] == FD_LINES)
+      {
+         for (i = 0; i < fd_nlines[fd]; i++)
+            set_line(fd_offset[fd][i], 1);
+         SIM_Sync();
+      }
+      fd_type[fd] = FD_NONE;
+   }
+   return real_close(fd);
+}
+
+static int get_line(struct gpio_v2_line_request *req)
+{
+   int (*real_open)(const char *, int, ...) = dlsym(RTLD_NEXT, "open");
+   uint32_t i;
+   int fd;
+
+   if (req->num_lines == 0 || req->num_lines > GPIO_V2_LINES_MAX)
+   {
+      errno = EINVAL;
+      return -1;
+   }
+   for (i = 0; i < req->num_lines; i++)
+   {
+      if (req->offsets[i] >= NLINES)
+      {
+         errno = EINVAL;
+         return -1;
+      }
+   }
+
+   fd = real_open("/dev/null", O_RDWR | O_CLOEXEC);
+   if (fd < 0 || fd >= MAX_FD)
+      return -1;
+   fd_type[fd] = FD_LINES;
+   fd_nlines[fd] = req->num_lines;
+   for (i = 0; i < req->num_lines; i++)
+   {
+      fd_offset[fd][i] = req->offsets[i];
+      set_line(req->offsets[i], 1);
+   }
+   SIM_Sync();
+   req->fd = fd;
+   return 0;
+}
+
+EXPORT int ioctl(int fd, unsigned long req, ...)
+{
+   int (*real_ioctl)(int, unsigned long, void *) = dlsym(RTLD_NEXT, "ioctl");
+   struct gpiochip_info *info;
+   struct gpio_v2_line_values *v;
+   uint32_t i;
+   va_list ap;
+   void *arg;
+
+   va_start(ap, req);
+   arg = va_arg(ap, void *);
+   va_end(ap);
+
+   if (fd < 0 || fd >= MAX_FD || fd_type[fd] == FD_NONE)
+      return real_ioctl(fd, req, arg);
+
+   configure();
+   if (fd_type[fd] == FD_CHIP && req == GPIO_GET_CHIPINFO_IOCTL)
+   {
+      info = arg;
+      memset(info, 0, sizeof(*info));
+      strcpy(info->name, "gpiochip0");
+      strcpy(info->label, "fakegpio");
+      info->lines = NLINES;
+      return 0;
+   }
+   if (fd_type[fd] == FD_CHIP && req == GPIO_V2_GET_LINE_IOCTL)
+      return get_line(arg);
+   if (fd_type[fd] == FD_LINES && req == GPIO_V2_LINE_SET_VALUES_IOCTL)
+   {
+      v = arg;
+      sets++;
+      for (i = 0; i < fd_nlines[fd]; i++)
+      {
+         if (v->mask & ((uint64_t)1 << i))
+            set_line(fd_offset[fd][i], (v->bits >> i) & 1);
+      }
+      SIM_Sync();
+      return 0;
+   }
+   if (fd_type[fd] == FD_LINES && req == GPIO_V2_LINE_GET_VALUES_IOCTL)
+   {
+      v = arg;
+      gets++;
+      SIM_Sync();
+      v->bits = 0;
+      for (i = 0; i < fd_nlines[fd]; i++)
+      {
+         if (v->mask & ((uint64_t)1 << i))
+            v->bits |= (uint64_t)get_level(fd_offset[fd][i]) << i;
+      }
+      return 0;
+   }
+
+   errno = ENOTTY;
+   return -1;
+}
+
+__attribute__((destructor))
+static void report(void)
+{
+   if (sets || gets)
+      fprintf(stderr, "fakegpio %lu SET_VALUES, %lu GET_VALUES calls\n", sets, gets);
+}
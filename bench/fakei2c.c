@@ -0,0 +1,150 @@
+/************************************************************************
+  Fake i2c-dev interface for the libsht benchmarks
+
+  Preloaded shim (LD_PRELOAD=./fakei2c.so) that stands in for the
+  kernel i2c-dev driver: opening /dev/i2c-N gives a placeholder file
+  and I2C_RDWR transfers on it are served by the simulated sensor of
+  simbus.c, one segment per i2c_msg. A read after a write is a
+  repeated start, so the sensor may stretch the clock in between.
+  The number of I2C_RDWR calls is printed at exit. The environment
+  variables FAKEI2C_CONV_US and FAKEI2C_BYTE_US override the conversion
+  and byte time of the model.
+
+  Author: agent
+  
+************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdarg.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <dlfcn.h>
+#include <unistd.h>
+#include <linux/i2c.h>
+#include <linux/i2c-dev.h>
+
+#include "simbus.h"
+
+#define MAX_FD  1024
+#define MAX_MSGS  42
+
+static uint8_t  is_fake[MAX_FD];
+static unsigned long transfers;
+
+static int fake_open(const char *path, int flags, mode_t mode, const char *sym)
+{
+   int (*real_open)(const char *, int, ...) = dlsym(RTLD_NEXT, sym);
+   int fd;
+   
+   if (strncmp(path, "/dev/i2c-", 9) != 0)
+      return real_open(path, flags, mode);
+   
+   fd = real_open("/dev/null", O_RDWR | (flags & O_CLOEXEC));
+   if (fd >= 0 && fd < MAX_FD)
+      is_fake[fd] = 1;
+   return fd;
+}
+
+int open(const char *path, int flags, ...)
+{
+   va_list ap;
+   mode_t mode;
+   
+   va_start(ap, flags);
+   mode = va_arg(ap, mode_t);
+   va_end(ap);
+   return fake_open(path, flags, mode, "open");
+}
+
+int open64(const char *path, int flags, ...)
+{
+   va_list ap;
+   mode_t mode;
+   
+   va_start(ap, flags);
+   mode = va_arg(ap, mode_t);
+   va_end(ap);
+   return fake_open(path, flags, mode, "open64");
+}
+
+int close(int fd)
+{
+   int (*real_close)(int) = dlsym(RTLD_NEXT, "close");
+   
+   if (fd >= 0 && fd < MAX_FD)
+      is_fake[fd] = 0;
+   return real_close(fd);
+}
+
+static void configure(void)
+{
+   static int done;
+   const char *s;
+   
+   if (done)
+      return;
+   done = 1;
+   if ((s = getenv("FAKEI2C_CONV_US")) != NULL)
+      SIMBUS_ConvTime = atoi(s);
+   if ((s = getenv("FAKEI2C_BYTE_US")) != NULL)
+      SIMBUS_ByteTime = atoi(s);
+}
+
+static int fail(uint8_t error)
+{
+   errno = (error & I2C_ERR_TIMEOUT) ? ETIMEDOUT : ENXIO;
+   return -1;
+}
+
+int ioctl(int fd, unsigned long req, ...)
+{
+   int (*real_ioctl)(int, unsigned long, void *) = dlsym(RTLD_NEXT, "ioctl");
+   struct i2c_rdwr_ioctl_data *xfer;
+   I2C_Msg msgs[MAX_MSGS];
+   uint8_t error;
+   uint32_t i;
+   va_list ap;
+   void *arg;
+   
+   va_start(ap, req);
+   arg = va_arg(ap, void *);
+   va_end(ap);
+   
+   if (fd < 0 || fd >= MAX_FD || !is_fake[fd])
+      return real_ioctl(fd, req, arg);
+   if (req != I2C_RDWR)
+   {
+      errno = ENOTTY;
+      return -1;
+   }
+   
+   configure();
+   transfers++;
+   xfer = arg;
+   if (xfer->nmsgs > MAX_MSGS)
+   {
+      errno = EINVAL;
+      return -1;
+   }
+   for (i = 0; i < xfer->nmsgs; i++)
+   {
+      msgs[i].addr = xfer->msgs[i].addr;
+      msgs[i].flags = (xfer->msgs[i].flags & I2C_M_RD) ? I2C_MSG_RD : 0;
+      msgs[i].len = xfer->msgs[i].len;
+      msgs[i].buf = xfer->msgs[i].buf;
+   }
+   error = SIMBUS_Ops.transfer(NULL, msgs, xfer->nmsgs);
+   if (error)
+      return fail(error);
+   return xfer->nmsgs;
+}
+
+__attribute__((destructor))
+static void report(void)
+{
+   if (transfers)
+      fprintf(stderr, "fakei2c  %lu I2C_RDWR calls\n", transfers);
+}
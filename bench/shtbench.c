@@ -0,0 +1,265 @@
+/************************************************************************
+  Benchmark of the SHT21 read paths against simulated sensors
+
+  Compares the samples per second of the legacy SHT21_Read(), which
+  resets and sets up the sensor on every call, with a session opened
+  by SHT21_Open() and read through SHT21_ReadDev(). Both run the real
+  bit-bang code against the simulated peripheral block (bcm2835sim.c).
+  The session is also read over a bus with the pins fixed at build
+  time (i2cfix.h).
+  With -d the session is also read through the i2c-dev transport (run
+  with fakei2c.so preloaded, -b sets its byte time).
+
+  With -s a number of sensors is swept at the datasheet conversion
+  times, once reading one after the other with SHT21_ReadDev() and
+  once with SHT21_Sweep(), which overlaps the conversions, and once
+  more with SHT21_Sweep() at the lowest resolution (RH 8 bit, T 12 bit),
+  then at that resolution by two worker threads (SHT21_PoolSweep()),
+  one per GPFSEL register of the pins.
+
+  With -g the session is read through /dev/gpiochipN (run with
+  fakegpio.so preloaded, sensor on lines 0/1), and with -s as well the
+  sensors are read together by SHT21_ReadMulti() on that chip, sharing
+  SCL line 2 with SDA on lines 3, 4, ..., at the lowest resolution set
+  by SHT21_SetResolutionMulti().
+
+  Author: agent
+  
+  Usage: shtbench [-n samples] [-c conversion time us] [-b byte time us]
+                  [-d i2c adapter] [-g gpio chip] [-s sensors]
+  
+************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "sht21.h"
+#include "bcm2835sim.h"
+
+#define SI2C_FIX_SCL 0
+#define SI2C_FIX_SDA 1
+#include "i2cfix.h"
+
+#define SWEEP_MAX 16		/* sensors on GPIO 4/5, 6/7, ... 34/35 */
+
+static double now_s(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void report_sweep(const char *name, int n, int sensors, int errors, double t)
+{
+   printf("%-8s %6d sweeps  %8.3f s %10.1f ms/sweep  %4d errors (%d sensors)\n",
+          name, n, t, t * 1000 / n, errors, sensors);
+}
+
+static void report(const char *name, int n, int errors, double t)
+{
+   printf("%-8s %6d samples %8.3f s %10.1f samples/s %4d errors\n",
+          name, n, t, n / t, errors);
+}
+
+int main(int argc, char* argv[])
+{
+   SHT21_Dev dev;
+   SHT21_Dev sdev[SWEEP_MAX];
+   SHT21_Dev *sdevs[SWEEP_MAX];
+   int16_t stemp[SWEEP_MAX];
+   uint16_t shum[SWEEP_MAX];
+   uint8_t serr[SWEEP_MAX];
+   int sensors = 0;
+   int j, nsweep;
+   SHT21_Config cfg = { SHT21_TR_I2CDEV, 0, 0, 0, 0 };
+   int adapter = -1;
+   int chip = -1;
+   MI2C_Bus mbus;
+   SHT21_Pool pool;
+   uint8_t mscl = 2;
+   uint8_t msda[SWEEP_MAX];
+   char lines[8 + 8*SWEEP_MAX];
+   int16_t temperature = 0;
+   uint16_t humidity = 0;
+   int n = 100;
+   int i, opt, errors;
+   double t0, t_legacy, t_session, t_fixed, t_i2cdev, t_chip, t_seq, t_sweep, t_fast, t_pool;
+
+   /* Measure the protocol, not the conversions */
+   SIM_TempConvUs = SIM_HumConvUs = 0;
+   setenv("FAKEGPIO_CONV_US", "0", 1);
+
+   while ((opt = getopt(argc, argv, "n:c:b:d:g:s:")) != -1)
+   {
+      switch (opt)
+      {
+         case 'n': n = atoi(optarg); break;
+         case 'c':
+            SIM_TempConvUs = SIM_HumConvUs = atoi(optarg);
+            setenv("FAKEI2C_CONV_US", optarg, 1);
+            setenv("FAKEGPIO_CONV_US", optarg, 1);
+            break;
+         case 'b': setenv("FAKEI2C_BYTE_US", optarg, 1); break;
+         case 'd': adapter = atoi(optarg); break;
+         case 'g': chip = atoi(optarg); break;
+         case 's':
+            sensors = atoi(optarg);
+            if (sensors > SWEEP_MAX) sensors = SWEEP_MAX;
+            break;
+         default:
+            fprintf(stderr, "Usage: %s [-n samples] [-c conv us] [-b byte us] [-d adapter] [-g chip] [-s sensors]\n", argv[0]);
+            return 1;
+      }
+   }
+
+   SIM_AddSHT21(0, 1);
+
+   /* Legacy path */
+   SHT21_Init(0, 1);
+   errors = 0;
+   t0 = now_s();
+   for (i = 0; i < n; i++)
+      if (SHT21_Read(&temperature, &humidity)) errors++;
+   t_legacy = now_s() - t0;
+   report("legacy", n, errors, t_legacy);
+
+   /* Session path, setup time included */
+   errors = 0;
+   t0 = now_s();
+   if (SHT21_Open(&dev, 0, 1)) errors++;
+   for (i = 0; i < n; i++)
+      if (SHT21_ReadDev(&dev, &temperature, &humidity)) errors++;
+   t_session = now_s() - t0;
+   SHT21_Close(&dev);
+   report("session", n, errors, t_session);
+
+   /* Session path on the same pins fixed at build time */
+   SI2C_FixInit(0);
+   errors = 0;
+   t0 = now_s();
+   if (SHT21_OpenBus(&dev, SI2C_FixOps(), NULL)) errors++;
+   for (i = 0; i < n; i++)
+      if (SHT21_ReadDev(&dev, &temperature, &humidity)) errors++;
+   t_fixed = now_s() - t0;
+   SHT21_Close(&dev);
+   report("fixed", n, errors, t_fixed);
+
+   /* Session path over /dev/i2c-N */
+   if (adapter >= 0)
+   {
+      cfg.adapter = adapter;
+      errors = 0;
+      t0 = now_s();
+      if (SHT21_OpenConfig(&dev, &cfg)) errors++;
+      for (i = 0; i < n; i++)
+         if (SHT21_ReadDev(&dev, &temperature, &humidity)) errors++;
+      t_i2cdev = now_s() - t0;
+      SHT21_Close(&dev);
+      report("i2c-dev", n, errors, t_i2cdev);
+   }
+
+   /* Session path over /dev/gpiochipN, lines of the fake chip are
+      set up before its first ioctl */
+   if (chip >= 0)
+   {
+      j = snprintf(lines, sizeof(lines), "0:1");
+      for (i = 0; i < sensors; i++)
+      {
+         msda[i] = 3 + i;
+         j += snprintf(lines + j, sizeof(lines) - j, ",%d:%d", mscl, msda[i]);
+      }
+      setenv("FAKEGPIO_SENSORS", lines, 1);
+
+      cfg.transport = SHT21_TR_GPIOCHIP;
+      cfg.adapter = chip;
+      cfg.scl = 0;
+      cfg.sda = 1;
+      errors = 0;
+      t0 = now_s();
+      if (SHT21_OpenConfig(&dev, &cfg)) errors++;
+      for (i = 0; i < n; i++)
+         if (SHT21_ReadDev(&dev, &temperature, &humidity)) errors++;
+      t_chip = now_s() - t0;
+      SHT21_Close(&dev);
+      report("gpiochip", n, errors, t_chip);
+   }
+
+   printf("speedup  %.2fx  (T=%.1fC H=%.1f%%)\n",
+          t_legacy / t_session, temperature/10.0, humidity/10.0);
+
+   /* Several sensors, real conversion times */
+   if (sensors > 0)
+   {
+      SIM_TempConvUs = 85000;
+      SIM_HumConvUs = 29000;
+      nsweep = n / 20 ? n / 20 : 1;
+      errors = 0;
+      for (j = 0; j < sensors; j++)
+      {
+         SIM_AddSHT21(4 + 2*j, 5 + 2*j);
+         if (SHT21_Open(&sdev[j], 4 + 2*j, 5 + 2*j)) errors++;
+         sdevs[j] = &sdev[j];
+      }
+
+      t0 = now_s();
+      for (i = 0; i < nsweep; i++)
+         for (j = 0; j < sensors; j++)
+            if (SHT21_ReadDev(&sdev[j], &stemp[j], &shum[j])) errors++;
+      t_seq = now_s() - t0;
+      report_sweep("seq", nsweep, sensors, errors, t_seq);
+
+      errors = 0;
+      t0 = now_s();
+      for (i = 0; i < nsweep; i++)
+         if (SHT21_Sweep(sdevs, sensors, stemp, shum, serr)) errors++;
+      t_sweep = now_s() - t0;
+      report_sweep("sweep", nsweep, sensors, errors, t_sweep);
+
+      errors = 0;
+      for (j = 0; j < sensors; j++)
+         if (SHT21_SetResolution(&sdev[j], SHT21_RES_RH8_T12)) errors++;
+      t0 = now_s();
+      for (i = 0; i < nsweep; i++)
+         if (SHT21_Sweep(sdevs, sensors, stemp, shum, serr)) errors++;
+      t_fast = now_s() - t0;
+      report_sweep("sweep8", nsweep, sensors, errors, t_fast);
+
+      errors = 0;
+      t_pool = 0;
+      if (SHT21_PoolStart(&pool, 2, NULL) == 0)
+      {
+         t0 = now_s();
+         for (i = 0; i < nsweep; i++)
+            if (SHT21_PoolSweep(&pool, sdevs, sensors, stemp, shum, serr)) errors++;
+         t_pool = now_s() - t0;
+         SHT21_PoolStop(&pool);
+      }
+      else
+         errors++;
+      report_sweep("pool", nsweep, sensors, errors, t_pool);
+
+      for (j = 0; j < sensors; j++)
+         SHT21_Close(&sdev[j]);
+      printf("speedup  %.2fx  %.2fx at RH8/T12\n", t_seq / t_sweep, t_seq / t_fast);
+
+      /* All sensors in one transaction on the fake chip, protocol only */
+      if (chip >= 0)
+      {
+         errors = 0;
+         t0 = now_s();
+         if (SHT21_OpenMultiChip(&mbus, chip, &mscl, 1, msda, sensors)) errors++;
+         if (SHT21_SetResolutionMulti(&mbus, SHT21_RES_RH8_T12, serr)) errors++;
+         for (i = 0; i < n; i++)
+            if (SHT21_ReadMulti(&mbus, stemp, shum, serr)) errors++;
+         t_chip = now_s() - t0;
+         SHT21_CloseMulti(&mbus);
+         report_sweep("multi-gc", n, sensors, errors, t_chip);
+      }
+   }
+
+   SHT21_Cleanup();
+   return 0;
+}
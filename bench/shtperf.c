@@ -0,0 +1,524 @@
+/************************************************************************
+  Throughput and latency suite of the libsht transports
+
+  Measures for every transport that can be opened:
+    read_p50_us, read_p99_us, read_max_us   latency of SHT21_ReadDev()
+    read_per_s                              samples per second
+    bytes_per_s                             bus bytes per second of a
+                                            short transaction (read the
+                                            user register, 4 bytes)
+    edges_per_s                             SCL edges per second of that
+                                            transaction (18 per byte)
+  From the statistics of the session (SHT21_GetStats()):
+    xfer_p50_us, xfer_p99_us                transaction latency
+    stretch_max_us                          longest clock stretch
+    jitter_p99_us, jitter_max_us            transaction time above the
+                                            fastest run (bit-banged, -r)
+    retries, busy_polls                     setups repeated, results
+                                            polled too early
+  and for the multi-sensor paths (SHT21_Sweep() over separate buses,
+  SHT21_PoolSweep() with 1, 2 and 4 worker threads over the same buses,
+  SHT21_ReadMulti() on a parallel bus) the sensors read per second.
+  The separate buses are spread over the GPFSEL registers of GPIO 0-39,
+  so up to four of them can run in parallel.
+
+  A sweep waits for the conversions as long as the datasheet allows
+  (85 + 29 ms at full resolution), also when the simulation converts
+  faster, and it already overlaps the conversions of all its sensors.
+  So the sweep and pool rows are bound by the conversion time, more
+  workers cannot read more sensors per second. What the threads gain
+  on a bus-bound load is in the gpio-threadsN rows (xfers_per_s):
+  1, 2 and 4 threads, each reading the user register back to back on
+  its share of the same buses (sensor i on thread i % N). With a core
+  per thread and the buses in different registers this scales with N,
+  the number of cores is printed with the results.
+
+  Transports: gpio (bit-banged on the BCM2835 registers), gpio-legacy
+  (SHT21_Read()), bsc, i2c-dev polled and i2c-dev-hold in hold master
+  mode (-d, run with fakei2c.so preloaded on a host), gpiochip (-g, run
+  with fakegpio.so preloaded on a host). The
+  ones that cannot be opened are reported as skipped.
+
+  With -r cpu the suite runs in real-time mode (rt.h): pinned to the
+  core, SCHED_FIFO, memory locked, the gpio session busy-polls clock
+  stretching. Settings that were refused are reported.
+
+  Built with -DBCM2835_SIM (the default of the bench Makefile) the
+  BCM2835 transports run against the simulated peripheral block, with
+  conversion times of -c us (0 = protocol only), the bsc session on a
+  model of the BSC1 controller. Built without it, the
+  sensors are read on the real hardware (-p scl:sda, -s sensors on
+  the pin pairs scl+2:sda+2, scl+12:sda+12, scl+22:sda+22,
+  scl+32:sda+32, scl+4:sda+4, ...).
+
+  The pool workers run in real-time mode with -r as well, worker i
+  pinned to core cpu + i.
+
+  With -o the results are written as JSON for tracking between
+  releases:
+    { "library": "0.1", "backend": "sim", "samples": 200, "conv_us": 0,
+      "results": [ { "transport": "gpio", "metric": "read_p50_us",
+                     "value": 123.4 }, ... ] }
+
+  Author: agent
+
+  Usage: shtperf [-n samples] [-c conversion time us] [-p scl:sda]
+                 [-s sensors] [-d i2c adapter] [-g gpio chip] [-r cpu]
+                 [-o file]
+
+************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "sht21.h"
+#ifdef BCM2835_SIM
+#include "bcm2835sim.h"
+#endif
+
+#ifndef SHTLIB_VERSION
+#define SHTLIB_VERSION "unknown"
+#endif
+
+#ifdef BCM2835_SIM
+#define BACKEND "sim"
+#else
+#define BACKEND "bcm2835"
+#endif
+
+#define MAX_SENSORS 16
+#define MAX_RESULTS 128
+#define SHT21_ADDR  0x40
+#define CMD_RD_REG  0xE7
+
+typedef struct
+{
+   const char *transport;
+   const char *metric;
+   double value;
+} Result;
+
+/* A thread of the bus-bound rows */
+typedef struct
+{
+   pthread_t thread;
+   SHT21_Dev **devs;
+   int first;
+   int step;
+   int ndev;
+   int n;
+   int cpu;
+} BusWorker;
+
+static Result results[MAX_RESULTS];
+static int nresults;
+
+static double now_us(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static int cmp_double(const void *a, const void *b)
+{
+   double x = *(const double *)a;
+   double y = *(const double *)b;
+   return (x > y) - (x < y);
+}
+
+static void add(const char *transport, const char *metric, double value)
+{
+   if (nresults < MAX_RESULTS)
+   {
+      results[nresults].transport = transport;
+      results[nresults].metric = metric;
+      results[nresults].value = value;
+      nresults++;
+   }
+   printf("%-14s %-14s %12.1f\n", transport, metric, value);
+}
+
+static void skip(const char *transport, const char *why)
+{
+   printf("%-14s skipped (%s)\n", transport, why);
+}
+
+/* Latency of n reads, samples per second */
+static void measure_reads(const char *name, SHT21_Dev *dev, int legacy, int n, double *lat)
+{
+   int16_t temp;
+   uint16_t hum;
+   double t0, total = 0;
+   int i, errors = 0;
+
+   for (i = 0; i < n; i++)
+   {
+      t0 = now_us();
+      if (legacy ? SHT21_Read(&temp, &hum) : SHT21_ReadDev(dev, &temp, &hum)) errors++;
+      lat[i] = now_us() - t0;
+      total += lat[i];
+   }
+   qsort(lat, n, sizeof(double), cmp_double);
+   add(name, "read_p50_us", lat[n / 2]);
+   add(name, "read_p99_us", lat[(n * 99) / 100 < n ? (n * 99) / 100 : n - 1]);
+   add(name, "read_max_us", lat[n - 1]);
+   add(name, "read_per_s", n * 1e6 / total);
+   add(name, "read_errors", errors);
+}
+
+/* Bus throughput of a short transaction: address, command, address, register */
+static void measure_bus(const char *name, SHT21_Dev *dev, int n)
+{
+   uint8_t cmd = CMD_RD_REG;
+   uint8_t reg;
+   double t0, t;
+   int i;
+
+   t0 = now_us();
+   for (i = 0; i < n; i++)
+      I2C_WriteRead(&dev->bus, SHT21_ADDR, &cmd, 1, &reg, 1);
+   t = now_us() - t0;
+   add(name, "bytes_per_s", 4.0 * n * 1e6 / t);
+   add(name, "edges_per_s", 18 * 4.0 * n * 1e6 / t);
+}
+
+/* What the library counted itself */
+static void report_stats(const char *name, SHT21_Dev *dev)
+{
+   SHT21_Stats st;
+   I2C_Stats bus;
+
+   SHT21_GetStats(dev, &st, &bus);
+   add(name, "xfer_p50_us", STAT_Percentile(&bus.latency, 500));
+   add(name, "xfer_p99_us", STAT_Percentile(&bus.latency, 990));
+   add(name, "stretch_max_us", bus.stretch.max_us);
+   add(name, "jitter_p99_us", STAT_Percentile(&bus.jitter, 990));
+   add(name, "jitter_max_us", bus.jitter.max_us);
+   add(name, "retries", st.retries);
+   add(name, "busy_polls", st.busy_polls);
+}
+
+static int realtime;
+
+static void run_session(const char *name, const SHT21_Config *cfg, int n, double *lat)
+{
+   SHT21_Dev dev;
+
+   if (SHT21_OpenConfig(&dev, cfg))
+   {
+      skip(name, "not available");
+      return;
+   }
+   if (realtime)
+      SHT21_SetRealtime(&dev, 1);
+   measure_reads(name, &dev, 0, n, lat);
+   measure_bus(name, &dev, n);
+   report_stats(name, &dev);
+   SHT21_Close(&dev);
+}
+
+static void run_multi(const char *name, MI2C_Bus *bus, int sensors, int n)
+{
+   int16_t temp[MAX_SENSORS];
+   uint16_t hum[MAX_SENSORS];
+   uint8_t err[MAX_SENSORS];
+   double t0, t;
+   int i;
+
+   t0 = now_us();
+   for (i = 0; i < n; i++)
+      SHT21_ReadMulti(bus, temp, hum, err);
+   t = now_us() - t0;
+   add(name, "sensors_per_s", (double)n * sensors * 1e6 / t);
+}
+
+/* Reads of the user register on the buses first, first + step, ... */
+static void *bus_worker(void *arg)
+{
+   BusWorker *w = arg;
+   uint8_t cmd = CMD_RD_REG;
+   uint8_t reg;
+   RT_Config rt;
+   int i, k;
+
+   if (w->cpu >= 0)
+   {
+      RT_DefaultConfig(&rt, w->cpu);
+      RT_Enter(&rt);
+   }
+   for (i = 0; i < w->n; i++)
+      for (k = w->first; k < w->ndev; k += w->step)
+         I2C_WriteRead(&w->devs[k]->bus, SHT21_ADDR, &cmd, 1, &reg, 1);
+   if (w->cpu >= 0)
+      RT_Leave();
+   return NULL;
+}
+
+static void run_threads(const char *name, SHT21_Dev **devs, int ndev, int threads, int n, int cpu)
+{
+   BusWorker w[4];
+   double t0, t;
+   int i, started;
+
+   t0 = now_us();
+   for (i = 0; i < threads; i++)
+   {
+      w[i].devs = devs;
+      w[i].first = i;
+      w[i].step = threads;
+      w[i].ndev = ndev;
+      w[i].n = n;
+      w[i].cpu = cpu >= 0 ? cpu + i : -1;
+      if (pthread_create(&w[i].thread, NULL, bus_worker, &w[i]))
+         break;
+   }
+   started = i;
+   for (i = 0; i < started; i++)
+      pthread_join(w[i].thread, NULL);
+   t = now_us() - t0;
+   if (started < threads)
+      skip(name, "no threads");
+   else
+      add(name, "xfers_per_s", (double)n * ndev * 1e6 / t);
+}
+
+static void write_json(const char *file, int n, int conv)
+{
+   FILE *f = fopen(file, "w");
+   int i;
+
+   if (f == NULL)
+   {
+      perror(file);
+      return;
+   }
+   fprintf(f, "{ \"library\": \"%s\", \"backend\": \"%s\", \"samples\": %d, \"conv_us\": %d,\n",
+           SHTLIB_VERSION, BACKEND, n, conv);
+   fprintf(f, "  \"results\": [\n");
+   for (i = 0; i < nresults; i++)
+      fprintf(f, "    { \"transport\": \"%s\", \"metric\": \"%s\", \"value\": %.3f }%s\n",
+              results[i].transport, results[i].metric, results[i].value,
+              i + 1 < nresults ? "," : "");
+   fprintf(f, "  ]\n}\n");
+   fclose(f);
+}
+
+int main(int argc, char* argv[])
+{
+   SHT21_Config cfg;
+   SHT21_Dev sdev[MAX_SENSORS];
+   SHT21_Dev *sdevs[MAX_SENSORS];
+   int16_t temp[MAX_SENSORS];
+   uint16_t hum[MAX_SENSORS];
+   uint8_t err[MAX_SENSORS];
+   MI2C_Bus mbus;
+   uint8_t mscl;
+   uint8_t msda[MAX_SENSORS];
+   char lines[8 * MAX_SENSORS];
+   const char *out = NULL;
+   double *lat;
+   double t0, t;
+   int n = 200, conv = 0, sensors = 4;
+   int scl = 0, sda = 1;
+   int adapter = -1, chip = -1, cpu = -1;
+   RT_Config rt;
+   uint8_t rt_err;
+   SHT21_Pool pool;
+   static const char *pool_name[] = { "gpio-pool1", "gpio-pool2", "gpio-pool4" };
+   static const char *threads_name[] = { "gpio-threads1", "gpio-threads2", "gpio-threads4" };
+   int i, j, opt, nsweep, sscl;
+
+   while ((opt = getopt(argc, argv, "n:c:p:s:d:g:r:o:")) != -1)
+   {
+      switch (opt)
+      {
+         case 'n': n = atoi(optarg); break;
+         case 'c': conv = atoi(optarg); break;
+         case 'p':
+            if (sscanf(optarg, "%d:%d", &scl, &sda) != 2) n = 0;
+            break;
+         case 's': sensors = atoi(optarg); break;
+         case 'd': adapter = atoi(optarg); break;
+         case 'g': chip = atoi(optarg); break;
+         case 'r': cpu = atoi(optarg); break;
+         case 'o': out = optarg; break;
+         default: n = 0; break;
+      }
+   }
+   if (n <= 0 || sensors < 1 || sensors > MAX_SENSORS)
+   {
+      fprintf(stderr, "Usage: %s [-n samples] [-c conv us] [-p scl:sda] [-s sensors] "
+                      "[-d adapter] [-g chip] [-r cpu] [-o file]\n", argv[0]);
+      return 1;
+   }
+   lat = malloc(n * sizeof(double));
+   if (lat == NULL) return 1;
+
+   /* Same conversion time in the simulation and the stand-ins */
+   snprintf(lines, sizeof(lines), "%d", conv);
+   setenv("FAKEI2C_CONV_US", lines, 1);
+   setenv("FAKEGPIO_CONV_US", lines, 1);
+#ifdef BCM2835_SIM
+   SIM_TempConvUs = SIM_HumConvUs = conv;
+   SIM_AddSHT21(scl, sda);
+#endif
+
+   printf("libsht %s, backend %s, %d samples, conversion %d us, %ld cpus\n",
+          SHTLIB_VERSION, BACKEND, n, conv, sysconf(_SC_NPROCESSORS_ONLN));
+
+   if (cpu >= 0)
+   {
+      RT_DefaultConfig(&rt, cpu);
+      rt_err = RT_Enter(&rt);
+      printf("real-time mode on cpu %d%s%s%s\n", cpu,
+             rt_err & RT_ERR_AFFINITY ? ", not pinned" : "",
+             rt_err & RT_ERR_SCHED ? ", no SCHED_FIFO" : "",
+             rt_err & RT_ERR_MLOCK ? ", memory not locked" : "");
+      realtime = 1;
+   }
+
+   /* Bit-banged on the BCM2835 registers */
+   memset(&cfg, 0, sizeof(cfg));
+   cfg.transport = SHT21_TR_GPIO;
+   cfg.scl = scl;
+   cfg.sda = sda;
+   run_session("gpio", &cfg, n, lat);
+
+   if (SHT21_Init(scl, sda) == 0)
+      measure_reads("gpio-legacy", NULL, 1, n, lat);
+   else
+      skip("gpio-legacy", "not available");
+
+   /* Native controller on GPIO 2/3, the simulated sensor there goes
+      again before the separate buses use these pins */
+#ifdef BCM2835_SIM
+   SIM_AddSHT21(3, 2);
+#endif
+   cfg.transport = SHT21_TR_BSC;
+   run_session("bsc", &cfg, n, lat);
+#ifdef BCM2835_SIM
+   SIM_Clear();
+#endif
+
+   if (adapter >= 0)
+   {
+      cfg.transport = SHT21_TR_I2CDEV;
+      cfg.adapter = adapter;
+      cfg.hold = SHT21_HOLD_OFF;
+      run_session("i2c-dev", &cfg, n, lat);
+      cfg.hold = SHT21_HOLD_ON;
+      run_session("i2c-dev-hold", &cfg, n, lat);
+      cfg.hold = SHT21_HOLD_AUTO;
+   }
+   else
+   {
+      skip("i2c-dev", "no -d");
+      skip("i2c-dev-hold", "no -d");
+   }
+
+   /* Lines of the (fake) chip: the session sensor on 0/1, the parallel
+      bus shares SCL line 2 with SDA on lines 3, 4, ... */
+   mscl = 2;
+   j = snprintf(lines, sizeof(lines), "0:1");
+   for (i = 0; i < sensors; i++)
+   {
+      msda[i] = 3 + i;
+      j += snprintf(lines + j, sizeof(lines) - j, ",2:%d", msda[i]);
+   }
+   setenv("FAKEGPIO_SENSORS", lines, 1);
+   if (chip >= 0)
+   {
+      cfg.transport = SHT21_TR_GPIOCHIP;
+      cfg.adapter = chip;
+      cfg.scl = 0;
+      cfg.sda = 1;
+      run_session("gpiochip", &cfg, n, lat);
+   }
+   else
+      skip("gpiochip", "no -g");
+
+   /* Several sensors on separate buses, the pin pairs after scl:sda in
+      GPIO 0-9, 10-19, 20-29, 30-39 in turn */
+   nsweep = n / 10 ? n / 10 : 1;
+   for (i = 0; i < sensors; i++)
+   {
+      sscl = scl + 10 * (i % 4) + 2 + 2 * (i / 4);
+#ifdef BCM2835_SIM
+      SIM_AddSHT21(sscl, sscl + sda - scl);
+#endif
+      SHT21_Open(&sdev[i], sscl, sscl + sda - scl);
+      sdevs[i] = &sdev[i];
+   }
+   t0 = now_us();
+   for (i = 0; i < nsweep; i++)
+      SHT21_Sweep(sdevs, sensors, temp, hum, err);
+   t = now_us() - t0;
+   add("gpio-sweep", "sensors_per_s", (double)nsweep * sensors * 1e6 / t);
+
+   /* The same buses from worker threads */
+   for (j = 0; j < 3; j++)
+   {
+      if (SHT21_PoolStart(&pool, 1 << j, realtime ? &rt : NULL))
+      {
+         skip(pool_name[j], "no threads");
+         continue;
+      }
+      t0 = now_us();
+      for (i = 0; i < nsweep; i++)
+         SHT21_PoolSweep(&pool, sdevs, sensors, temp, hum, err);
+      t = now_us() - t0;
+      SHT21_PoolStop(&pool);
+      add(pool_name[j], "sensors_per_s", (double)nsweep * sensors * 1e6 / t);
+   }
+
+   /* The same buses bus-bound, from 1, 2 and 4 threads */
+   for (j = 0; j < 3; j++)
+      run_threads(threads_name[j], sdevs, sensors, 1 << j, n, realtime ? cpu : -1);
+   for (i = 0; i < sensors; i++)
+      SHT21_Close(&sdev[i]);
+
+   /* Parallel bus on the BCM2835 registers, simulated sensors on SCL 40
+      and SDA 41, 42, ... (one bank) */
+#ifdef BCM2835_SIM
+   mscl = 40;
+   for (i = 0; i < sensors && 41 + i < 54; i++)
+   {
+      msda[i] = 41 + i;
+      SIM_AddSHT21(mscl, msda[i]);
+   }
+   if (SHT21_OpenMulti(&mbus, &mscl, 1, msda, i) == 0)
+      run_multi("gpio-multi", &mbus, i, nsweep);
+   else
+      skip("gpio-multi", "not available");
+#else
+   skip("gpio-multi", "simulation only");
+#endif
+
+   if (chip >= 0)
+   {
+      mscl = 2;
+      for (i = 0; i < sensors; i++)
+         msda[i] = 3 + i;
+      if (SHT21_OpenMultiChip(&mbus, chip, &mscl, 1, msda, sensors) == 0)
+      {
+         run_multi("gpiochip-multi", &mbus, sensors, nsweep);
+         SHT21_CloseMulti(&mbus);
+      }
+      else
+         skip("gpiochip-multi", "not available");
+   }
+
+   SHT21_Cleanup();
+   if (realtime)
+      RT_Leave();
+   if (out)
+      write_json(out, n, conv);
+   free(lat);
+   return 0;
+}
@@ -0,0 +1,150 @@
+/************************************************************************
+  Simulated bus for the libsht benchmarks
+
+  An I2C transport (SIMBUS_Ops) with a byte level model of an SHT21
+  sensor behind it, so the protocol overhead of sht21.c can be
+  measured on any host. Every transferred byte, address included,
+  costs the time it would take at 100 kHz, and measurements take
+  SIMBUS_ConvTime microseconds (0 = instant).
+  All sessions share the same simulated sensor.
+
+  Author: agent
+  
+************************************************************************/
+
+#include <stdint.h>
+#include <time.h>
+
+#include "i2cbus.h"
+#include "simbus.h"
+
+#define SIM_ADDR      0x40
+#define SIM_USER_REG  0x02
+
+/* Raw sensor values: 23.4C / 46.0%RH */
+#define SIM_RAW_TMP   0x6668
+#define SIM_RAW_HUM   0x6A96
+
+uint32_t SIMBUS_ByteTime = 90;
+uint32_t SIMBUS_ConvTime = 0;
+
+static uint8_t  cmd;
+static uint8_t  user_reg = SIM_USER_REG;
+static uint8_t  tx[3];
+static uint64_t ready_at;
+
+static uint64_t now_us(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void bus_time(uint32_t us)
+{
+   uint64_t end = now_us() + us;
+   while (now_us() < end);
+}
+
+static uint8_t crc8(const uint8_t *data, uint8_t len)
+{
+   uint8_t crc = 0;
+   uint8_t bit;
+   
+   while (len--)
+   {
+      crc ^= *data++;
+      for (bit = 8; bit > 0; --bit)
+         crc = (crc & 0x80) ? (crc << 1) ^ 0x31 : (crc << 1);
+   }
+   return crc;
+}
+
+static void load_value(uint16_t raw)
+{
+   tx[0] = raw >> 8;
+   tx[1] = raw & 0xFF;
+   tx[2] = crc8(tx, 2);
+}
+
+static void command(uint8_t c)
+{
+   cmd = c;
+   switch (c)
+   {
+      case 0xFE: user_reg = SIM_USER_REG; break;
+      case 0xE3: case 0xF3:
+         load_value(SIM_RAW_TMP);
+         ready_at = now_us() + SIMBUS_ConvTime;
+         break;
+      case 0xE5: case 0xF5:
+         load_value(SIM_RAW_HUM | 0x02);
+         ready_at = now_us() + SIMBUS_ConvTime;
+         break;
+      case 0xE7:
+         tx[0] = user_reg;
+         tx[1] = crc8(tx, 1);
+         break;
+   }
+}
+
+static uint8_t sim_write(void *ctx, uint8_t addr, const uint8_t *buf, uint8_t len)
+{
+   (void)ctx;
+   bus_time(SIMBUS_ByteTime);
+   if (addr != SIM_ADDR)
+      return I2C_ERR_NACK;
+   
+   bus_time(SIMBUS_ByteTime * len);
+   if (len > 0)
+      command(buf[0]);
+   if (len > 1 && buf[0] == 0xE6)
+      user_reg = buf[1];
+   return 0;
+}
+
+static uint8_t sim_read(void *ctx, uint8_t addr, uint8_t *buf, uint8_t len)
+{
+   uint8_t i;
+   
+   (void)ctx;
+   bus_time(SIMBUS_ByteTime);
+   if (addr != SIM_ADDR)
+      return I2C_ERR_NACK;
+   
+   /* No hold master: not acknowledged while converting */
+   if ((cmd == 0xF3 || cmd == 0xF5) && now_us() < ready_at)
+      return I2C_ERR_NACK;
+   
+   bus_time(SIMBUS_ByteTime * len);
+   for (i = 0; i < len; i++)
+      buf[i] = (i < sizeof(tx)) ? tx[i] : 0xFF;
+   return 0;
+}
+
+static uint8_t sim_transfer(void *ctx, I2C_Msg *msgs, uint8_t n)
+{
+   uint8_t error = 0;
+   uint8_t i;
+   
+   for (i = 0; i < n && !error; i++)
+   {
+      if (msgs[i].flags & I2C_MSG_RD)
+      {
+         /* Hold master: sensor stretches the clock until the conversion is done */
+         if (i > 0)
+            while (now_us() < ready_at);
+         error = sim_read(ctx, msgs[i].addr, msgs[i].buf, msgs[i].len);
+      }
+      else
+         error = sim_write(ctx, msgs[i].addr, msgs[i].buf, msgs[i].len);
+   }
+   return error;
+}
+
+const I2C_Ops SIMBUS_Ops =
+{
+   "sim",
+   1,
+   sim_transfer
+};
@@ -0,0 +1,23 @@
+/************************************************************************
+  Simulated bus for the libsht benchmarks, see simbus.c
+
+  Author: agent
+  
+************************************************************************/
+
+#ifndef SIMBUS_H
+#define SIMBUS_H
+
+#include <stdint.h>
+#include "i2cbus.h"
+
+/* Bus time per transferred byte in microseconds (90 = 100 kHz) */
+extern uint32_t SIMBUS_ByteTime;
+
+/* Conversion time of a measurement in microseconds (0 = instant) */
+extern uint32_t SIMBUS_ConvTime;
+
+/* Transport to the simulated sensor, context is not used */
+extern const I2C_Ops SIMBUS_Ops;
+
+#endif
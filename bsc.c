@@ -0,0 +1,178 @@
+//--------------------------------------------------------------------------------------------------
+//
+// Filename:    bsc.c
+// Description: I2C over the BSC controller of the BCM2835 (native I2C)
+//              Whole transfers are handed to the controller FIFO, the CPU does not toggle any
+//              pin. The controller does not handle long clock stretching reliably, so devices
+//              have to be used in no hold master mode (I2C_Ops.stretch = 0).
+//
+// Open Source Licensing 
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// Author:      agent
+// History:     17.10.2026 Initial version
+//              17.10.2026 Whole transactions through BSC_Transfer()
+//--------------------------------------------------------------------------------------------------
+
+//=== Includes =====================================================================================
+
+#include <stdint.h>
+#include <pthread.h>
+#include "bsc.h"
+#include "bcm2835.h"
+
+//=== Preprocessing directives (#define) ===========================================================
+
+//=== Type definitions (typedef) ===================================================================
+
+//=== Global constants =============================================================================
+
+const I2C_Ops BSC_Ops =
+{
+   "bsc",
+   0,
+   BSC_Transfer
+};
+
+//=== Global variables =============================================================================
+
+//=== Local constants  =============================================================================
+
+//=== Local variables ==============================================================================
+
+// There is one controller for all buses, a transfer holds it from address to stop
+static pthread_mutex_t bsc_lock = PTHREAD_MUTEX_INITIALIZER;
+static uint32_t bsc_users;		// number of open buses
+static uint32_t bsc_baudrate;		// clock currently programmed
+
+//=== Local function prototypes ====================================================================
+
+static void BSC_Select(BSC_Bus *bus,uint8_t addr);
+static uint8_t BSC_Error(uint8_t reason);
+
+//--------------------------------------------------------------------------------------------------
+// Name:	BSC_Init
+// Function:  	Take the controller into use, switching its pins to I2C on the first call
+//		bcm2835_init() must have been successful (as root).
+//            
+// Parameter: 	bus, clock frequency in Hz (0 = BSC_DEFAULT_HZ)
+// Return:    	0=OK 1=controller not accessible
+//--------------------------------------------------------------------------------------------------
+uint8_t BSC_Init(BSC_Bus *bus,uint32_t Hz)
+{
+   uint8_t error = 0;
+   
+   bus->baudrate = Hz ? Hz : BSC_DEFAULT_HZ;
+   
+   pthread_mutex_lock(&bsc_lock);
+   if(bsc_users == 0)
+   {
+      if(bcm2835_i2c_begin()) bsc_baudrate = 0;
+      else error = 1;
+   }
+   if(!error) bsc_users++;
+   pthread_mutex_unlock(&bsc_lock);
+   
+   return error;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Name:	BSC_Close
+// Function:  	Stop using the controller, its pins are released with the last bus
+//            
+// Parameter: 	bus
+// Return:    	-
+//--------------------------------------------------------------------------------------------------
+void BSC_Close(BSC_Bus *bus)
+{
+   (void)bus;
+   
+   pthread_mutex_lock(&bsc_lock);
+   if(bsc_users && --bsc_users == 0) bcm2835_i2c_end();
+   pthread_mutex_unlock(&bsc_lock);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Name:	BSC_Transfer
+// Function:  	Transport operation: run segments as one transaction
+//		The controller produces a repeated start only between a write and a read segment
+//		to the same device (write_read_rs), any other segments are separated by a STOP.
+//		Clock stretching is limited by the controller's CLKT timeout.
+//            
+// Parameter: 	bus, segments, number of segments
+// Return:    	I2C_ERR_xxx bits, 0 = OK
+//--------------------------------------------------------------------------------------------------
+uint8_t BSC_Transfer(void *ctx,I2C_Msg *msgs,uint8_t n)
+{
+   uint8_t reason = BCM2835_I2C_REASON_OK;
+   uint8_t i;
+   
+   pthread_mutex_lock(&bsc_lock);
+   for(i=0;i<n && reason == BCM2835_I2C_REASON_OK;i++)
+   {
+      BSC_Select(ctx,msgs[i].addr);
+      if(msgs[i].flags & I2C_MSG_RD)
+      {
+         reason = bcm2835_i2c_read((char *)msgs[i].buf,msgs[i].len);
+      }
+      else if(i + 1 < n && (msgs[i+1].flags & I2C_MSG_RD) && msgs[i+1].addr == msgs[i].addr)
+      {
+         reason = bcm2835_i2c_write_read_rs((char *)msgs[i].buf,msgs[i].len,
+                                            (char *)msgs[i+1].buf,msgs[i+1].len);
+         i++;
+      }
+      else
+      {
+         reason = bcm2835_i2c_write((const char *)msgs[i].buf,msgs[i].len);
+      }
+   }
+   pthread_mutex_unlock(&bsc_lock);
+   
+   return BSC_Error(reason);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Name:	BSC_Select
+// Function:  	Program clock and slave address for the next transfer (lock held)
+//            
+// Parameter: 	bus, 7 bit address
+// Return:    	-
+//--------------------------------------------------------------------------------------------------
+static void BSC_Select(BSC_Bus *bus,uint8_t addr)
+{
+   if(bus->baudrate != bsc_baudrate)
+   {
+      bcm2835_i2c_set_baudrate(bus->baudrate);
+      bsc_baudrate = bus->baudrate;
+   }
+   bcm2835_i2c_setSlaveAddress(addr);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Name:	BSC_Error
+// Function:  	Translate a bcm2835 I2C reason code
+//            
+// Parameter: 	BCM2835_I2C_REASON_xxx
+// Return:    	I2C_ERR_xxx bits
+//--------------------------------------------------------------------------------------------------
+static uint8_t BSC_Error(uint8_t reason)
+{
+   uint8_t error = 0;
+   
+   if(reason & BCM2835_I2C_REASON_ERROR_NACK) error |= I2C_ERR_NACK;
+   if(reason & BCM2835_I2C_REASON_ERROR_CLKT) error |= I2C_ERR_TIMEOUT;
+   if(reason & BCM2835_I2C_REASON_ERROR_DATA) error |= I2C_ERR_BUS;
+   return error;
+}
@@ -0,0 +1,46 @@
+//--------------------------------------------------------------------------------------------------
+//
+// Filename:    bsc.h
+// Description: I2C over the BSC controller of the BCM2835 (native I2C)
+//              
+// Author:      agent
+// History:     17.10.2026 Initial version
+//              17.10.2026 Whole transactions through BSC_Transfer()
+//--------------------------------------------------------------------------------------------------
+
+#ifndef BSC_H
+#define BSC_H
+
+//=== Includes =====================================================================================	
+
+#include <stdint.h>
+#include "i2cbus.h"
+
+//=== Preprocessing directives (#define) ===========================================================
+
+#define BSC_DEFAULT_HZ	100000		// standard mode clock, used if none is given
+
+//=== Type definitions (typedef) ===================================================================
+
+// The BSC controller is on GPIO 2 (SDA) and 3 (SCL). Several sensors can share it, each with
+// its own clock frequency. The registers are only accessible as root (/dev/mem).
+
+typedef struct
+{
+   uint32_t baudrate;		// clock frequency in Hz
+} BSC_Bus;
+
+//=== Global constants (extern) ====================================================================
+
+extern const I2C_Ops BSC_Ops;		// transport operations, context is a BSC_Bus
+
+//=== Global variables (extern) ====================================================================
+
+//=== Global function prototypes ===================================================================
+
+uint8_t BSC_Init(BSC_Bus *bus,uint32_t Hz);
+void    BSC_Close(BSC_Bus *bus);
+
+uint8_t BSC_Transfer(void *ctx,I2C_Msg *msgs,uint8_t n);
+
+#endif
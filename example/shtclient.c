@@ -0,0 +1,94 @@
+/************************************************************************
+  Client of the SHT21 sampling daemon shtd
+
+  Reads the samples shtd publishes in shared memory. After attaching,
+  no system call and no bus access is needed to get a value, so any
+  number of clients can poll as often as they like.
+
+  Author: agent
+  
+  Build command (make sure to have shtlib built and installed):
+  gcc -o shtclient shtclient.c -lsht -lrt
+  
+  Usage: shtclient [-s sensor] [-H] [-f] [-m name]
+    -s  newest sample of this sensor (default 0)
+    -H  print the whole history kept in the ring
+    -f  follow, print new samples as they are published
+  
+************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "shmring.h"
+
+static void print_sample(const SHMR_Sample *s)
+{
+   printf("%llu.%03u\t%u\t", (unsigned long long)(s->time_us / 1000000),
+          (unsigned int)(s->time_us % 1000000 / 1000), s->sensor);
+   if (s->error == 0)
+      printf("T=%.1fC\tH=%.1f%%\n", s->temp/10.0, s->humidity/10.0);
+   else
+      printf("ERROR 0x%X reading sensor\n", s->error);
+}
+
+int main(int argc, char* argv[])
+{
+   SHMR_Handle ring;
+   SHMR_Sample s[64];
+   const char *name = SHMR_DEFAULT_NAME;
+   uint64_t pos;
+   uint32_t i, cnt;
+   int sensor = 0;
+   int history = 0;
+   int follow = 0;
+   int opt;
+
+   while ((opt = getopt(argc, argv, "s:Hfm:")) != -1)
+   {
+      switch (opt)
+      {
+         case 's': sensor = atoi(optarg); break;
+         case 'H': history = 1; break;
+         case 'f': follow = 1; break;
+         case 'm': name = optarg; break;
+         default:
+            fprintf(stderr, "Usage: %s [-s sensor] [-H] [-f] [-m name]\n", argv[0]);
+            return 1;
+      }
+   }
+   
+   if (SHMR_Attach(&ring, name) != 0)
+   {
+      printf("ERROR attaching to %s, is shtd running?\n", name);
+      return -1;
+   }
+   
+   if (!history && !follow)
+   {
+      if (SHMR_Latest(&ring, sensor, &s[0]) == 0)
+         print_sample(&s[0]);
+      else
+         printf("No sample of sensor %d yet\n", sensor);
+      SHMR_Close(&ring);
+      return 0;
+   }
+   
+   pos = history ? 0 : SHMR_Head(&ring);
+   do
+   {
+      while ((cnt = SHMR_ReadFrom(&ring, &pos, s, 64)) > 0)
+      {
+         for (i = 0; i < cnt; i++)
+            print_sample(&s[i]);
+      }
+      fflush(stdout);
+      if (follow) usleep(100000);
+   } while (follow);
+   
+   SHMR_Close(&ring);
+   return 0;
+}
@@ -0,0 +1,237 @@
+/************************************************************************
+  Sampling daemon for the SHT21 Temperature & Humidity Sensor library
+  for use on the RaspberryPi Single Board Computer
+
+  Owns the sensors and publishes a timestamped sample of each of them
+  per period into a ring buffer in shared memory (see shmring.h).
+  Any number of clients read the newest values or the history from
+  there without touching the bus, see shtclient.c.
+
+  The sensors are read with SHT21_Sweep(), which overlaps their
+  conversions, so a period costs one temperature and one humidity
+  conversion however many sensors there are. A sensor whose transport
+  cannot be opened (e.g. a missing /dev/i2c-N) is left out of the sweep
+  and opened again every period, its samples carry SHT21_ERR_NACK
+  meanwhile.
+
+  Author: agent
+  
+  Build command (make sure to have shtlib built and installed):
+  gcc -o shtd shtd.c -lsht -lrt
+  
+  Usage: shtd [-s scl:sda]... [-d adapter]... [-p period_ms]
+              [-r slots] [-m name] [-t trace file] [-R cpu]
+  Without -s or -d one sensor on SCL 45 / SDA 44 is used.
+  With -t the bus trace (library built with make TRACE=1) is written
+  to the file on SIGUSR1 and at exit, see shttrace.c.
+  With -R the daemon runs in real-time mode on the core (see rt.h),
+  best one reserved with isolcpus=, so it is not preempted in the
+  middle of a transaction.
+  
+************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "sht21.h"
+#include "shmring.h"
+#include "trace.h"
+
+#define SDA_PIN 44
+#define SCL_PIN 45
+
+#define MAX_SENSORS 8
+
+static SHT21_Dev dev[MAX_SENSORS];
+static SHT21_Config cfg[MAX_SENSORS];
+static volatile sig_atomic_t stop;
+static volatile sig_atomic_t save_trace;
+
+/* Open sensor i, 0 if its transport could not be opened */
+static int open_sensor(int i, int cpu)
+{
+   if (SHT21_OpenConfig(&dev[i], &cfg[i]) != 0)
+   {
+      if (dev[i].transport == SHT21_TR_NONE)
+         return 0;
+      fprintf(stderr, "WARNING: sensor %d not responding\n", i);
+   }
+   if (cpu >= 0)
+      SHT21_SetRealtime(&dev[i], 1);
+   return 1;
+}
+
+static void on_signal(int sig)
+{
+   if (sig == SIGUSR1)
+      save_trace = 1;
+   else
+      stop = 1;
+}
+
+int main(int argc, char* argv[])
+{
+   SHT21_Dev *devs[MAX_SENSORS];
+   SHMR_Sample sample = { 0 };
+   SHMR_Handle ring;
+   int16_t temp[MAX_SENSORS];
+   uint16_t humidity[MAX_SENSORS];
+   uint8_t errors[MAX_SENSORS];
+   int idx[MAX_SENSORS];
+   int16_t stemp[MAX_SENSORS];
+   uint16_t shum[MAX_SENSORS];
+   uint8_t serr[MAX_SENSORS];
+   struct timespec next, now;
+   const char *name = SHMR_DEFAULT_NAME;
+   const char *trace = NULL;
+   RT_Config rt;
+   int cpu = -1;
+   uint32_t slots = SHMR_DEFAULT_SLOTS;
+   long period = 1000;
+   int n = 0;
+   int i, m, opt;
+   unsigned int scl, sda;
+
+   while ((opt = getopt(argc, argv, "s:d:p:r:m:t:R:")) != -1)
+   {
+      if ((opt == 's' || opt == 'd') && n == MAX_SENSORS)
+      {
+         fprintf(stderr, "At most %d sensors\n", MAX_SENSORS);
+         return 1;
+      }
+      switch (opt)
+      {
+         case 's':
+            if (sscanf(optarg, "%u:%u", &scl, &sda) != 2) goto usage;
+            cfg[n].transport = SHT21_TR_GPIO;
+            cfg[n].scl = scl;
+            cfg[n].sda = sda;
+            n++;
+            break;
+         case 'd':
+            cfg[n].transport = SHT21_TR_I2CDEV;
+            cfg[n].adapter = atoi(optarg);
+            n++;
+            break;
+         case 'p': period = atol(optarg); break;
+         case 'r': slots = atol(optarg); break;
+         case 'm': name = optarg; break;
+         case 't': trace = optarg; break;
+         case 'R': cpu = atoi(optarg); break;
+         default:
+            goto usage;
+      }
+   }
+   if (period <= 0) goto usage;
+   
+   if (n == 0)
+   {
+      cfg[0].transport = SHT21_TR_GPIO;
+      cfg[0].scl = SCL_PIN;
+      cfg[0].sda = SDA_PIN;
+      n = 1;
+   }
+
+   /* Sensors that do not answer here are set up again on the first read */
+   for (i = 0; i < n; i++)
+   {
+      if (!open_sensor(i, cpu))
+         fprintf(stderr, "WARNING: sensor %d not available, retrying every period\n", i);
+   }
+   
+   if (cpu >= 0)
+   {
+      RT_DefaultConfig(&rt, cpu);
+      if (RT_Enter(&rt) != 0)
+         fprintf(stderr, "WARNING: real-time mode not fully granted\n");
+   }
+   
+   if (SHMR_Create(&ring, name, slots) != 0)
+   {
+      fprintf(stderr, "ERROR creating shared memory %s\n", name);
+      return 1;
+   }
+   
+   signal(SIGINT, on_signal);
+   signal(SIGTERM, on_signal);
+   signal(SIGUSR1, on_signal);
+   
+   clock_gettime(CLOCK_MONOTONIC, &next);
+   while (!stop)
+   {
+      /* Sweep the open sensors, retry opening the others */
+      for (i = 0, m = 0; i < n; i++)
+      {
+         if (dev[i].transport != SHT21_TR_NONE || open_sensor(i, cpu))
+         {
+            idx[m] = i;
+            devs[m++] = &dev[i];
+         }
+         else
+         {
+            temp[i] = 0;
+            humidity[i] = 0;
+            errors[i] = SHT21_ERR_NACK;
+         }
+      }
+      if (m)
+      {
+         SHT21_Sweep(devs, m, stemp, shum, serr);
+         for (i = 0; i < m; i++)
+         {
+            temp[idx[i]] = stemp[i];
+            humidity[idx[i]] = shum[i];
+            errors[idx[i]] = serr[i];
+         }
+      }
+      
+      if (save_trace && trace)
+      {
+         save_trace = 0;
+         if (TRACE_Save(trace) != 0)
+            fprintf(stderr, "ERROR writing trace %s\n", trace);
+      }
+      
+      clock_gettime(CLOCK_REALTIME, &now);
+      for (i = 0; i < n; i++)
+      {
+         sample.time_us = now.tv_sec * 1000000ULL + now.tv_nsec / 1000;
+         sample.sensor = i;
+         sample.error = errors[i];
+         sample.temp = temp[i];
+         sample.humidity = humidity[i];
+         SHMR_Publish(&ring, &sample);
+      }
+      
+      next.tv_sec += period / 1000;
+      next.tv_nsec += (period % 1000) * 1000000;
+      if (next.tv_nsec >= 1000000000)
+      {
+         next.tv_sec++;
+         next.tv_nsec -= 1000000000;
+      }
+      clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+   }
+   
+   if (trace && TRACE_Save(trace) != 0)
+      fprintf(stderr, "ERROR writing trace %s\n", trace);
+   SHMR_Unlink(name);
+   SHMR_Close(&ring);
+   for (i = 0; i < n; i++)
+   {
+      if (dev[i].transport != SHT21_TR_NONE)
+         SHT21_Close(&dev[i]);
+   }
+   SHT21_Cleanup();
+   return 0;
+
+usage:
+   fprintf(stderr, "Usage: %s [-s scl:sda]... [-d adapter]... [-p period_ms] "
+                   "[-r slots] [-m name] [-t trace file] [-R cpu]\n", argv[0]);
+   return 1;
+}
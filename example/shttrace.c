@@ -0,0 +1,210 @@
+/************************************************************************
+  Decoder of the bus traces of the SHT21 library
+
+  Prints a trace written by TRACE_Save() (library built with
+  make TRACE=1) as text, one event per line, or as a VCD file for a
+  waveform viewer such as GTKWave. In the VCD every bus (named after
+  its clock pin) has the signals
+    busy     1 from START to STOP
+    stretch  1 while the device holds the clock low
+    ack      acknowledge of the last byte (0 = ACK, 1 = NACK)
+    wr, rd   last byte written / read
+  Times are in us, relative to the first event.
+
+  Author: agent
+
+  Build command (make sure to have shtlib built and installed):
+  gcc -o shttrace shttrace.c -lsht
+
+  Usage: shttrace [-v] file
+    -v  write VCD instead of text
+
+************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "trace.h"
+
+#define MAX_BUSES 32
+
+/* Signals of a bus in the VCD */
+#define SIG_BUSY    0
+#define SIG_STRETCH 1
+#define SIG_ACK     2
+#define SIG_WR      3
+#define SIG_RD      4
+#define SIGNALS     5
+
+static TRACE_Event ev[TRACE_SLOTS];
+static uint32_t order[TRACE_SLOTS];
+
+/* Events of one transaction are not recorded in time order, sort them */
+static int cmp_time(const void *a, const void *b)
+{
+   const TRACE_Event *x = &ev[*(const uint32_t *)a];
+   const TRACE_Event *y = &ev[*(const uint32_t *)b];
+
+   if (x->time_us != y->time_us)
+      return (x->time_us > y->time_us) - (x->time_us < y->time_us);
+   return (*(const uint32_t *)a > *(const uint32_t *)b) - (*(const uint32_t *)a < *(const uint32_t *)b);
+}
+
+static void print_text(uint32_t n)
+{
+   uint64_t t0 = ev[order[0]].time_us;
+   uint64_t prev = t0;
+   uint64_t stretch[256] = { 0 };
+   TRACE_Event *e;
+   uint32_t i;
+
+   printf("%12s %8s %4s  event\n", "time_us", "delta", "bus");
+   for (i = 0; i < n; i++)
+   {
+      e = &ev[order[i]];
+      printf("%12llu %+8lld %4u  ", (unsigned long long)(e->time_us - t0),
+             (long long)(e->time_us - prev), e->bus);
+      prev = e->time_us;
+      switch (e->type)
+      {
+         case TRACE_START:   printf("START\n"); break;
+         case TRACE_STOP:    printf("STOP\n"); break;
+         case TRACE_WRITE:   printf("W 0x%02X %s\n", e->data, e->ack ? "NACK" : "ACK"); break;
+         case TRACE_READ:    printf("R 0x%02X %s\n", e->data, e->ack ? "NACK" : "ACK"); break;
+         case TRACE_STRETCH:
+            stretch[e->bus] = e->time_us;
+            printf("STRETCH\n");
+            break;
+         case TRACE_RELEASE:
+         case TRACE_TIMEOUT:
+            printf("%s (%llu us)\n", e->type == TRACE_RELEASE ? "RELEASE" : "TIMEOUT",
+                   (unsigned long long)(e->time_us - stretch[e->bus]));
+            break;
+         default:            printf("? %u\n", e->type); break;
+      }
+   }
+}
+
+static void vcd_bit(int bus, int sig, int v)
+{
+   printf("%d%c%c\n", v, '!' + bus, 'a' + sig);
+}
+
+static void vcd_byte(int bus, int sig, uint8_t v)
+{
+   int b;
+
+   putchar('b');
+   for (b = 7; b >= 0; b--)
+      putchar('0' + ((v >> b) & 1));
+   printf(" %c%c\n", '!' + bus, 'a' + sig);
+}
+
+static void print_vcd(uint32_t n)
+{
+   static const char *names[SIGNALS] = { "busy", "stretch", "ack", "wr", "rd" };
+   uint8_t pin[MAX_BUSES];
+   int idx[256];
+   int nbus = 0;
+   uint64_t t0 = ev[order[0]].time_us;
+   uint64_t last = ~0ULL;
+   TRACE_Event *e;
+   uint32_t i;
+   int b, s;
+
+   memset(idx, -1, sizeof(idx));
+   for (i = 0; i < n; i++)
+   {
+      if (idx[ev[i].bus] < 0 && nbus < MAX_BUSES)
+      {
+         idx[ev[i].bus] = nbus;
+         pin[nbus++] = ev[i].bus;
+      }
+   }
+
+   printf("$timescale 1 us $end\n");
+   printf("$scope module shtlib $end\n");
+   for (b = 0; b < nbus; b++)
+   {
+      printf("$scope module gpio%u $end\n", pin[b]);
+      for (s = 0; s < SIGNALS; s++)
+         printf("$var %s %d %c%c %s $end\n", s < SIG_WR ? "wire" : "reg",
+                s < SIG_WR ? 1 : 8, '!' + b, 'a' + s, names[s]);
+      printf("$upscope $end\n");
+   }
+   printf("$upscope $end\n$enddefinitions $end\n#0\n$dumpvars\n");
+   for (b = 0; b < nbus; b++)
+   {
+      vcd_bit(b, SIG_BUSY, 0);
+      vcd_bit(b, SIG_STRETCH, 0);
+      printf("x%c%c\n", '!' + b, 'a' + SIG_ACK);
+      printf("bxxxxxxxx %c%c\nbxxxxxxxx %c%c\n", '!' + b, 'a' + SIG_WR, '!' + b, 'a' + SIG_RD);
+   }
+   printf("$end\n");
+
+   for (i = 0; i < n; i++)
+   {
+      e = &ev[order[i]];
+      b = idx[e->bus];
+      if (b < 0)
+         continue;
+      if (e->time_us != last)
+      {
+         last = e->time_us;
+         printf("#%llu\n", (unsigned long long)(e->time_us - t0));
+      }
+      switch (e->type)
+      {
+         case TRACE_START:   vcd_bit(b, SIG_BUSY, 1); break;
+         case TRACE_STOP:    vcd_bit(b, SIG_BUSY, 0); break;
+         case TRACE_STRETCH: vcd_bit(b, SIG_STRETCH, 1); break;
+         case TRACE_RELEASE:
+         case TRACE_TIMEOUT: vcd_bit(b, SIG_STRETCH, 0); break;
+         case TRACE_WRITE:
+         case TRACE_READ:
+            vcd_byte(b, e->type == TRACE_WRITE ? SIG_WR : SIG_RD, e->data);
+            vcd_bit(b, SIG_ACK, e->ack);
+            break;
+      }
+   }
+}
+
+int main(int argc, char* argv[])
+{
+   uint32_t n, i;
+   int vcd = 0;
+   int opt;
+
+   while ((opt = getopt(argc, argv, "v")) != -1)
+   {
+      if (opt == 'v')
+         vcd = 1;
+      else
+         goto usage;
+   }
+   if (optind != argc - 1)
+      goto usage;
+
+   n = TRACE_Load(argv[optind], ev, TRACE_SLOTS);
+   if (n == 0)
+   {
+      fprintf(stderr, "No events in %s\n", argv[optind]);
+      return 1;
+   }
+   for (i = 0; i < n; i++)
+      order[i] = i;
+   qsort(order, n, sizeof(order[0]), cmp_time);
+
+   if (vcd)
+      print_vcd(n);
+   else
+      print_text(n);
+   return 0;
+
+usage:
+   fprintf(stderr, "Usage: %s [-v] file\n", argv[0]);
+   return 1;
+}
@@ -0,0 +1,143 @@
+//--------------------------------------------------------------------------------------------------
+//
+// Filename:    gpiochip.c
+// Description: GPIO lines through the Linux GPIO character device (/dev/gpiochipN)
+//              The lines are requested with the v2 uAPI as one multi-line request, so a single
+//              GPIO_V2_LINE_SET_VALUES or GET_VALUES ioctl switches or samples any number of them.
+//              Open drain is done by the kernel, natively or by switching the line direction.
+//
+// Open Source Licensing 
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// Author:      agent
+// History:     17.10.2026 Initial version
+//--------------------------------------------------------------------------------------------------
+
+//=== Includes =====================================================================================
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/gpio.h>
+#include "gpiochip.h"
+
+//=== Preprocessing directives (#define) ===========================================================
+
+#define GPIOCHIP_CONSUMER	"shtlib"	// shown as user of the lines
+
+//=== Type definitions (typedef) ===================================================================
+
+//=== Global constants =============================================================================
+
+//=== Global variables =============================================================================
+
+//=== Local constants  =============================================================================
+
+//=== Local variables ==============================================================================
+
+//=== Local function prototypes ====================================================================
+
+//--------------------------------------------------------------------------------------------------
+// Name:	GPIOCHIP_Open
+// Function:  	Request lines of a GPIO chip as open drain outputs, released (high)
+//            
+// Parameter: 	lines, N of /dev/gpiochipN, line offsets on the chip, number of lines
+// Return:    	0=OK 1=ERROR (no such chip, line in use, ...)
+//--------------------------------------------------------------------------------------------------
+uint8_t GPIOCHIP_Open(GPIOCHIP_Lines *lines,uint8_t chip,const uint8_t *offsets,uint8_t n)
+{
+   struct gpio_v2_line_request req;
+   char path[20];
+   uint8_t i;
+   int fd;
+   
+   lines->fd = -1;
+   lines->n = 0;
+   if(n == 0 || n > GPIOCHIP_MAX_LINES) return 1;
+   
+   snprintf(path,sizeof(path),"/dev/gpiochip%u",chip);
+   fd = open(path,O_RDWR | O_CLOEXEC);
+   if(fd < 0) return 1;
+   
+   memset(&req,0,sizeof(req));
+   for(i=0;i<n;i++) req.offsets[i] = offsets[i];
+   req.num_lines = n;
+   strcpy(req.consumer,GPIOCHIP_CONSUMER);
+   req.config.flags = GPIO_V2_LINE_FLAG_OUTPUT | GPIO_V2_LINE_FLAG_OPEN_DRAIN;
+   req.config.num_attrs = 1;
+   req.config.attrs[0].attr.id = GPIO_V2_LINE_ATTR_ID_OUTPUT_VALUES;
+   req.config.attrs[0].attr.values = ~(uint64_t)0;
+   req.config.attrs[0].mask = (n == 64) ? ~(uint64_t)0 : (((uint64_t)1 << n) - 1);
+   
+   if(ioctl(fd,GPIO_V2_GET_LINE_IOCTL,&req) == 0)
+   {
+      lines->fd = req.fd;
+      lines->n = n;
+   }
+   close(fd);				// the request stays valid without the chip
+   
+   return (lines->fd < 0) ? 1 : 0;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Name:	GPIOCHIP_Close
+// Function:  	Release the lines, they go back to the kernel's default state
+//            
+// Parameter: 	lines
+// Return:    	-
+//--------------------------------------------------------------------------------------------------
+void GPIOCHIP_Close(GPIOCHIP_Lines *lines)
+{
+   if(lines->fd >= 0) close(lines->fd);
+   lines->fd = -1;
+   lines->n = 0;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Name:	GPIOCHIP_Set
+// Function:  	Drive low (0) or release (1) several lines with one ioctl
+//            
+// Parameter: 	lines, lines to change (bit i = line i), new values
+// Return:    	-
+//--------------------------------------------------------------------------------------------------
+void GPIOCHIP_Set(GPIOCHIP_Lines *lines,uint64_t mask,uint64_t values)
+{
+   struct gpio_v2_line_values v;
+   
+   v.mask = mask;
+   v.bits = values;
+   ioctl(lines->fd,GPIO_V2_LINE_SET_VALUES_IOCTL,&v);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Name:	GPIOCHIP_Get
+// Function:  	Sample the levels of several lines with one ioctl
+//            
+// Parameter: 	lines, lines to sample (bit i = line i)
+// Return:    	levels (bit i = line i, lines not sampled read 0), all high if the ioctl fails,
+//		which looks like a released bus (NACK) rather than data
+//--------------------------------------------------------------------------------------------------
+uint64_t GPIOCHIP_Get(GPIOCHIP_Lines *lines,uint64_t mask)
+{
+   struct gpio_v2_line_values v;
+   
+   v.mask = mask;
+   v.bits = 0;
+   if(ioctl(lines->fd,GPIO_V2_LINE_GET_VALUES_IOCTL,&v) < 0) return mask;
+   return v.bits & mask;
+}
@@ -0,0 +1,45 @@
+//--------------------------------------------------------------------------------------------------
+//
+// Filename:    gpiochip.h
+// Description: GPIO lines through the Linux GPIO character device (/dev/gpiochipN)
+//              
+// Author:      agent
+// History:     17.10.2026 Initial version
+//--------------------------------------------------------------------------------------------------
+
+#ifndef GPIOCHIP_H
+#define GPIOCHIP_H
+
+//=== Includes =====================================================================================	
+
+#include <stdint.h>
+
+//=== Preprocessing directives (#define) ===========================================================
+
+#define GPIOCHIP_MAX_LINES	64	// max lines of one request (GPIO_V2_LINES_MAX)
+
+//=== Type definitions (typedef) ===================================================================
+
+// A set of lines requested together as open drain outputs. Line i of the request is bit i of
+// the masks and values, all of them are set or read with one ioctl. Writing 1 releases a line,
+// reading returns the level on the line. Works on any SoC with a GPIO driver and needs only
+// access to the device file.
+
+typedef struct
+{
+   int fd;			// line request, -1 if closed
+   uint8_t n;			// number of lines
+} GPIOCHIP_Lines;
+
+//=== Global constants (extern) ====================================================================
+
+//=== Global variables (extern) ====================================================================
+
+//=== Global function prototypes ===================================================================
+
+uint8_t  GPIOCHIP_Open(GPIOCHIP_Lines *lines,uint8_t chip,const uint8_t *offsets,uint8_t n);
+void     GPIOCHIP_Close(GPIOCHIP_Lines *lines);
+void     GPIOCHIP_Set(GPIOCHIP_Lines *lines,uint64_t mask,uint64_t values);
+uint64_t GPIOCHIP_Get(GPIOCHIP_Lines *lines,uint64_t mask);
+
+#endif
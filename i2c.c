@@ -1,224 +1,801 @@
-//--------------------------------------------------------------------------------------------------
-//
-// Filename:    i2c.c
-// Description: I2C Software Implementierung
-//
-// Open Source Licensing 
-//
-// This program is free software: you can redistribute it and/or modify
-// it under the terms of the GNU General Public License as published by
-// the Free Software Foundation, either version 3 of the License, or
-// (at your option) any later version.
-//
-// This program is distributed in the hope that it will be useful,
-// but WITHOUT ANY WARRANTY; without even the implied warranty of
-// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
-// GNU General Public License for more details.
-//
-// You should have received a copy of the GNU General Public License
-// along with this program.  If not, see <http://www.gnu.org/licenses/>.
-//
-// Author:      Martin Steppuhn
-// History:     28.08.2012 Initial version
-//              31.10.2012 Flexible pin connection
-//--------------------------------------------------------------------------------------------------
-
-//=== Includes =====================================================================================
-
-#include <stdint.h>
-#include "i2c.h"
-#include "bcm2835.h"
-
-//=== Preprocessing directives (#define) ===========================================================
-
-#define	SCL_1		bcm2835_gpio_fsel(pin_scl,BCM2835_GPIO_FSEL_INPT)		// Input -> 1 ber Pullup
-#define	SCL_0		bcm2835_gpio_fsel(pin_scl,BCM2835_GPIO_FSEL_OUTP)		// Output -> 0 auf GND
-#define	SCL			bcm2835_gpio_lev(pin_scl)
-#define	SDA_1		bcm2835_gpio_fsel(pin_sda,BCM2835_GPIO_FSEL_INPT)		// Input -> 1 ber Pullup
-#define	SDA_0		bcm2835_gpio_fsel(pin_sda,BCM2835_GPIO_FSEL_OUTP)		// Output -> 0 auf GND
-#define	SDA			bcm2835_gpio_lev(pin_sda)
-
-#define	SSI2C_DELAY	delayMicroseconds(0);
-
-//=== Type definitions (typedef) ===================================================================
-
-//=== Global constants =============================================================================
-
-//=== Global variables =============================================================================
-
-//=== Local constants  =============================================================================
-
-//=== Local variables ==============================================================================
-
-uint8_t	pin_scl;
-uint8_t	pin_sda;
-
-//=== Local function prototypes ====================================================================
-
-//--------------------------------------------------------------------------------------------------
-// Name:	SI2C_SetPort
-// Function:  	"Connect" GPIO-Pins to Port
-//            
-// Parameter: 	scl and sda Pinnumber
-// Return:    	-
-//--------------------------------------------------------------------------------------------------
-void SI2C_SetPort(uint8_t scl,uint8_t sda)
-{
-   pin_scl = scl;
-   pin_sda = sda;
-}
-
-//--------------------------------------------------------------------------------------------------
-// Name:	SI2C_Start
-// Function:  	Transmit start sequence
-//            
-// Parameter: 	-
-// Return:    	-
-//--------------------------------------------------------------------------------------------------
-void SI2C_Start(void)
-{
-   SCL_1; 
-   SDA_1; 
-   SSI2C_DELAY;
-   SSI2C_DELAY;
-   SDA_0;
-   SSI2C_DELAY;
-   SSI2C_DELAY;
-   SCL_0; 
-   SSI2C_DELAY;
-   SSI2C_DELAY;
-}
-
-//--------------------------------------------------------------------------------------------------
-// Name:	SI2C_Stop
-// Function:  	Stopsequenz senden
-//            
-// Parameter: 	-
-// Return:    	-
-//--------------------------------------------------------------------------------------------------
-void SI2C_Stop(void)
-{
-   SDA_0;			
-   SSI2C_DELAY;
-   SSI2C_DELAY;
-   SCL_1; 
-   SSI2C_DELAY;
-   SSI2C_DELAY;
-   SDA_1;
-   SSI2C_DELAY;
-   SSI2C_DELAY;
-}
-
-//--------------------------------------------------------------------------------------------------
-// Name:	SI2C_SendByte
-// Function:  	Byte ausgeben 
-//            
-// Parameter: 	Byte
-// Return:    	1=NACK 0=ACK   (for Errordetection)
-//--------------------------------------------------------------------------------------------------
-uint8_t SI2C_SendByte(uint8_t Data)
-{
-   uint8_t i,t,r;
-   
-   for(i=0;i<8;i++)
-   {
-      if(Data & 0x80) { SDA_1; }
-      else		{ SDA_0; }
-      Data <<= 1;
-      SSI2C_DELAY;
-      SCL_1; 
-      SSI2C_DELAY;
-      t = 100;
-      while(!SCL && t--); SSI2C_DELAY;    // Clockstretching 
-      SCL_0; 
-      SSI2C_DELAY;
-   }
-   SDA_1;		
-   
-   SSI2C_DELAY;		
-   SCL_1;
-   SSI2C_DELAY;
-   
-   t = 100;
-   while(!SCL && t--); SSI2C_DELAY;    // Clockstretching 
-   
-   r = SDA ? 1 : 0;
-   SCL_0;
-   SSI2C_DELAY;
-   return(r);
-}
-
-//--------------------------------------------------------------------------------------------------
-// Name:	SI2C_ReadByte
-// Function:  	Byte lesen
-//            
-// Parameter: 	Ack  1= ACK Bite setzen (low) 0= kein ACK (high)
-// Return:    	gelesenes byte
-//--------------------------------------------------------------------------------------------------
-uint8_t SI2C_ReadByte(uint8_t Ack)
-{
-   uint8_t i,d,t;
-   
-   d=0;
-   SDA_1;				// damit Input
-   for(i=0;i<8;i++)
-   {
-      SSI2C_DELAY;
-      SCL_1; 
-      SSI2C_DELAY;
-      
-      t = 100;
-      while(!SCL && t--); SSI2C_DELAY;    // Clockstretching 
-      
-      
-      d <<= 1;
-      if(SDA) 	{ d |=  1; }
-      else	{ d &= ~1; }
-      
-      SSI2C_DELAY;			
-      SCL_0;		
-      SSI2C_DELAY;
-   }
-   
-   if(Ack) 	{ SDA_0; }
-   else	{ SDA_1; }
-   SSI2C_DELAY;
-   SCL_1; 
-   SSI2C_DELAY;
-   
-   t = 100;
-   while(!SCL && t--); SSI2C_DELAY;    // Clockstretching 
-   
-   SCL_0;
-   SSI2C_DELAY;
-   SDA_1;
-   return d;	
-}
-
-//--------------------------------------------------------------------------------------------------
-// Name:	SI2C_SetSclState
-// Function:  	Control SCL Pin
-//            
-// Parameter: 	0 / 1
-// Return:    	-
-//--------------------------------------------------------------------------------------------------
-void SI2C_SetSclState(uint8_t State)
-{
-   if(State) { SCL_1; }
-   else  { SCL_0; }
-}
-
-//--------------------------------------------------------------------------------------------------
-// Name:	SI2C_GetSclState
-// Function:  	Read state of SCL Pin
-//            
-// Parameter: 	-
-// Return:    	0 / 1
-//--------------------------------------------------------------------------------------------------
-uint8_t SI2C_GetSclState(void)
-{
-   if(SCL)   return 1;
-   else  return 0;
-}
-
-
+//--------------------------------------------------------------------------------------------------
+//
+// Filename:    i2c.c
+// Description: I2C Software Implementierung
+//
+// Open Source Licensing 
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// Author:      Martin Steppuhn, agent
+// History:     28.08.2012 Initial version
+//              31.10.2012 Flexible pin connection
+//              17.10.2026 Bus context instead of global pins
+//              17.10.2026 Shadow GPFSEL registers, one store per edge
+//              17.10.2026 Calibrated busy wait delay, configurable clock
+//              17.10.2026 Transport operations SI2C_Ops
+//              17.10.2026 Whole transactions through SI2C_Transfer()
+//              17.10.2026 GPIO accesses of a transaction in one barrier-free burst
+//              17.10.2026 Hold master wait sleeps on a GPIO line event
+//              17.10.2026 Clock stretch durations recorded in the bus statistics
+//              17.10.2026 Optional bus trace (SHT_TRACE)
+//              17.10.2026 Real-time mode without system calls, transaction jitter
+//              17.10.2026 Lock per GPFSEL register, buses sharing one are serialised
+//              17.10.2026 GPFSEL registers released during the hold master wait
+//              17.10.2026 Hold master wait restarted after a signal, ppoll() errors fall back to polling
+//--------------------------------------------------------------------------------------------------
+
+//=== Includes =====================================================================================
+
+#include <stdint.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include <string.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <linux/gpio.h>
+#include "i2c.h"
+#include "bcm2835.h"
+#include "bcm2835sim.h"
+#include "trace.h"
+
+//=== Preprocessing directives (#define) ===========================================================
+
+#define	SCL_1		SI2C_Release(bus->fsel_scl,bus->shadow_scl,bus->scl_mask)	// Input -> 1 ber Pullup
+#define	SCL_0		SI2C_Drive(bus->fsel_scl,bus->shadow_scl,bus->scl_out)		// Output -> 0 auf GND
+#define	SCL			(bcm2835_burst_read(bus->lev_scl) & bus->scl_bit)
+#define	SDA_1		SI2C_Release(bus->fsel_sda,bus->shadow_sda,bus->sda_mask)	// Input -> 1 ber Pullup
+#define	SDA_0		SI2C_Drive(bus->fsel_sda,bus->shadow_sda,bus->sda_out)		// Output -> 0 auf GND
+#define	SDA			(bcm2835_burst_read(bus->lev_sda) & bus->sda_bit)
+
+#define	SSI2C_DELAY	SI2C_Delay(bus->delay);
+
+// Bus trace, see trace.h
+#ifdef SHT_TRACE
+#define	TRACE(type,data,ack)	TRACE_Record(bus->scl,type,data,ack,TRACE_Now())
+#else
+#define	TRACE(type,data,ack)
+#endif
+
+//=== Type definitions (typedef) ===================================================================
+
+//=== Global constants =============================================================================
+
+const I2C_Ops SI2C_Ops =
+{
+   "gpio",
+   1,
+   SI2C_Transfer
+};
+
+//=== Global variables =============================================================================
+
+//=== Local constants  =============================================================================
+
+#define	STRETCH_SPIN_US	50		// hold master: busy poll of the clock line before sleeping
+#define	STRETCH_POLL_US	1000		// hold master: poll interval without line events
+#define	STRETCH_TMO_US	100000		// hold master: max time the clock is held low
+
+#define	SI2C_PINS	60		// pins of the 6 GPFSEL registers
+
+#define	GPIOCHIP_DEV	"/dev/gpiochip0"	// GPIO character device of the BCM2835 pins
+#define	GPIOCHIP_LABEL	"pinctrl-bcm2"		// label of that device (bcm2835, bcm2711)
+
+// Line events of the kernel, not with the simulated peripherals
+#if defined(GPIO_V2_GET_LINE_IOCTL) && !defined(BCM2835_SIM)
+#define	SI2C_LINE_EVENTS
+#endif
+
+//=== Local variables ==============================================================================
+
+// Shadow copies of the GPFSEL registers. The open drain emulation switches a pin between input
+// and output, with the shadow copy every edge is a single store instead of a read-modify-write
+// of the register.
+static uint32_t fsel_shadow[6];
+
+// Lock of each GPFSEL register and its shadow copy, held by a transaction on a pin in it
+static pthread_mutex_t fsel_lock[6] =
+{
+   PTHREAD_MUTEX_INITIALIZER, PTHREAD_MUTEX_INITIALIZER, PTHREAD_MUTEX_INITIALIZER,
+   PTHREAD_MUTEX_INITIALIZER, PTHREAD_MUTEX_INITIALIZER, PTHREAD_MUTEX_INITIALIZER
+};
+
+// Lock of each clock pin, held by a transaction from start to end. The GPFSEL registers are
+// released while the device holds the clock low, this keeps other sessions on the same pins out.
+static pthread_mutex_t scl_lock[SI2C_PINS];
+static pthread_once_t scl_once = PTHREAD_ONCE_INIT;
+
+// Busy wait loops per millisecond, calibrated once
+static uint32_t loops_per_ms;
+static pthread_once_t calib_once = PTHREAD_ONCE_INIT;
+
+#ifdef SI2C_LINE_EVENTS
+// GPIO character device for line events, -1 if not available
+static int chip_fd = -1;
+static pthread_once_t chip_once = PTHREAD_ONCE_INIT;
+#endif
+
+//=== Local function prototypes ====================================================================
+
+static uint8_t SI2C_Run(SI2C_Bus *bus,I2C_Msg *msgs,uint8_t n);
+static void SI2C_Restart(SI2C_Bus *bus);
+static void SI2C_Jitter(SI2C_Bus *bus,const I2C_Msg *msgs,uint8_t n,uint32_t dur);
+static void SI2C_Calibrate(void);
+static void SI2C_InitLocks(void);
+static uint8_t SI2C_Hold(SI2C_Bus *bus);
+static int SI2C_WaitEdge(SI2C_Bus *bus,uint32_t timeout_us);
+#ifdef SI2C_LINE_EVENTS
+static void SI2C_OpenChip(void);
+#endif
+static uint64_t SI2C_Now(void);
+
+//--------------------------------------------------------------------------------------------------
+// Name:	SI2C_Release / SI2C_Drive
+// Function:  	Switch a pin to input (line pulled up) or output (line driven low) through the
+//		shadow copy of its GPFSEL register
+//            
+// Parameter: 	register, shadow copy, function select mask / output value of the pin
+// Return:    	-
+//--------------------------------------------------------------------------------------------------
+static inline void SI2C_Release(volatile uint32_t *reg,uint32_t *shadow,uint32_t mask)
+{
+   *shadow &= ~mask;
+   bcm2835_burst_write(reg,*shadow);
+}
+
+static inline void SI2C_Drive(volatile uint32_t *reg,uint32_t *shadow,uint32_t out)
+{
+   *shadow |= out;
+   bcm2835_burst_write(reg,*shadow);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Name:	SI2C_Init
+// Function:  	"Connect" GPIO-Pins to a bus
+//            
+// Parameter: 	bus, scl and sda Pinnumber
+// Return:    	-
+//--------------------------------------------------------------------------------------------------
+void SI2C_Init(SI2C_Bus *bus,uint8_t scl,uint8_t sda)
+{
+   uint8_t i;
+   
+   bus->scl = scl;
+   bus->sda = sda;
+   
+   // Precompute register and function select bits of both pins
+   bus->fsel_scl = bcm2835_gpio + BCM2835_GPFSEL0/4 + scl/10;
+   bus->fsel_sda = bcm2835_gpio + BCM2835_GPFSEL0/4 + sda/10;
+   bus->shadow_scl = &fsel_shadow[scl/10];
+   bus->shadow_sda = &fsel_shadow[sda/10];
+   bus->banks = (1u << (scl/10)) | (1u << (sda/10));
+   bus->scl_mask = BCM2835_GPIO_FSEL_MASK << ((scl % 10) * 3);
+   bus->sda_mask = BCM2835_GPIO_FSEL_MASK << ((sda % 10) * 3);
+   bus->scl_out = BCM2835_GPIO_FSEL_OUTP << ((scl % 10) * 3);
+   bus->sda_out = BCM2835_GPIO_FSEL_OUTP << ((sda % 10) * 3);
+   bus->lev_scl = bcm2835_gpio + BCM2835_GPLEV0/4 + scl/32;
+   bus->lev_sda = bcm2835_gpio + BCM2835_GPLEV0/4 + sda/32;
+   bus->scl_bit = 1u << (scl % 32);
+   bus->sda_bit = 1u << (sda % 32);
+   
+   for(i=0;i<SI2C_SHAPE_CACHE;i++) bus->shape[i].keylen = 0;
+   bus->shape_next = 0;
+   bus->stretch = NULL;
+   bus->jitter = NULL;
+   bus->spin = 0;
+   
+   pthread_once(&scl_once,SI2C_InitLocks);
+   SI2C_SetSpeed(bus,SI2C_DEFAULT_HZ);
+   SI2C_LockBanks(bus->banks);
+   SI2C_Resync(bus);
+   bcm2835_burst_end();
+   SI2C_UnlockBanks(bus->banks);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Name:	SI2C_LockBanks / SI2C_UnlockBanks
+// Function:  	Take / release the GPFSEL registers of a transaction, see SI2C_Bus.banks
+//		The locks are taken in register order, so buses with pins in several registers do
+//		not deadlock. SI2C_Transfer() does this itself, callers of the byte level functions
+//		SI2C_Start() ... SI2C_Stop() have to.
+//            
+// Parameter: 	bit mask of GPFSEL registers (bit n = GPIO n*10 ... n*10+9)
+// Return:    	-
+//--------------------------------------------------------------------------------------------------
+void SI2C_LockBanks(uint8_t banks)
+{
+   uint8_t i;
+   
+   for(i=0;i<6;i++)
+   {
+      if(banks & (1u << i)) pthread_mutex_lock(&fsel_lock[i]);
+   }
+}
+
+void SI2C_UnlockBanks(uint8_t banks)
+{
+   uint8_t i;
+   
+   for(i=6;i-- > 0;)
+   {
+      if(banks & (1u << i)) pthread_mutex_unlock(&fsel_lock[i]);
+   }
+}
+
+//--------------------------------------------------------------------------------------------------
+// Name:	SI2C_SetSpeed
+// Function:  	Set the clock frequency of a bus
+//		The frequency is an upper limit, the time of the edges themselves adds to the
+//		calibrated delays.
+//            
+// Parameter: 	bus, clock frequency in Hz (0 = as fast as possible)
+// Return:    	-
+//--------------------------------------------------------------------------------------------------
+void SI2C_SetSpeed(SI2C_Bus *bus,uint32_t Hz)
+{
+   bus->delay = SI2C_DelayLoops(Hz);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Name:	SI2C_DelayLoops
+// Function:  	Busy wait loops for a quarter clock period, see SI2C_Delay()
+//		The delay loop is calibrated against CLOCK_MONOTONIC on the first call.
+//            
+// Parameter: 	clock frequency in Hz (0 = no delay)
+// Return:    	number of loops
+//--------------------------------------------------------------------------------------------------
+uint32_t SI2C_DelayLoops(uint32_t Hz)
+{
+   if(Hz == 0) return 0;
+   
+   pthread_once(&calib_once,SI2C_Calibrate);
+   return (uint32_t)(((uint64_t)loops_per_ms * 1000 + 2 * Hz) / (4 * (uint64_t)Hz));
+}
+
+//--------------------------------------------------------------------------------------------------
+// Name:	SI2C_Resync
+// Function:  	Reload the shadow copies of the GPFSEL registers of a bus
+//		Needed whenever the function select of another pin in these registers may have
+//		been changed without going through the shadow copy. Done by every SI2C_Start().
+//		Opens the burst of GPIO accesses of a transaction, closed by SI2C_Stop(), so the
+//		edges and samples in between go without memory barriers.
+//            
+// Parameter: 	bus
+// Return:    	-
+//--------------------------------------------------------------------------------------------------
+void SI2C_Resync(SI2C_Bus *bus)
+{
+   bcm2835_burst_begin();
+   *bus->shadow_scl = bcm2835_burst_read(bus->fsel_scl);
+   *bus->shadow_sda = bcm2835_burst_read(bus->fsel_sda);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Name:	SI2C_Start
+// Function:  	Transmit start sequence
+//            
+// Parameter: 	bus
+// Return:    	-
+//--------------------------------------------------------------------------------------------------
+void SI2C_Start(SI2C_Bus *bus)
+{
+   SI2C_Resync(bus);
+   SI2C_Restart(bus);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Name:	SI2C_Restart
+// Function:  	Transmit start sequence without reloading the shadow registers (repeated start
+//		within a transaction)
+//            
+// Parameter: 	bus
+// Return:    	-
+//--------------------------------------------------------------------------------------------------
+static void SI2C_Restart(SI2C_Bus *bus)
+{
+   SCL_1; 
+   SDA_1; 
+   SSI2C_DELAY;
+   SSI2C_DELAY;
+   SDA_0;
+   SSI2C_DELAY;
+   SSI2C_DELAY;
+   SCL_0; 
+   SSI2C_DELAY;
+   SSI2C_DELAY;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Name:	SI2C_Stop
+// Function:  	Stopsequenz senden
+//            
+// Parameter: 	bus
+// Return:    	-
+//--------------------------------------------------------------------------------------------------
+void SI2C_Stop(SI2C_Bus *bus)
+{
+   SDA_0;			
+   SSI2C_DELAY;
+   SSI2C_DELAY;
+   SCL_1; 
+   SSI2C_DELAY;
+   SSI2C_DELAY;
+   SDA_1;
+   SSI2C_DELAY;
+   SSI2C_DELAY;
+   bcm2835_burst_end();
+}
+
+//--------------------------------------------------------------------------------------------------
+// Name:	SI2C_SendByte
+// Function:  	Byte ausgeben 
+//            
+// Parameter: 	bus, Byte
+// Return:    	1=NACK 0=ACK   (for Errordetection)
+//--------------------------------------------------------------------------------------------------
+uint8_t SI2C_SendByte(SI2C_Bus *bus,uint8_t Data)
+{
+   uint8_t i,t,r;
+   
+   for(i=0;i<8;i++)
+   {
+      if(Data & 0x80) { SDA_1; }
+      else		{ SDA_0; }
+      Data <<= 1;
+      SSI2C_DELAY;
+      SCL_1; 
+      SSI2C_DELAY;
+      t = 100;
+      while(!SCL && t--); SSI2C_DELAY;    // Clockstretching 
+      SCL_0; 
+      SSI2C_DELAY;
+   }
+   SDA_1;		
+   
+   SSI2C_DELAY;		
+   SCL_1;
+   SSI2C_DELAY;
+   
+   t = 100;
+   while(!SCL && t--); SSI2C_DELAY;    // Clockstretching 
+   
+   r = SDA ? 1 : 0;
+   SCL_0;
+   SSI2C_DELAY;
+   return(r);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Name:	SI2C_ReadByte
+// Function:  	Byte lesen
+//            
+// Parameter: 	bus, Ack  1= ACK Bite setzen (low) 0= kein ACK (high)
+// Return:    	gelesenes byte
+//--------------------------------------------------------------------------------------------------
+uint8_t SI2C_ReadByte(SI2C_Bus *bus,uint8_t Ack)
+{
+   uint8_t i,d,t;
+   
+   d=0;
+   SDA_1;				// damit Input
+   for(i=0;i<8;i++)
+   {
+      SSI2C_DELAY;
+      SCL_1; 
+      SSI2C_DELAY;
+      
+      t = 100;
+      while(!SCL && t--); SSI2C_DELAY;    // Clockstretching 
+      
+      
+      d <<= 1;
+      if(SDA) 	{ d |=  1; }
+      else	{ d &= ~1; }
+      
+      SSI2C_DELAY;			
+      SCL_0;		
+      SSI2C_DELAY;
+   }
+   
+   if(Ack) 	{ SDA_0; }
+   else	{ SDA_1; }
+   SSI2C_DELAY;
+   SCL_1; 
+   SSI2C_DELAY;
+   
+   t = 100;
+   while(!SCL && t--); SSI2C_DELAY;    // Clockstretching 
+   
+   SCL_0;
+   SSI2C_DELAY;
+   SDA_1;
+   return d;	
+}
+
+//--------------------------------------------------------------------------------------------------
+// Name:	SI2C_SetSclState
+// Function:  	Control SCL Pin
+//            
+// Parameter: 	bus, 0 / 1
+// Return:    	-
+//--------------------------------------------------------------------------------------------------
+void SI2C_SetSclState(SI2C_Bus *bus,uint8_t State)
+{
+   if(State) { SCL_1; }
+   else  { SCL_0; }
+}
+
+//--------------------------------------------------------------------------------------------------
+// Name:	SI2C_GetSclState
+// Function:  	Read state of SCL Pin
+//            
+// Parameter: 	bus
+// Return:    	0 / 1
+//--------------------------------------------------------------------------------------------------
+uint8_t SI2C_GetSclState(SI2C_Bus *bus)
+{
+   if(SCL)   return 1;
+   else  return 0;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Name:	SI2C_Transfer
+// Function:  	Transport operation: run segments as one transaction
+//		The shadow GPFSEL registers are reloaded once, repeated starts skip this. After the
+//		address of a read segment the device may hold the clock low (hold master mode), this
+//		is waited for up to STRETCH_TMO_US, see SI2C_Hold(). Both pins are inputs then,
+//		so the GPFSEL registers are released meanwhile for the other buses in them, only
+//		the clock pin stays locked.
+//            
+// Parameter: 	bus, segments, number of segments
+// Return:    	I2C_ERR_xxx bits, 0 = OK
+//--------------------------------------------------------------------------------------------------
+uint8_t SI2C_Transfer(void *ctx,I2C_Msg *msgs,uint8_t n)
+{
+   SI2C_Bus *bus = ctx;
+   uint8_t error;
+   
+   pthread_mutex_lock(&scl_lock[bus->scl]);
+   SI2C_LockBanks(bus->banks);
+   error = SI2C_Run(bus,msgs,n);
+   SI2C_UnlockBanks(bus->banks);
+   pthread_mutex_unlock(&scl_lock[bus->scl]);
+   return error;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Name:	SI2C_Run
+// Function:  	Run a transaction, see SI2C_Transfer() (GPFSEL registers locked)
+//            
+// Parameter: 	bus, segments, number of segments
+// Return:    	I2C_ERR_xxx bits, 0 = OK
+//--------------------------------------------------------------------------------------------------
+static uint8_t SI2C_Run(SI2C_Bus *bus,I2C_Msg *msgs,uint8_t n)
+{
+   uint8_t error = 0;
+   uint8_t i,len;
+   uint8_t *buf;
+   uint64_t t0 = 0;
+   uint64_t held = 0;
+   uint64_t t;
+   
+   SI2C_Resync(bus);
+   if(bus->jitter) t0 = SI2C_Now();
+   
+   for(i=0;i<n && !error;i++)
+   {
+      SI2C_Restart(bus);
+      TRACE(TRACE_START,0,0);
+      buf = msgs[i].buf;
+      len = msgs[i].len;
+      
+      if(msgs[i].flags & I2C_MSG_RD)
+      {
+         error = SI2C_SendByte(bus,(msgs[i].addr << 1) + 1);	// Addr + RD
+         TRACE(TRACE_WRITE,(msgs[i].addr << 1) + 1,error);
+         if(error)
+         {
+            error = I2C_ERR_NACK;
+            break;
+         }
+         
+         SI2C_SetSclState(bus,1);
+         if(!SCL)
+         {
+            // Nothing is driven while the device works, the registers may change meanwhile
+            bcm2835_burst_end();
+            SI2C_UnlockBanks(bus->banks);
+            t = SI2C_Now();
+            error = SI2C_Hold(bus);
+            held += SI2C_Now() - t;
+            SI2C_LockBanks(bus->banks);
+            SI2C_Resync(bus);
+         }
+         
+         while(len--)
+         {
+            *buf = SI2C_ReadByte(bus,len != 0);
+            TRACE(TRACE_READ,*buf,len == 0);
+            buf++;
+         }
+      }
+      else
+      {
+         error = SI2C_SendByte(bus,msgs[i].addr << 1);	// Addr + WR
+         TRACE(TRACE_WRITE,msgs[i].addr << 1,error);
+         while(len-- && !error)
+         {
+            error = SI2C_SendByte(bus,*buf);
+            TRACE(TRACE_WRITE,*buf,error);
+            buf++;
+         }
+         if(error) error = I2C_ERR_NACK;
+      }
+   }
+   SI2C_Stop(bus);
+   TRACE(TRACE_STOP,0,0);
+   
+   // Jitter: time above the fastest run of this transaction, without clock stretching
+   if(bus->jitter && !error) SI2C_Jitter(bus,msgs,n,SI2C_Now() - t0 - held);
+   return error;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Name:	SI2C_Jitter
+// Function:  	Record the duration of a transaction above the fastest run of the same one
+//		Read data is not part of the key, written data is, so a fixed command sequence is
+//		one entry. Transactions too long for a key are not recorded.
+//            
+// Parameter: 	bus, segments, number of segments, duration in us without clock stretching
+// Return:    	-
+//--------------------------------------------------------------------------------------------------
+static void SI2C_Jitter(SI2C_Bus *bus,const I2C_Msg *msgs,uint8_t n,uint32_t dur)
+{
+   uint8_t key[SI2C_SHAPE_KEY];
+   uint8_t len = 0;
+   uint8_t i,j;
+   SI2C_Shape *e = NULL;
+   
+   for(i=0;i<n;i++)
+   {
+      if(len + 2 > SI2C_SHAPE_KEY) return;
+      key[len++] = (msgs[i].addr << 1) | (msgs[i].flags & I2C_MSG_RD);
+      key[len++] = msgs[i].len;
+      if(msgs[i].flags & I2C_MSG_RD) continue;
+      if(len + msgs[i].len > SI2C_SHAPE_KEY) return;
+      for(j=0;j<msgs[i].len;j++) key[len++] = msgs[i].buf[j];
+   }
+   
+   for(i=0;i<SI2C_SHAPE_CACHE && !e;i++)
+   {
+      if(bus->shape[i].keylen == len && memcmp(bus->shape[i].key,key,len) == 0) e = &bus->shape[i];
+   }
+   if(!e)
+   {
+      e = &bus->shape[bus->shape_next];
+      bus->shape_next = (bus->shape_next + 1) % SI2C_SHAPE_CACHE;
+      memcpy(e->key,key,len);
+      e->keylen = len;
+      e->min_us = UINT32_MAX;
+   }
+   
+   if(dur < e->min_us) e->min_us = dur;
+   STAT_Record(bus->jitter,dur - e->min_us);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Name:	SI2C_Hold
+// Function:  	Wait while the device holds the clock low (hold master mode, up to STRETCH_TMO_US)
+//		Short stretches are caught by a busy poll. After STRETCH_SPIN_US the thread sleeps
+//		until the kernel reports the rising edge of SCL, so it neither wakes up every
+//		STRETCH_POLL_US nor adds up to that much latency. Without GPIO line events (no
+//		GPIO character device, line owned by a driver) the clock line is polled.
+//		The edge detection of the BCM2835 is not armed directly through the registers, with
+//		the kernel's GPIO interrupt enabled that can hang the system (see bcm2835.h).
+//		The duration of the wait goes to the stretch histogram of the bus, if it has one.
+//		In real-time mode (bus->spin) the whole wait is a busy poll, without system calls.
+//            
+// Parameter: 	bus
+// Return:    	0 = clock released, I2C_ERR_TIMEOUT
+//--------------------------------------------------------------------------------------------------
+static uint8_t SI2C_Hold(SI2C_Bus *bus)
+{
+   uint64_t start = SI2C_Now();
+   uint64_t t = 0;
+   uint8_t error = 0;
+   
+   TRACE(TRACE_STRETCH,0,0);
+   do
+   {
+      if(SCL) break;
+      t = SI2C_Now() - start;
+   } while(t < (bus->spin ? STRETCH_TMO_US : STRETCH_SPIN_US));
+   
+   if(!SCL && bus->spin)
+   {
+      error = I2C_ERR_TIMEOUT;
+   }
+   else if(!SCL)
+   {
+      if(SI2C_WaitEdge(bus,STRETCH_TMO_US - t) == 0)
+      {
+         if(!SCL) error = I2C_ERR_TIMEOUT;
+      }
+      else
+      {
+         while(!SCL)
+         {
+            if(SI2C_Now() - start >= STRETCH_TMO_US)
+            {
+               error = I2C_ERR_TIMEOUT;
+               break;
+            }
+            usleep(STRETCH_POLL_US);
+         }
+      }
+   }
+   
+   TRACE(error ? TRACE_TIMEOUT : TRACE_RELEASE,0,0);
+   if(bus->stretch) STAT_Record(bus->stretch,SI2C_Now() - start);
+   return error;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Name:	SI2C_WaitEdge
+// Function:  	Sleep until a rising edge of SCL through a GPIO line event
+//		The line is requested from the kernel only for the time of the wait, it is an input
+//		then anyway. An edge before the request is seen on the line level.
+//		A signal during the wait does not end it, ppoll() is restarted with the time left.
+//            
+// Parameter: 	bus, timeout in us
+// Return:    	0 = edge, line high or timeout, -1 = line events not available or failed
+//--------------------------------------------------------------------------------------------------
+static int SI2C_WaitEdge(SI2C_Bus *bus,uint32_t timeout_us)
+{
+#ifdef SI2C_LINE_EVENTS
+   struct gpio_v2_line_request req;
+   struct pollfd pfd;
+   struct timespec ts;
+   uint64_t start = SI2C_Now();
+   uint64_t t;
+   int ret = 0;
+   
+   pthread_once(&chip_once,SI2C_OpenChip);
+   if(chip_fd < 0) return -1;
+   
+   memset(&req,0,sizeof(req));
+   req.offsets[0] = bus->scl;
+   req.num_lines = 1;
+   req.config.flags = GPIO_V2_LINE_FLAG_INPUT | GPIO_V2_LINE_FLAG_EDGE_RISING;
+   strcpy(req.consumer,"shtlib");
+   if(ioctl(chip_fd,GPIO_V2_GET_LINE_IOCTL,&req) < 0) return -1;
+   
+   pfd.fd = req.fd;
+   pfd.events = POLLIN;
+   while(!SCL)
+   {
+      t = SI2C_Now() - start;
+      if(t >= timeout_us) break;
+      ts.tv_sec = (timeout_us - t) / 1000000;
+      ts.tv_nsec = ((timeout_us - t) % 1000000) * 1000;
+      if(ppoll(&pfd,1,&ts,NULL) >= 0) break;
+      if(errno != EINTR)
+      {
+         ret = -1;
+         break;
+      }
+   }
+   close(req.fd);
+   return ret;
+#else
+   return -1;
+#endif
+}
+
+//--------------------------------------------------------------------------------------------------
+// Name:	SI2C_OpenChip
+// Function:  	Open the GPIO character device of the BCM2835 pins for line events, once
+//            
+// Parameter: 	-
+// Return:    	-
+//--------------------------------------------------------------------------------------------------
+#ifdef SI2C_LINE_EVENTS
+static void SI2C_OpenChip(void)
+{
+   struct gpiochip_info info;
+   
+   chip_fd = open(GPIOCHIP_DEV,O_RDWR | O_CLOEXEC);
+   if(chip_fd < 0) return;
+   
+   if(ioctl(chip_fd,GPIO_GET_CHIPINFO_IOCTL,&info) < 0 ||
+      strncmp(info.label,GPIOCHIP_LABEL,strlen(GPIOCHIP_LABEL)) != 0)
+   {
+      close(chip_fd);
+      chip_fd = -1;
+   }
+}
+#endif
+
+//--------------------------------------------------------------------------------------------------
+// Name:	SI2C_Now
+// Function:  	Monotonic time stamp
+//            
+// Parameter: 	-
+// Return:    	time in us
+//--------------------------------------------------------------------------------------------------
+static uint64_t SI2C_Now(void)
+{
+   struct timespec ts;
+   
+   clock_gettime(CLOCK_MONOTONIC,&ts);
+   return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Name:	SI2C_Calibrate
+// Function:  	Measure the speed of the busy wait loop
+//		CLOCK_MONOTONIC is read through the vDSO, the delay itself never enters the kernel.
+//		The fastest of a few runs is taken, so a preemption does not spoil the result.
+//            
+// Parameter: 	-
+// Return:    	-
+//--------------------------------------------------------------------------------------------------
+static void SI2C_Calibrate(void)
+{
+   struct timespec t0,t1;
+   uint32_t n,i;
+   uint64_t ns,best;
+   
+   // Find a loop count that takes a few milliseconds
+   n = 1000;
+   do
+   {
+      clock_gettime(CLOCK_MONOTONIC,&t0);
+      SI2C_Delay(n);
+      clock_gettime(CLOCK_MONOTONIC,&t1);
+      ns = (uint64_t)(t1.tv_sec - t0.tv_sec) * 1000000000 + t1.tv_nsec - t0.tv_nsec;
+      if(ns >= 2000000) break;
+      n *= 2;
+   } while(n < 0x40000000);
+   
+   best = ns;
+   for(i=0;i<4;i++)
+   {
+      clock_gettime(CLOCK_MONOTONIC,&t0);
+      SI2C_Delay(n);
+      clock_gettime(CLOCK_MONOTONIC,&t1);
+      ns = (uint64_t)(t1.tv_sec - t0.tv_sec) * 1000000000 + t1.tv_nsec - t0.tv_nsec;
+      if(ns < best) best = ns;
+   }
+   if(best == 0) best = 1;
+   
+   loops_per_ms = (uint32_t)((uint64_t)n * 1000000 / best);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Name:	SI2C_InitLocks
+// Function:  	Initialise the locks of the clock pins, once per process
+//            
+// Parameter: 	-
+// Return:    	-
+//--------------------------------------------------------------------------------------------------
+static void SI2C_InitLocks(void)
+{
+   uint8_t i;
+   
+   for(i=0;i<SI2C_PINS;i++) pthread_mutex_init(&scl_lock[i],NULL);
+}
@@ -1,34 +1,116 @@
-//--------------------------------------------------------------------------------------------------
-//
-// Filename:    i2c.h
-// Description: I2C Software Implementierung
-//              
-// Author:      Martin Steppuhn
-// History:     28.08.2012 Initial version
-//              31.10.2012 Flexible pin connection
-//--------------------------------------------------------------------------------------------------
-
-#ifndef I2C_H
-#define I2C_H
-
-//=== Includes =====================================================================================	
-
-//=== Preprocessing directives (#define) ===========================================================
-
-//=== Type definitions (typedef) ===================================================================
-
-//=== Global constants (extern) ====================================================================
-
-//=== Global variables (extern) ====================================================================
-
-//=== Global function prototypes ===================================================================
-
-void  SI2C_SetPort(uint8_t Scl,uint8_t Sda);
-void  SI2C_Start(void);
-void  SI2C_Stop(void);
-uint8_t SI2C_SendByte(uint8_t Data);
-uint8_t SI2C_ReadByte(uint8_t Ack);
-void  SI2C_SetSclState(uint8_t State);
-uint8_t SI2C_GetSclState(void);
-
-#endif
+//--------------------------------------------------------------------------------------------------
+//
+// Filename:    i2c.h
+// Description: I2C Software Implementierung
+//              
+// Author:      Martin Steppuhn, agent
+// History:     28.08.2012 Initial version
+//              31.10.2012 Flexible pin connection
+//              17.10.2026 Bus context instead of global pins
+//              17.10.2026 Shadow GPFSEL registers, one store per edge
+//              17.10.2026 Calibrated busy wait delay, configurable clock
+//              17.10.2026 Transport operations SI2C_Ops
+//              17.10.2026 Whole transactions through SI2C_Transfer()
+//              17.10.2026 GPIO accesses of a transaction in one barrier-free burst
+//              17.10.2026 Clock stretch histogram
+//              17.10.2026 Real-time mode, transaction jitter histogram
+//              17.10.2026 Lock per GPFSEL register
+//              17.10.2026 Lock per clock pin, registers released during the hold master wait
+//--------------------------------------------------------------------------------------------------
+
+#ifndef I2C_H
+#define I2C_H
+
+//=== Includes =====================================================================================	
+
+#include <stdint.h>
+#include "i2cbus.h"
+
+//=== Preprocessing directives (#define) ===========================================================
+
+#define SI2C_DEFAULT_HZ	100000		// standard mode clock, set by SI2C_Init()
+
+#define SI2C_SHAPE_KEY	16		// max size of the description of a transaction
+#define SI2C_SHAPE_CACHE	6		// transactions whose fastest run is kept per bus
+
+//=== Type definitions (typedef) ===================================================================
+
+// Fastest run of a transaction, see SI2C_Bus.jitter. The key describes the transaction
+// (address, direction and length of each segment, written data).
+
+typedef struct
+{
+   uint8_t key[SI2C_SHAPE_KEY];
+   uint8_t keylen;		// 0 = entry unused
+   uint32_t min_us;		// fastest run so far
+} SI2C_Shape;
+
+// One bit-banged bus. Each bus has its own context, so different buses can be driven from
+// different threads at the same time. The function select is a read-modify-write of a whole
+// GPFSEL register (GPIO 0-9, 10-19, ...), so a transaction locks the registers of its pins:
+// buses (or sessions on the same pins) sharing a register take turns, buses in different
+// registers run in parallel. During the hold master wait of a read only the clock pin stays
+// locked, the registers are free for the other buses.
+
+typedef struct
+{
+   uint8_t scl;		// pin used for clock line
+   uint8_t sda;		// pin used for data line
+   volatile uint32_t *fsel_scl;	// GPFSEL register of the clock pin
+   volatile uint32_t *fsel_sda;	// GPFSEL register of the data pin
+   uint32_t *shadow_scl;	// shadow copy of that register
+   uint32_t *shadow_sda;
+   uint8_t banks;		// GPFSEL registers of both pins, see SI2C_LockBanks()
+   uint32_t scl_mask;		// function select bits of the pin
+   uint32_t sda_mask;
+   uint32_t scl_out;		// function select value for "output"
+   uint32_t sda_out;
+   volatile uint32_t *lev_scl;	// GPLEV register of the clock pin
+   volatile uint32_t *lev_sda;	// GPLEV register of the data pin
+   uint32_t scl_bit;		// level bit of the pin
+   uint32_t sda_bit;
+   uint32_t delay;		// busy wait loops per quarter clock period
+   SI2C_Shape shape[SI2C_SHAPE_CACHE];	// fastest run of recent transactions
+   uint8_t shape_next;		// entry to be replaced next
+   STAT_Hist *stretch;		// clock stretch durations, NULL = not recorded
+   STAT_Hist *jitter;		// transaction time above the fastest one, NULL = not recorded
+   uint8_t spin;		// 1 = real-time mode, busy poll clock stretching (no system calls)
+} SI2C_Bus;
+
+//=== Global constants (extern) ====================================================================
+
+extern const I2C_Ops SI2C_Ops;		// transport operations, context is an SI2C_Bus
+
+//=== Global variables (extern) ====================================================================
+
+//=== Global function prototypes ===================================================================
+
+//--------------------------------------------------------------------------------------------------
+// Name:	SI2C_Delay
+// Function:  	Busy wait without entering the kernel, see SI2C_DelayLoops()
+//            
+// Parameter: 	number of loops
+// Return:    	-
+//--------------------------------------------------------------------------------------------------
+static inline void SI2C_Delay(uint32_t Loops)
+{
+   while(Loops--) __asm__ __volatile__("" : "+r" (Loops));
+}
+
+uint32_t SI2C_DelayLoops(uint32_t Hz);
+
+void  SI2C_Init(SI2C_Bus *bus,uint8_t Scl,uint8_t Sda);
+void  SI2C_LockBanks(uint8_t banks);
+void  SI2C_UnlockBanks(uint8_t banks);
+void  SI2C_Resync(SI2C_Bus *bus);
+void  SI2C_SetSpeed(SI2C_Bus *bus,uint32_t Hz);
+void  SI2C_Start(SI2C_Bus *bus);
+void  SI2C_Stop(SI2C_Bus *bus);
+uint8_t SI2C_SendByte(SI2C_Bus *bus,uint8_t Data);
+uint8_t SI2C_ReadByte(SI2C_Bus *bus,uint8_t Ack);
+void  SI2C_SetSclState(SI2C_Bus *bus,uint8_t State);
+uint8_t SI2C_GetSclState(SI2C_Bus *bus);
+
+uint8_t SI2C_Transfer(void *ctx,I2C_Msg *msgs,uint8_t n);
+
+#endif
@@ -0,0 +1,141 @@
+//--------------------------------------------------------------------------------------------------
+//
+// Filename:    i2cbus.h
+// Description: Transport interface between the sensor drivers and the I2C implementations
+//              (bit-banged GPIO, BSC controller, ...). A sensor talks to its bus only through
+//              these operations, so the bus implementation can be selected by configuration.
+//              
+// Author:      agent
+// History:     17.10.2026 Initial version
+//              17.10.2026 Single transfer operation on segment arrays
+//              17.10.2026 Optional transfer statistics per bus
+//--------------------------------------------------------------------------------------------------
+
+#ifndef I2CBUS_H
+#define I2CBUS_H
+
+//=== Includes =====================================================================================	
+
+#include <stdint.h>
+#include "stats.h"
+
+//=== Preprocessing directives (#define) ===========================================================
+
+// Error bits returned by the operations
+#define I2C_ERR_NACK	0x01		// address or data byte not acknowledged
+#define I2C_ERR_TIMEOUT	0x02		// clock stretched for too long
+#define I2C_ERR_BUS	0x04		// transfer incomplete or bus not available
+
+// Flags of a message
+#define I2C_MSG_RD	0x01		// read segment (write if not set)
+
+//=== Type definitions (typedef) ===================================================================
+
+// One segment of a transfer: address, then data in one direction
+typedef struct
+{
+   uint8_t addr;		// 7 bit address
+   uint8_t flags;		// I2C_MSG_xxx
+   uint8_t len;			// number of bytes
+   uint8_t *buf;		// data to write / read
+} I2C_Msg;
+
+typedef struct
+{
+   const char *name;
+   
+   // 1 if the bus waits for a device stretching the clock (hold master mode), 0 if the
+   // device has to be polled instead
+   uint8_t stretch;
+   
+   // Run n segments as one transaction: START, segment, repeated START, segment, ..., STOP.
+   // The transaction is aborted with a STOP at the first byte not acknowledged. After the
+   // address of a read segment the device may stretch the clock (if supported).
+   uint8_t (*transfer)(void *ctx,I2C_Msg *msgs,uint8_t n);
+} I2C_Ops;
+
+// Statistics of a bus, see I2C_Transfer()
+typedef struct
+{
+   uint64_t transfers;		// transactions run
+   uint64_t nacks;		// ... aborted at a byte not acknowledged
+   uint64_t timeouts;		// ... aborted as the clock was stretched for too long
+   uint64_t errors;		// ... incomplete or bus not available
+   STAT_Hist latency;		// duration of a transaction
+   STAT_Hist stretch;		// clock stretched by a device (transports that wait for it)
+   STAT_Hist jitter;		// transaction time above the fastest run of the same transaction,
+				// without clock stretching (bit-banged transport in real-time mode)
+} I2C_Stats;
+
+// A bus: its operations and the context they work on
+typedef struct
+{
+   const I2C_Ops *ops;
+   void *ctx;
+   I2C_Stats *stats;		// NULL = not counted
+} I2C_Bus;
+
+//=== Global constants (extern) ====================================================================
+
+//=== Global variables (extern) ====================================================================
+
+//=== Global function prototypes ===================================================================
+
+void I2C_Count(I2C_Stats *st,uint8_t error,uint64_t us);	// see stats.c
+
+//--------------------------------------------------------------------------------------------------
+// Name:	I2C_Transfer
+// Function:  	Run a transaction on a bus, counting and timing it if the bus has statistics
+//            
+// Parameter: 	bus, segments, number of segments
+// Return:    	I2C_ERR_xxx bits, 0 = OK
+//--------------------------------------------------------------------------------------------------
+static inline uint8_t I2C_Transfer(I2C_Bus *bus,I2C_Msg *msgs,uint8_t n)
+{
+   I2C_Stats *st = bus->stats;
+   uint64_t start;
+   uint8_t error;
+   
+   if(st == NULL) return bus->ops->transfer(bus->ctx,msgs,n);
+   
+   start = STAT_Now();
+   error = bus->ops->transfer(bus->ctx,msgs,n);
+   I2C_Count(st,error,STAT_Now() - start);
+   return error;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Name:	I2C_Write / I2C_Read / I2C_WriteRead
+// Function:  	Common transactions built from segments: write, read, and write followed by a
+//		read with repeated start
+//            
+// Parameter: 	bus, 7 bit address, data, number of bytes
+// Return:    	I2C_ERR_xxx bits, 0 = OK
+//--------------------------------------------------------------------------------------------------
+static inline uint8_t I2C_Write(I2C_Bus *bus,uint8_t addr,const uint8_t *buf,uint8_t len)
+{
+   I2C_Msg msg = { addr, 0, len, (uint8_t *)buf };
+   
+   return I2C_Transfer(bus,&msg,1);
+}
+
+static inline uint8_t I2C_Read(I2C_Bus *bus,uint8_t addr,uint8_t *buf,uint8_t len)
+{
+   I2C_Msg msg = { addr, I2C_MSG_RD, len, buf };
+   
+   return I2C_Transfer(bus,&msg,1);
+}
+
+static inline uint8_t I2C_WriteRead(I2C_Bus *bus,uint8_t addr,const uint8_t *wbuf,uint8_t wlen,
+                                    uint8_t *rbuf,uint8_t rlen)
+{
+   I2C_Msg msgs[2] =
+   {
+      { addr, 0, wlen, (uint8_t *)wbuf },
+      { addr, I2C_MSG_RD, rlen, rbuf }
+   };
+   
+   return I2C_Transfer(bus,msgs,2);
+}
+
+#endif
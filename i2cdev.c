@@ -0,0 +1,182 @@
+//--------------------------------------------------------------------------------------------------
+//
+// Filename:    i2cdev.c
+// Description: I2C through the Linux i2c-dev interface (/dev/i2c-N)
+//              Every transfer, including a write with repeated start and read, is handed to the
+//              kernel as one I2C_RDWR ioctl, so it costs a single system call. Clock stretching
+//              is handled by the adapter driver, but not every driver waits long enough for
+//              hold master mode: the BCM2835 controller behind /dev/i2c-1 on a Raspberry Pi
+//              gives up after its CLKT timeout and suffers from the stretching erratum (see
+//              bsc.c). I2CDEV_Ops polls the device (I2C_Ops.stretch = 0), I2CDEV_HoldOps
+//              leaves the wait to the adapter (I2C_Ops.stretch = 1).
+//
+// Open Source Licensing 
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// Author:      agent
+// History:     17.10.2026 Initial version
+//              17.10.2026 Whole transactions through I2CDEV_Transfer()
+//              17.10.2026 Hold master mode only on adapters with long clock stretching
+//--------------------------------------------------------------------------------------------------
+
+//=== Includes =====================================================================================
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/i2c.h>
+#include <linux/i2c-dev.h>
+#include "i2cdev.h"
+
+//=== Preprocessing directives (#define) ===========================================================
+
+#define I2CDEV_MAX_MSGS	42		// I2C_RDWR_IOCTL_MAX_MSGS of the kernel
+
+//=== Type definitions (typedef) ===================================================================
+
+//=== Global constants =============================================================================
+
+const I2C_Ops I2CDEV_Ops =
+{
+   "i2c-dev",
+   0,
+   I2CDEV_Transfer
+};
+
+const I2C_Ops I2CDEV_HoldOps =
+{
+   "i2c-dev",
+   1,
+   I2CDEV_Transfer
+};
+
+//=== Global variables =============================================================================
+
+//=== Local constants  =============================================================================
+
+// Adapter drivers that cannot wait for a device holding the clock for a whole conversion
+static const char *const no_stretch[] = { "bcm2835", "bcm2708", NULL };
+
+//=== Local variables ==============================================================================
+
+//=== Local function prototypes ====================================================================
+
+static uint8_t I2CDEV_Stretch(uint8_t adapter);
+
+//--------------------------------------------------------------------------------------------------
+// Name:	I2CDEV_Open
+// Function:  	Open the device file of an adapter
+//		bus->stretch tells whether the adapter can be used in hold master mode.
+//            
+// Parameter: 	bus, adapter number N of /dev/i2c-N
+// Return:    	0=OK 1=device not accessible
+//--------------------------------------------------------------------------------------------------
+uint8_t I2CDEV_Open(I2CDEV_Bus *bus,uint8_t adapter)
+{
+   char path[16];
+   
+   snprintf(path,sizeof(path),"/dev/i2c-%u",adapter);
+   bus->fd = open(path,O_RDWR | O_CLOEXEC);
+   bus->stretch = (bus->fd < 0) ? 0 : I2CDEV_Stretch(adapter);
+   
+   return (bus->fd < 0) ? 1 : 0;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Name:	I2CDEV_Close
+// Function:  	Close the device file
+//            
+// Parameter: 	bus
+// Return:    	-
+//--------------------------------------------------------------------------------------------------
+void I2CDEV_Close(I2CDEV_Bus *bus)
+{
+   if(bus->fd >= 0) close(bus->fd);
+   bus->fd = -1;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Name:	I2CDEV_Transfer
+// Function:  	Transport operation: run segments as one transaction
+//		The segments map one to one to i2c_msg, the whole transaction is one I2C_RDWR
+//		call. Adapter drivers report a missing acknowledge as ENXIO, EREMOTEIO or EIO.
+//            
+// Parameter: 	bus, segments, number of segments
+// Return:    	I2C_ERR_xxx bits, 0 = OK
+//--------------------------------------------------------------------------------------------------
+uint8_t I2CDEV_Transfer(void *ctx,I2C_Msg *msgs,uint8_t n)
+{
+   I2CDEV_Bus *bus = ctx;
+   struct i2c_msg m[I2CDEV_MAX_MSGS];
+   struct i2c_rdwr_ioctl_data xfer = { m, n };
+   uint8_t i;
+   
+   if(bus->fd < 0 || n > I2CDEV_MAX_MSGS) return I2C_ERR_BUS;
+   
+   for(i=0;i<n;i++)
+   {
+      m[i].addr  = msgs[i].addr;
+      m[i].flags = (msgs[i].flags & I2C_MSG_RD) ? I2C_M_RD : 0;
+      m[i].len   = msgs[i].len;
+      m[i].buf   = msgs[i].buf;
+   }
+   if(ioctl(bus->fd,I2C_RDWR,&xfer) == (int)n) return 0;
+   
+   switch(errno)
+   {
+      case ENXIO:
+      case EREMOTEIO:
+      case EIO:
+         return I2C_ERR_NACK;
+      case ETIMEDOUT:
+         return I2C_ERR_TIMEOUT;
+      default:
+         return I2C_ERR_BUS;
+   }
+}
+
+//--------------------------------------------------------------------------------------------------
+// Name:	I2CDEV_Stretch
+// Function:  	Check whether an adapter waits for a device stretching the clock for a conversion
+//		The driver is recognised by the adapter name in sysfs. An adapter whose name
+//		cannot be read is taken as one that does not.
+//            
+// Parameter: 	adapter number N of /dev/i2c-N
+// Return:    	1 = long clock stretching supported, 0 = device has to be polled
+//--------------------------------------------------------------------------------------------------
+static uint8_t I2CDEV_Stretch(uint8_t adapter)
+{
+   char path[48];
+   char name[64];
+   FILE *f;
+   uint8_t i;
+   
+   snprintf(path,sizeof(path),"/sys/class/i2c-dev/i2c-%u/name",adapter);
+   f = fopen(path,"re");
+   if(f == NULL) return 0;
+   if(fgets(name,sizeof(name),f) == NULL) name[0] = 0;
+   fclose(f);
+   if(name[0] == 0) return 0;
+   
+   for(i=0;no_stretch[i];i++)
+   {
+      if(strncmp(name,no_stretch[i],strlen(no_stretch[i])) == 0) return 0;
+   }
+   return 1;
+}
@@ -0,0 +1,47 @@
+//--------------------------------------------------------------------------------------------------
+//
+// Filename:    i2cdev.h
+// Description: I2C through the Linux i2c-dev interface (/dev/i2c-N)
+//              
+// Author:      agent
+// History:     17.10.2026 Initial version
+//              17.10.2026 Whole transactions through I2CDEV_Transfer()
+//              17.10.2026 Hold master mode only on adapters with long clock stretching
+//--------------------------------------------------------------------------------------------------
+
+#ifndef I2CDEV_H
+#define I2CDEV_H
+
+//=== Includes =====================================================================================	
+
+#include <stdint.h>
+#include "i2cbus.h"
+
+//=== Preprocessing directives (#define) ===========================================================
+
+//=== Type definitions (typedef) ===================================================================
+
+// One adapter of the kernel I2C subsystem. No register mapping is needed, only access to the
+// device file (e.g. membership of the i2c group), and it works on any SoC with an I2C driver.
+
+typedef struct
+{
+   int fd;			// open device file, -1 if closed
+   uint8_t stretch;		// 1 if the adapter waits for long clock stretching, see I2CDEV_Open()
+} I2CDEV_Bus;
+
+//=== Global constants (extern) ====================================================================
+
+extern const I2C_Ops I2CDEV_Ops;	// transport operations, context is an I2CDEV_Bus
+extern const I2C_Ops I2CDEV_HoldOps;	// the same for hold master mode (I2C_Ops.stretch = 1)
+
+//=== Global variables (extern) ====================================================================
+
+//=== Global function prototypes ===================================================================
+
+uint8_t I2CDEV_Open(I2CDEV_Bus *bus,uint8_t adapter);
+void    I2CDEV_Close(I2CDEV_Bus *bus);
+
+uint8_t I2CDEV_Transfer(void *ctx,I2C_Msg *msgs,uint8_t n);
+
+#endif
@@ -0,0 +1,338 @@
+//--------------------------------------------------------------------------------------------------
+//
+// Filename:    i2cfix.h
+// Description: I2C software implementation on pins fixed at build time
+//              Define SI2C_FIX_SCL and SI2C_FIX_SDA before including this file. All register
+//              offsets and masks are then constants and the bus is inlined into the including
+//              file, so every edge is a single store and every sample a single load, without
+//              the pin arithmetic and calls of the SI2C_Bus functions.
+//
+//                #define SI2C_FIX_SCL 45
+//                #define SI2C_FIX_SDA 44
+//                #include "i2cfix.h"
+//
+//                SHT21_Init(SI2C_FIX_SCL,SI2C_FIX_SDA);	// maps the registers
+//                SI2C_FixInit(0);
+//                SHT21_OpenBus(&dev,SI2C_FixOps(),NULL);
+//
+//              One fixed bus per translation unit. The transport does not wait for a device
+//              stretching the clock through a whole conversion (I2C_Ops.stretch = 0), the
+//              sensor layer polls instead. Like SI2C_Transfer() a transaction locks the GPFSEL
+//              registers of its pins (SI2C_LockBanks()), so buses sharing a register with the
+//              fixed one take turns with it.
+//
+// Author:      agent
+// History:     17.10.2026 Initial version
+//              17.10.2026 GPFSEL registers locked by a transaction
+//--------------------------------------------------------------------------------------------------
+
+#ifndef I2CFIX_H
+#define I2CFIX_H
+
+#if !defined(SI2C_FIX_SCL) || !defined(SI2C_FIX_SDA)
+#error "define SI2C_FIX_SCL and SI2C_FIX_SDA before including i2cfix.h"
+#endif
+
+//=== Includes =====================================================================================
+
+#include <stdint.h>
+#include "bcm2835.h"
+#include "i2cbus.h"
+#include "i2c.h"
+
+//=== Preprocessing directives (#define) ===========================================================
+
+// GPFSEL registers and function select bits of the pins, index 1 is used only when the pins
+// are in different registers
+#define SI2C_FIX_FSEL_SCL	(BCM2835_GPFSEL0/4 + SI2C_FIX_SCL/10)
+#define SI2C_FIX_FSEL_SDA	(BCM2835_GPFSEL0/4 + SI2C_FIX_SDA/10)
+#define SI2C_FIX_MASK_SCL	(BCM2835_GPIO_FSEL_MASK << ((SI2C_FIX_SCL % 10) * 3))
+#define SI2C_FIX_MASK_SDA	(BCM2835_GPIO_FSEL_MASK << ((SI2C_FIX_SDA % 10) * 3))
+#define SI2C_FIX_OUT_SCL	(BCM2835_GPIO_FSEL_OUTP << ((SI2C_FIX_SCL % 10) * 3))
+#define SI2C_FIX_OUT_SDA	(BCM2835_GPIO_FSEL_OUTP << ((SI2C_FIX_SDA % 10) * 3))
+#define SI2C_FIX_IDX_SCL	0
+#define SI2C_FIX_IDX_SDA	((SI2C_FIX_SCL/10 == SI2C_FIX_SDA/10) ? 0 : 1)
+#define SI2C_FIX_BANKS		((1u << (SI2C_FIX_SCL/10)) | (1u << (SI2C_FIX_SDA/10)))
+
+// GPLEV registers and level bits of the pins
+#define SI2C_FIX_LEV_SCL	(BCM2835_GPLEV0/4 + SI2C_FIX_SCL/32)
+#define SI2C_FIX_LEV_SDA	(BCM2835_GPLEV0/4 + SI2C_FIX_SDA/32)
+#define SI2C_FIX_BIT_SCL	(1u << (SI2C_FIX_SCL % 32))
+#define SI2C_FIX_BIT_SDA	(1u << (SI2C_FIX_SDA % 32))
+
+// The bus functions are inlined even where the compiler would rather call them
+#define SI2C_FIX_INLINE		static inline __attribute__((always_inline))
+
+//=== Type definitions (typedef) ===================================================================
+
+// State of a transaction, kept in registers once the functions are inlined
+typedef struct
+{
+   volatile uint32_t *gpio;	// GPIO block
+   uint32_t fsel[2];		// GPFSEL registers of the pins, as last written
+   uint32_t delay;		// busy wait loops per quarter clock period
+} SI2C_FixCtx;
+
+//=== Global constants (extern) ====================================================================
+
+//=== Global variables (extern) ====================================================================
+
+static uint32_t si2c_fix_delay;		// set by SI2C_FixInit()
+
+//=== Global function prototypes ===================================================================
+
+//--------------------------------------------------------------------------------------------------
+// Name:	SI2C_FixScl / SI2C_FixSda
+// Function:  	Release (1, input, pulled up) or drive low (0, output) the clock / data line
+//
+// Parameter: 	transaction state, 0 / 1
+// Return:    	-
+//--------------------------------------------------------------------------------------------------
+SI2C_FIX_INLINE void SI2C_FixScl(SI2C_FixCtx *c,uint8_t State)
+{
+   if(State) c->fsel[SI2C_FIX_IDX_SCL] &= ~SI2C_FIX_MASK_SCL;
+   else      c->fsel[SI2C_FIX_IDX_SCL] |= SI2C_FIX_OUT_SCL;
+   bcm2835_burst_write(c->gpio + SI2C_FIX_FSEL_SCL,c->fsel[SI2C_FIX_IDX_SCL]);
+}
+
+SI2C_FIX_INLINE void SI2C_FixSda(SI2C_FixCtx *c,uint8_t State)
+{
+   if(State) c->fsel[SI2C_FIX_IDX_SDA] &= ~SI2C_FIX_MASK_SDA;
+   else      c->fsel[SI2C_FIX_IDX_SDA] |= SI2C_FIX_OUT_SDA;
+   bcm2835_burst_write(c->gpio + SI2C_FIX_FSEL_SDA,c->fsel[SI2C_FIX_IDX_SDA]);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Name:	SI2C_FixGetScl / SI2C_FixGetSda
+// Function:  	Read the level of the clock / data line
+//
+// Parameter: 	transaction state
+// Return:    	not 0 if the line is high
+//--------------------------------------------------------------------------------------------------
+SI2C_FIX_INLINE uint32_t SI2C_FixGetScl(SI2C_FixCtx *c)
+{
+   return bcm2835_burst_read(c->gpio + SI2C_FIX_LEV_SCL) & SI2C_FIX_BIT_SCL;
+}
+
+SI2C_FIX_INLINE uint32_t SI2C_FixGetSda(SI2C_FixCtx *c)
+{
+   return bcm2835_burst_read(c->gpio + SI2C_FIX_LEV_SDA) & SI2C_FIX_BIT_SDA;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Name:	SI2C_FixWaitScl
+// Function:  	Release the clock and wait a little while a device stretches it
+//
+// Parameter: 	transaction state
+// Return:    	-
+//--------------------------------------------------------------------------------------------------
+SI2C_FIX_INLINE void SI2C_FixWaitScl(SI2C_FixCtx *c)
+{
+   uint8_t t = 100;
+
+   SI2C_FixScl(c,1);
+   SI2C_Delay(c->delay);
+   while(!SI2C_FixGetScl(c) && t--);
+   SI2C_Delay(c->delay);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Name:	SI2C_FixInit
+// Function:  	Set up the pins of the fixed bus: output latches low, lines released
+//		The registers must be mapped (bcm2835_init(), e.g. through SHT21_Init()).
+//
+// Parameter: 	clock frequency in Hz (0 = as fast as possible)
+// Return:    	-
+//--------------------------------------------------------------------------------------------------
+__attribute__((unused)) static void SI2C_FixInit(uint32_t Hz)
+{
+   SI2C_LockBanks(SI2C_FIX_BANKS);
+   bcm2835_gpio_fsel(SI2C_FIX_SCL,BCM2835_GPIO_FSEL_INPT);
+   bcm2835_gpio_fsel(SI2C_FIX_SDA,BCM2835_GPIO_FSEL_INPT);
+   SI2C_UnlockBanks(SI2C_FIX_BANKS);
+   bcm2835_gpio_clr(SI2C_FIX_SCL);
+   bcm2835_gpio_clr(SI2C_FIX_SDA);
+   si2c_fix_delay = SI2C_DelayLoops(Hz);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Name:	SI2C_FixBegin / SI2C_FixEnd
+// Function:  	Open / close the burst of GPIO accesses of a transaction
+//		The function select registers are reloaded, other pins in them may have changed.
+//		The caller holds their locks, see SI2C_FixTransfer().
+//
+// Parameter: 	transaction state
+// Return:    	-
+//--------------------------------------------------------------------------------------------------
+SI2C_FIX_INLINE void SI2C_FixBegin(SI2C_FixCtx *c)
+{
+   c->gpio = bcm2835_gpio;
+   c->delay = si2c_fix_delay;
+   bcm2835_burst_begin();
+   c->fsel[SI2C_FIX_IDX_SCL] = bcm2835_burst_read(c->gpio + SI2C_FIX_FSEL_SCL);
+   c->fsel[SI2C_FIX_IDX_SDA] = bcm2835_burst_read(c->gpio + SI2C_FIX_FSEL_SDA);
+}
+
+SI2C_FIX_INLINE void SI2C_FixEnd(SI2C_FixCtx *c)
+{
+   (void)c;
+   bcm2835_burst_end();
+}
+
+//--------------------------------------------------------------------------------------------------
+// Name:	SI2C_FixStart
+// Function:  	Transmit start sequence (also repeated start)
+//
+// Parameter: 	transaction state
+// Return:    	-
+//--------------------------------------------------------------------------------------------------
+SI2C_FIX_INLINE void SI2C_FixStart(SI2C_FixCtx *c)
+{
+   SI2C_FixScl(c,1);
+   SI2C_FixSda(c,1);
+   SI2C_Delay(2 * c->delay);
+   SI2C_FixSda(c,0);
+   SI2C_Delay(2 * c->delay);
+   SI2C_FixScl(c,0);
+   SI2C_Delay(2 * c->delay);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Name:	SI2C_FixStop
+// Function:  	Transmit stop sequence
+//
+// Parameter: 	transaction state
+// Return:    	-
+//--------------------------------------------------------------------------------------------------
+SI2C_FIX_INLINE void SI2C_FixStop(SI2C_FixCtx *c)
+{
+   SI2C_FixSda(c,0);
+   SI2C_Delay(2 * c->delay);
+   SI2C_FixScl(c,1);
+   SI2C_Delay(2 * c->delay);
+   SI2C_FixSda(c,1);
+   SI2C_Delay(2 * c->delay);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Name:	SI2C_FixSendByte
+// Function:  	Send a byte
+//
+// Parameter: 	transaction state, byte
+// Return:    	1=NACK 0=ACK
+//--------------------------------------------------------------------------------------------------
+SI2C_FIX_INLINE uint8_t SI2C_FixSendByte(SI2C_FixCtx *c,uint8_t Data)
+{
+   uint8_t i,r;
+
+   for(i=0;i<8;i++)
+   {
+      SI2C_FixSda(c,Data & 0x80);
+      Data <<= 1;
+      SI2C_Delay(c->delay);
+      SI2C_FixWaitScl(c);
+      SI2C_FixScl(c,0);
+      SI2C_Delay(c->delay);
+   }
+   SI2C_FixSda(c,1);
+   SI2C_Delay(c->delay);
+   SI2C_FixWaitScl(c);
+   r = SI2C_FixGetSda(c) ? 1 : 0;
+   SI2C_FixScl(c,0);
+   SI2C_Delay(c->delay);
+   return r;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Name:	SI2C_FixReadByte
+// Function:  	Read a byte
+//
+// Parameter: 	transaction state, 1 = acknowledge (more bytes follow), 0 = no acknowledge
+// Return:    	byte read
+//--------------------------------------------------------------------------------------------------
+SI2C_FIX_INLINE uint8_t SI2C_FixReadByte(SI2C_FixCtx *c,uint8_t Ack)
+{
+   uint8_t i,d = 0;
+
+   SI2C_FixSda(c,1);
+   for(i=0;i<8;i++)
+   {
+      SI2C_Delay(c->delay);
+      SI2C_FixWaitScl(c);
+      d = (d << 1) | (SI2C_FixGetSda(c) ? 1 : 0);
+      SI2C_Delay(c->delay);
+      SI2C_FixScl(c,0);
+      SI2C_Delay(c->delay);
+   }
+   SI2C_FixSda(c,!Ack);
+   SI2C_Delay(c->delay);
+   SI2C_FixWaitScl(c);
+   SI2C_FixScl(c,0);
+   SI2C_Delay(c->delay);
+   SI2C_FixSda(c,1);
+   return d;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Name:	SI2C_FixTransfer
+// Function:  	Transport operation: run segments as one transaction on the fixed bus
+//
+// Parameter: 	context (not used), segments, number of segments
+// Return:    	I2C_ERR_xxx bits, 0 = OK
+//--------------------------------------------------------------------------------------------------
+static inline uint8_t SI2C_FixTransfer(void *ctx,I2C_Msg *msgs,uint8_t n)
+{
+   SI2C_FixCtx c;
+   uint8_t error = 0;
+   uint8_t i,len;
+   uint8_t *buf;
+
+   (void)ctx;
+   SI2C_LockBanks(SI2C_FIX_BANKS);
+   SI2C_FixBegin(&c);
+   for(i=0;i<n && !error;i++)
+   {
+      SI2C_FixStart(&c);
+      buf = msgs[i].buf;
+      len = msgs[i].len;
+
+      if(msgs[i].flags & I2C_MSG_RD)
+      {
+         if(SI2C_FixSendByte(&c,(msgs[i].addr << 1) + 1)) error = I2C_ERR_NACK;	// Addr + RD
+         while(len-- && !error) *buf++ = SI2C_FixReadByte(&c,len != 0);
+      }
+      else
+      {
+         if(SI2C_FixSendByte(&c,msgs[i].addr << 1)) error = I2C_ERR_NACK;	// Addr + WR
+         while(len-- && !error)
+         {
+            if(SI2C_FixSendByte(&c,*buf++)) error = I2C_ERR_NACK;
+         }
+      }
+   }
+   SI2C_FixStop(&c);
+   SI2C_FixEnd(&c);
+   SI2C_UnlockBanks(SI2C_FIX_BANKS);
+   return error;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Name:	SI2C_FixOps
+// Function:  	Transport operations of the fixed bus, for SHT21_OpenBus() (context NULL)
+//
+// Parameter: 	-
+// Return:    	operations
+//--------------------------------------------------------------------------------------------------
+static inline const I2C_Ops *SI2C_FixOps(void)
+{
+   static const I2C_Ops ops =
+   {
+      "gpio-fixed",
+      0,
+      SI2C_FixTransfer
+   };
+
+   return &ops;
+}
+
+#endif
@@ -0,0 +1,548 @@
+//--------------------------------------------------------------------------------------------------
+//
+// Filename:    mi2c.c
+// Description: Parallel I2C Software Implementierung for several sensors
+//              All SDA lines are switched together and sampled with a single read of the GPLEV
+//              register per clock edge, so N devices are read in the time of one.
+//              On the GPIO character device the same is done with one ioctl per edge or sample.
+//
+// Open Source Licensing 
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// Author:      agent
+// History:     17.10.2026 Initial version
+//              17.10.2026 Shadow GPFSEL registers, one store per edge
+//              17.10.2026 Calibrated busy wait delay, configurable clock
+//              17.10.2026 Lines through the GPIO character device, transport MI2C_Ops
+//              17.10.2026 GPIO accesses of a transaction in one barrier-free burst
+//              17.10.2026 GPFSEL registers locked against the SI2C buses
+//              17.10.2026 Measurement resolution of the devices
+//--------------------------------------------------------------------------------------------------
+
+//=== Includes =====================================================================================
+
+#include <stdint.h>
+#include "mi2c.h"
+#include "i2c.h"
+#include "gpiochip.h"
+#include "bcm2835.h"
+#include "bcm2835sim.h"
+
+//=== Preprocessing directives (#define) ===========================================================
+
+#define	SCL_1		MI2C_SetScl(bus,1)		// Input -> 1 via pullup (push-pull: high)
+#define	SCL_0		MI2C_SetScl(bus,0)		// Output -> 0 to GND
+#define	SCL		MI2C_GetScl(bus)
+#define	SDA_1		MI2C_SetSda(bus,1)		// All SDA lines input -> 1 via pullup
+#define	SDA_0		MI2C_SetSda(bus,0)		// All SDA lines output -> 0 to GND
+#define	LEV		MI2C_GetLev(bus)		// All SDA lines at once
+
+#define	SSI2C_DELAY	SI2C_Delay(bus->delay);
+
+//=== Type definitions (typedef) ===================================================================
+
+//=== Global constants =============================================================================
+
+const I2C_Ops MI2C_Ops =
+{
+   "gpiochip",
+   0,
+   MI2C_Transfer
+};
+
+//=== Global variables =============================================================================
+
+//=== Local constants  =============================================================================
+
+//=== Local variables ==============================================================================
+
+//=== Local function prototypes ====================================================================
+
+static void MI2C_SetScl(MI2C_Bus *bus,uint8_t State);
+static void MI2C_SetSda(MI2C_Bus *bus,uint8_t State);
+static uint32_t MI2C_GetScl(MI2C_Bus *bus);
+static uint32_t MI2C_GetLev(MI2C_Bus *bus);
+static void MI2C_WaitScl(MI2C_Bus *bus);
+static uint32_t MI2C_Demux(MI2C_Bus *bus,uint32_t Lev);
+
+//--------------------------------------------------------------------------------------------------
+// Name:	MI2C_Init
+// Function:  	"Connect" GPIO-Pins to a parallel bus
+//            
+// Parameter: 	bus, scl pins (1 shared or one per device), number of scl pins,
+//		sda pins, number of devices
+// Return:    	0=OK 1=invalid pin assignment
+//--------------------------------------------------------------------------------------------------
+uint8_t MI2C_Init(MI2C_Bus *bus,const uint8_t *scl,uint8_t nscl,const uint8_t *sda,uint8_t n)
+{
+   uint8_t i,j,reg,bank;
+   
+   if(n == 0 || n > MI2C_MAX_LINES) return 1;
+   if(nscl != 1 && nscl != n) return 1;
+   
+   bank = sda[0] / 32;
+   bus->lines.fd = -1;
+   bus->n = n;
+   bus->resolution = 0;
+   bus->nscl = nscl;
+   bus->scl = scl[0];
+   bus->scl_mask = 0;
+   bus->nfsel = 0;
+   bus->banks = 0;
+   
+   for(i=0;i<nscl;i++)
+   {
+      if(scl[i] / 32 != bank) return 1;
+      if(nscl > 1 && bank != 0) return 1;		// push-pull SCL uses GPSET0/GPCLR0
+      bus->scl_mask |= (uint32_t)1 << (scl[i] % 32);
+      bus->banks |= 1u << (scl[i] / 10);
+   }
+   
+   for(i=0;i<n;i++)
+   {
+      if(sda[i] / 32 != bank) return 1;
+      bus->sda[i] = sda[i];
+      bus->shift[i] = sda[i] % 32;
+      
+      // Collect the function select bits of all SDA pins per GPFSEL register
+      reg = sda[i] / 10;
+      for(j=0;j<bus->nfsel && bus->fsel_reg[j] != reg;j++);
+      if(j == bus->nfsel)
+      {
+         bus->fsel_reg[j] = reg;
+         bus->fsel_mask[j] = 0;
+         bus->fsel_out[j] = 0;
+         bus->nfsel++;
+         bus->banks |= 1u << reg;
+      }
+      bus->fsel_mask[j] |= BCM2835_GPIO_FSEL_MASK << ((sda[i] % 10) * 3);
+      bus->fsel_out[j] |= BCM2835_GPIO_FSEL_OUTP << ((sda[i] % 10) * 3);
+      
+      bcm2835_gpio_clr(sda[i]);			// output latch low for open drain
+   }
+   
+   bus->lev = bcm2835_gpio + BCM2835_GPLEV0/4 + bank;
+   
+   SI2C_LockBanks(bus->banks);
+   if(nscl == 1)
+   {
+      bcm2835_gpio_clr(bus->scl);
+      bcm2835_gpio_fsel(bus->scl,BCM2835_GPIO_FSEL_INPT);
+   }
+   else
+   {
+      bcm2835_gpio_set_multi(bus->scl_mask);
+      for(i=0;i<nscl;i++) bcm2835_gpio_fsel(scl[i],BCM2835_GPIO_FSEL_OUTP);
+   }
+   MI2C_SetSpeed(bus,SI2C_DEFAULT_HZ);
+   MI2C_Resync(bus);
+   SDA_1;
+   bcm2835_burst_end();
+   SI2C_UnlockBanks(bus->banks);
+   return 0;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Name:	MI2C_InitChip
+// Function:  	Set up a parallel bus on lines of the GPIO character device /dev/gpiochipN
+//		All SDA and SCL lines are requested as one set of open drain lines, bit i of a
+//		level sample is SDA line i. Any lines of the chip can be used.
+//            
+// Parameter: 	bus, N of /dev/gpiochipN, scl lines (1 shared or one per device), number of scl
+//		lines, sda lines, number of devices
+// Return:    	0=OK 1=invalid assignment or lines not available
+//--------------------------------------------------------------------------------------------------
+uint8_t MI2C_InitChip(MI2C_Bus *bus,uint8_t chip,const uint8_t *scl,uint8_t nscl,
+                      const uint8_t *sda,uint8_t n)
+{
+   uint8_t offsets[GPIOCHIP_MAX_LINES];
+   uint8_t i;
+   
+   bus->lines.fd = -1;
+   if(n == 0 || n > MI2C_MAX_LINES) return 1;
+   if(nscl != 1 && nscl != n) return 1;
+   
+   bus->n = n;
+   bus->resolution = 0;
+   bus->nscl = nscl;
+   bus->scl = scl[0];
+   bus->scl_mask = 0;
+   bus->nfsel = 0;
+   bus->banks = 0;
+   bus->lines_sda = 0;
+   bus->lines_scl = 0;
+   
+   // Request: SDA lines first, then the SCL lines
+   for(i=0;i<n;i++)
+   {
+      bus->sda[i] = sda[i];
+      bus->shift[i] = i;
+      offsets[i] = sda[i];
+      bus->lines_sda |= (uint64_t)1 << i;
+   }
+   for(i=0;i<nscl;i++)
+   {
+      offsets[n + i] = scl[i];
+      bus->lines_scl |= (uint64_t)1 << (n + i);
+   }
+   
+   if(GPIOCHIP_Open(&bus->lines,chip,offsets,n + nscl) != 0) return 1;
+   
+   MI2C_SetSpeed(bus,SI2C_DEFAULT_HZ);
+   return 0;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Name:	MI2C_Close
+// Function:  	Release the lines of a bus set up by MI2C_InitChip(), nothing to do otherwise
+//            
+// Parameter: 	bus
+// Return:    	-
+//--------------------------------------------------------------------------------------------------
+void MI2C_Close(MI2C_Bus *bus)
+{
+   GPIOCHIP_Close(&bus->lines);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Name:	MI2C_SetSpeed
+// Function:  	Set the clock frequency of a parallel bus, see SI2C_SetSpeed()
+//            
+// Parameter: 	bus, clock frequency in Hz (0 = as fast as possible)
+// Return:    	-
+//--------------------------------------------------------------------------------------------------
+void MI2C_SetSpeed(MI2C_Bus *bus,uint32_t Hz)
+{
+   bus->delay = SI2C_DelayLoops(Hz);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Name:	MI2C_Start
+// Function:  	Transmit start sequence on all lines
+//            
+// Parameter: 	bus
+// Return:    	-
+//--------------------------------------------------------------------------------------------------
+void MI2C_Start(MI2C_Bus *bus)
+{
+   MI2C_Resync(bus);
+   SCL_1; 
+   SDA_1; 
+   SSI2C_DELAY;
+   SSI2C_DELAY;
+   SDA_0;
+   SSI2C_DELAY;
+   SSI2C_DELAY;
+   SCL_0; 
+   SSI2C_DELAY;
+   SSI2C_DELAY;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Name:	MI2C_Stop
+// Function:  	Transmit stop sequence on all lines
+//            
+// Parameter: 	bus
+// Return:    	-
+//--------------------------------------------------------------------------------------------------
+void MI2C_Stop(MI2C_Bus *bus)
+{
+   SDA_0;			
+   SSI2C_DELAY;
+   SSI2C_DELAY;
+   SCL_1; 
+   SSI2C_DELAY;
+   SSI2C_DELAY;
+   SDA_1;
+   SSI2C_DELAY;
+   SSI2C_DELAY;
+   bcm2835_burst_end();
+}
+
+//--------------------------------------------------------------------------------------------------
+// Name:	MI2C_SendByte
+// Function:  	Send the same byte to all devices
+//            
+// Parameter: 	bus, Byte
+// Return:    	NACK mask, bit i set if device i did not acknowledge
+//--------------------------------------------------------------------------------------------------
+uint32_t MI2C_SendByte(MI2C_Bus *bus,uint8_t Data)
+{
+   uint8_t i;
+   uint32_t lev;
+   
+   for(i=0;i<8;i++)
+   {
+      if(Data & 0x80) { SDA_1; }
+      else		{ SDA_0; }
+      Data <<= 1;
+      SSI2C_DELAY;
+      SCL_1; 
+      SSI2C_DELAY;
+      MI2C_WaitScl(bus);				// Clockstretching
+      SCL_0; 
+      SSI2C_DELAY;
+   }
+   SDA_1;		
+   
+   SSI2C_DELAY;		
+   SCL_1;
+   SSI2C_DELAY;
+   MI2C_WaitScl(bus);				// Clockstretching
+   
+   lev = LEV;					// ACK bits of all devices
+   SCL_0;
+   SSI2C_DELAY;
+   return MI2C_Demux(bus,lev);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Name:	MI2C_ReadByte
+// Function:  	Read one byte from every device
+//		The GPLEV register is read once per bit, the bits of the devices are sorted out
+//		after the byte is complete.
+//            
+// Parameter: 	bus, Ack  1= set ACK bit (low) 0= no ACK (high), Data  one byte per device
+// Return:    	-
+//--------------------------------------------------------------------------------------------------
+void MI2C_ReadByte(MI2C_Bus *bus,uint8_t Ack,uint8_t *Data)
+{
+   uint8_t i,d,shift;
+   uint32_t lev[8];
+   
+   SDA_1;				// all lines input
+   for(i=0;i<8;i++)
+   {
+      SSI2C_DELAY;
+      SCL_1; 
+      SSI2C_DELAY;
+      MI2C_WaitScl(bus);		// Clockstretching 
+      
+      lev[i] = LEV;			// one bit of every device
+      
+      SSI2C_DELAY;			
+      SCL_0;		
+      SSI2C_DELAY;
+   }
+   
+   if(Ack) 	{ SDA_0; }
+   else	{ SDA_1; }
+   SSI2C_DELAY;
+   SCL_1; 
+   SSI2C_DELAY;
+   MI2C_WaitScl(bus);			// Clockstretching 
+   SCL_0;
+   SSI2C_DELAY;
+   SDA_1;
+   
+   // Demultiplex the sampled bits
+   for(i=0;i<bus->n;i++)
+   {
+      shift = bus->shift[i];
+      d  = ((lev[0] >> shift) & 1) << 7;
+      d |= ((lev[1] >> shift) & 1) << 6;
+      d |= ((lev[2] >> shift) & 1) << 5;
+      d |= ((lev[3] >> shift) & 1) << 4;
+      d |= ((lev[4] >> shift) & 1) << 3;
+      d |= ((lev[5] >> shift) & 1) << 2;
+      d |= ((lev[6] >> shift) & 1) << 1;
+      d |= ((lev[7] >> shift) & 1);
+      Data[i] = d;
+   }
+}
+
+//--------------------------------------------------------------------------------------------------
+// Name:	MI2C_SetScl
+// Function:  	Control the SCL line(s)
+//            
+// Parameter: 	bus, 0 / 1
+// Return:    	-
+//--------------------------------------------------------------------------------------------------
+static void MI2C_SetScl(MI2C_Bus *bus,uint8_t State)
+{
+   uint8_t r;
+   
+   if(bus->lines.fd >= 0)
+   {
+      GPIOCHIP_Set(&bus->lines,bus->lines_scl,State ? bus->lines_scl : 0);
+   }
+   else if(bus->nscl == 1)
+   {
+      r = bus->scl / 10;
+      if(State) bus->shadow[r] &= ~(BCM2835_GPIO_FSEL_MASK << ((bus->scl % 10) * 3));
+      else      bus->shadow[r] |= BCM2835_GPIO_FSEL_OUTP << ((bus->scl % 10) * 3);
+      bcm2835_burst_write(bcm2835_gpio + BCM2835_GPFSEL0/4 + r,bus->shadow[r]);
+   }
+   else
+   {
+      bcm2835_burst_write(bcm2835_gpio + (State ? BCM2835_GPSET0 : BCM2835_GPCLR0)/4,bus->scl_mask);
+   }
+}
+
+//--------------------------------------------------------------------------------------------------
+// Name:	MI2C_SetSda
+// Function:  	Control all SDA lines together, one store per GPFSEL register
+//            
+// Parameter: 	bus, 0 / 1
+// Return:    	-
+//--------------------------------------------------------------------------------------------------
+static void MI2C_SetSda(MI2C_Bus *bus,uint8_t State)
+{
+   uint8_t j,r;
+   
+   if(bus->lines.fd >= 0)
+   {
+      GPIOCHIP_Set(&bus->lines,bus->lines_sda,State ? bus->lines_sda : 0);
+      return;
+   }
+   for(j=0;j<bus->nfsel;j++)
+   {
+      r = bus->fsel_reg[j];
+      if(State) bus->shadow[r] &= ~bus->fsel_mask[j];
+      else      bus->shadow[r] |= bus->fsel_out[j];
+      bcm2835_burst_write(bcm2835_gpio + BCM2835_GPFSEL0/4 + r,bus->shadow[r]);
+   }
+}
+
+//--------------------------------------------------------------------------------------------------
+// Name:	MI2C_GetScl / MI2C_GetLev
+// Function:  	Read the SCL line(s) / sample all SDA lines at once
+//            
+// Parameter: 	bus
+// Return:    	not 0 if SCL is high / bit shift[i] = level of the SDA line of device i
+//--------------------------------------------------------------------------------------------------
+static uint32_t MI2C_GetScl(MI2C_Bus *bus)
+{
+   if(bus->lines.fd >= 0)
+   {
+      return GPIOCHIP_Get(&bus->lines,bus->lines_scl) == bus->lines_scl;
+   }
+   return bcm2835_burst_read(bus->lev) & bus->scl_mask;
+}
+
+static uint32_t MI2C_GetLev(MI2C_Bus *bus)
+{
+   if(bus->lines.fd >= 0)
+   {
+      return (uint32_t)GPIOCHIP_Get(&bus->lines,bus->lines_sda);
+   }
+   return bcm2835_burst_read(bus->lev);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Name:	MI2C_Resync
+// Function:  	Reload the shadow copies of the GPFSEL registers of a bus, done by every
+//		MI2C_Start()
+//		Opens the burst of GPIO accesses of a transaction, closed by MI2C_Stop().
+//            
+// Parameter: 	bus
+// Return:    	-
+//--------------------------------------------------------------------------------------------------
+void MI2C_Resync(MI2C_Bus *bus)
+{
+   uint8_t j;
+   
+   if(bus->lines.fd >= 0) return;		// no shadow registers
+   bcm2835_burst_begin();
+   for(j=0;j<bus->nfsel;j++)
+   {
+      bus->shadow[bus->fsel_reg[j]] = bcm2835_burst_read(bcm2835_gpio + BCM2835_GPFSEL0/4 + bus->fsel_reg[j]);
+   }
+   if(bus->nscl == 1)
+   {
+      bus->shadow[bus->scl/10] = bcm2835_burst_read(bcm2835_gpio + BCM2835_GPFSEL0/4 + bus->scl/10);
+   }
+}
+
+//--------------------------------------------------------------------------------------------------
+// Name:	MI2C_WaitScl
+// Function:  	Wait while a device stretches the shared clock
+//            
+// Parameter: 	bus
+// Return:    	-
+//--------------------------------------------------------------------------------------------------
+static void MI2C_WaitScl(MI2C_Bus *bus)
+{
+   uint8_t t;
+   
+   if(bus->nscl == 1)
+   {
+      t = 100;
+      while(!SCL && t--);
+   }
+   SSI2C_DELAY;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Name:	MI2C_Demux
+// Function:  	Extract the SDA bits of all devices from a GPLEV value
+//            
+// Parameter: 	bus, GPLEV value
+// Return:    	bit i = level of the SDA line of device i
+//--------------------------------------------------------------------------------------------------
+static uint32_t MI2C_Demux(MI2C_Bus *bus,uint32_t Lev)
+{
+   uint8_t i;
+   uint32_t r = 0;
+   
+   for(i=0;i<bus->n;i++)
+   {
+      r |= ((Lev >> bus->shift[i]) & 1) << i;
+   }
+   return r;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Name:	MI2C_Transfer
+// Function:  	Transport operation: run segments as one transaction on a bus with one device
+//		The clock is not held low for long (I2C_Ops.stretch = 0), the sensor layer polls.
+//            
+// Parameter: 	bus, segments, number of segments
+// Return:    	I2C_ERR_xxx bits, 0 = OK
+//--------------------------------------------------------------------------------------------------
+uint8_t MI2C_Transfer(void *ctx,I2C_Msg *msgs,uint8_t n)
+{
+   MI2C_Bus *bus = ctx;
+   uint8_t error = 0;
+   uint8_t i,len;
+   uint8_t *buf;
+   
+   if(bus->n != 1) return I2C_ERR_BUS;
+   
+   SI2C_LockBanks(bus->banks);
+   for(i=0;i<n && !error;i++)
+   {
+      MI2C_Start(bus);
+      buf = msgs[i].buf;
+      len = msgs[i].len;
+      
+      if(msgs[i].flags & I2C_MSG_RD)
+      {
+         if(MI2C_SendByte(bus,(msgs[i].addr << 1) + 1)) error = I2C_ERR_NACK;	// Addr + RD
+         while(len-- && !error) MI2C_ReadByte(bus,len != 0,buf++);
+      }
+      else
+      {
+         if(MI2C_SendByte(bus,msgs[i].addr << 1)) error = I2C_ERR_NACK;		// Addr + WR
+         while(len-- && !error)
+         {
+            if(MI2C_SendByte(bus,*buf++)) error = I2C_ERR_NACK;
+         }
+      }
+   }
+   MI2C_Stop(bus);
+   SI2C_UnlockBanks(bus->banks);
+   return error;
+}
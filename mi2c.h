@@ -0,0 +1,85 @@
+//--------------------------------------------------------------------------------------------------
+//
+// Filename:    mi2c.h
+// Description: Parallel I2C Software Implementierung for several sensors
+//              
+// Author:      agent
+// History:     17.10.2026 Initial version
+//              17.10.2026 Shadow GPFSEL registers, one store per edge
+//              17.10.2026 Calibrated busy wait delay, configurable clock
+//              17.10.2026 Lines through the GPIO character device, transport MI2C_Ops
+//              17.10.2026 GPFSEL registers locked against the SI2C buses
+//              17.10.2026 Measurement resolution of the devices
+//--------------------------------------------------------------------------------------------------
+
+#ifndef MI2C_H
+#define MI2C_H
+
+//=== Includes =====================================================================================	
+
+#include <stdint.h>
+#include "i2cbus.h"
+#include "gpiochip.h"
+
+//=== Preprocessing directives (#define) ===========================================================
+
+#define MI2C_MAX_LINES	32	// max number of SDA lines, all in one GPLEV register
+
+//=== Type definitions (typedef) ===================================================================
+
+// Several devices with the same address, each on its own SDA line, driven as one bus.
+// The devices share one SCL line (open drain, clock stretching possible), or each has its own
+// SCL line and all of them are driven push-pull together (GPIO 0-31 only, no clock stretching).
+// Every SDA and SCL pin must be in the same GPIO bank (GPIO 0-31 or 32-53), so one read of the
+// GPLEV register samples all lines at once.
+// Set up with MI2C_InitChip() instead, the lines are requested from the GPIO character device
+// of the kernel and switched and sampled with one ioctl each. That works on any board and with
+// any pins, and every SCL line is open drain.
+// Like an SI2C_Bus, a transaction locks the GPFSEL registers of the pins: MI2C_Transfer() does
+// so itself, around MI2C_Start() ... MI2C_Stop() the caller uses SI2C_LockBanks(bus->banks).
+
+typedef struct
+{
+   uint8_t  n;				// number of SDA lines (devices)
+   uint8_t  sda[MI2C_MAX_LINES];	// SDA pins
+   uint8_t  scl;			// shared SCL pin (nscl == 1)
+   uint8_t  nscl;			// number of SCL pins
+   uint32_t scl_mask;			// SCL pins in the bank
+   volatile uint32_t *lev;		// GPLEV register of the bank
+   uint8_t  nfsel;			// number of GPFSEL registers holding SDA pins
+   uint8_t  fsel_reg[6];		// index of these GPFSEL registers
+   uint32_t fsel_mask[6];		// function select bits of the SDA pins
+   uint32_t fsel_out[6];		// function select value for "output"
+   uint32_t shadow[6];			// shadow copies of all GPFSEL registers
+   uint8_t  banks;			// GPFSEL registers of all pins, 0 with MI2C_InitChip()
+   uint32_t delay;			// busy wait loops per quarter clock period
+   uint8_t  shift[MI2C_MAX_LINES];	// bit of each SDA line in a level sample
+   GPIOCHIP_Lines lines;		// line request of MI2C_InitChip(), fd -1 otherwise
+   uint64_t lines_scl;			// SCL lines in the request
+   uint64_t lines_sda;			// SDA lines in the request
+   uint8_t  resolution;			// measurement resolution the devices are set up for,
+					// 0 = power-on default (see SHT21_SetResolutionMulti())
+} MI2C_Bus;
+
+//=== Global constants (extern) ====================================================================
+
+extern const I2C_Ops MI2C_Ops;		// transport operations, context is an MI2C_Bus with one device
+
+//=== Global variables (extern) ====================================================================
+
+//=== Global function prototypes ===================================================================
+
+uint8_t  MI2C_Init(MI2C_Bus *bus,const uint8_t *scl,uint8_t nscl,const uint8_t *sda,uint8_t n);
+uint8_t  MI2C_InitChip(MI2C_Bus *bus,uint8_t chip,const uint8_t *scl,uint8_t nscl,
+                       const uint8_t *sda,uint8_t n);
+void     MI2C_Close(MI2C_Bus *bus);
+void     MI2C_SetSpeed(MI2C_Bus *bus,uint32_t Hz);
+void     MI2C_Resync(MI2C_Bus *bus);
+void     MI2C_Start(MI2C_Bus *bus);
+void     MI2C_Stop(MI2C_Bus *bus);
+uint32_t MI2C_SendByte(MI2C_Bus *bus,uint8_t Data);
+void     MI2C_ReadByte(MI2C_Bus *bus,uint8_t Ack,uint8_t *Data);
+
+uint8_t  MI2C_Transfer(void *ctx,I2C_Msg *msgs,uint8_t n);
+
+#endif
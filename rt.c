@@ -0,0 +1,190 @@
+//--------------------------------------------------------------------------------------------------
+//
+// Filename:    rt.c
+// Description: Real-time execution of the thread that drives the bit-banged buses
+//              The settings before RT_Enter() are kept per thread and restored by RT_Leave().
+//              Memory locking applies to the whole process, it is counted over all threads
+//              and undone when the last of them leaves.
+//
+// Open Source Licensing
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// Author:      agent
+// History:     17.10.2026 Initial version
+//              17.10.2026 Memory lock counted per process
+//--------------------------------------------------------------------------------------------------
+
+//=== Includes =====================================================================================
+
+#include <stdint.h>
+#include <string.h>
+#include <malloc.h>
+#include <alloca.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include "rt.h"
+
+//=== Preprocessing directives (#define) ===========================================================
+
+// Defaults of glibc's malloc, restored by the last RT_Leave()
+#define DEFAULT_TRIM_THRESHOLD	(128 * 1024)
+#define DEFAULT_MMAP_MAX	65536
+
+//=== Type definitions (typedef) ===================================================================
+
+//=== Global constants =============================================================================
+
+//=== Global variables =============================================================================
+
+//=== Local constants  =============================================================================
+
+//=== Local variables ==============================================================================
+
+// Settings of the thread before RT_Enter()
+static __thread uint8_t saved;
+static __thread int saved_policy;
+static __thread struct sched_param saved_param;
+static __thread cpu_set_t saved_cpus;
+static __thread uint8_t locked;		// this thread is one of lock_users
+
+// Threads in RT_Enter() that asked for locked memory
+static pthread_mutex_t lock_lock = PTHREAD_MUTEX_INITIALIZER;
+static uint32_t lock_users;
+static uint8_t mlocked;			// mlockall() succeeded for them
+
+//=== Local function prototypes ====================================================================
+
+static void RT_Prefault(uint32_t stack_kb);
+
+//--------------------------------------------------------------------------------------------------
+// Name:	RT_DefaultConfig
+// Function:  	Settings for a bus thread: SCHED_FIFO at RT_DEFAULT_PRIO, memory locked
+//
+// Parameter: 	settings to fill in, core to pin the thread to (-1 = any)
+// Return:    	-
+//--------------------------------------------------------------------------------------------------
+void RT_DefaultConfig(RT_Config *cfg,int16_t cpu)
+{
+   cfg->cpu = cpu;
+   cfg->priority = RT_DEFAULT_PRIO;
+   cfg->lock_memory = 1;
+   cfg->stack_kb = RT_DEFAULT_STACK_KB;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Name:	RT_Enter
+// Function:  	Switch the calling thread to real-time execution
+//		Memory is locked before the priority is raised, so page faults of the prefault
+//		do not run at real-time priority. Locking applies to the whole process and to
+//		memory allocated later: malloc() is told not to return memory to the system nor to
+//		use separate mappings, so the buffers stay resident.
+//
+// Parameter: 	settings
+// Return:    	0 = OK, RT_ERR_xxx bits
+//--------------------------------------------------------------------------------------------------
+uint8_t RT_Enter(const RT_Config *cfg)
+{
+   struct sched_param param;
+   cpu_set_t cpus;
+   uint8_t error = 0;
+
+   if(!saved)
+   {
+      pthread_getschedparam(pthread_self(),&saved_policy,&saved_param);
+      pthread_getaffinity_np(pthread_self(),sizeof(saved_cpus),&saved_cpus);
+      saved = 1;
+   }
+
+   if(cfg->lock_memory)
+   {
+      pthread_mutex_lock(&lock_lock);
+      if(!locked)
+      {
+         if(lock_users == 0)
+         {
+            mallopt(M_TRIM_THRESHOLD,-1);
+            mallopt(M_MMAP_MAX,0);
+            mlocked = (mlockall(MCL_CURRENT | MCL_FUTURE) == 0);
+         }
+         lock_users++;
+         locked = 1;
+      }
+      if(!mlocked) error |= RT_ERR_MLOCK;
+      pthread_mutex_unlock(&lock_lock);
+      RT_Prefault(cfg->stack_kb ? cfg->stack_kb : RT_DEFAULT_STACK_KB);
+   }
+
+   if(cfg->cpu >= 0)
+   {
+      CPU_ZERO(&cpus);
+      CPU_SET(cfg->cpu,&cpus);
+      if(pthread_setaffinity_np(pthread_self(),sizeof(cpus),&cpus) != 0) error |= RT_ERR_AFFINITY;
+   }
+
+   if(cfg->priority)
+   {
+      memset(&param,0,sizeof(param));
+      param.sched_priority = cfg->priority;
+      if(pthread_setschedparam(pthread_self(),SCHED_FIFO,&param) != 0) error |= RT_ERR_SCHED;
+   }
+   return error;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Name:	RT_Leave
+// Function:  	Restore the scheduling and affinity the calling thread had before RT_Enter()
+//		The memory is unlocked and malloc() set back to its defaults when the last thread
+//		that asked for locked memory leaves.
+//
+// Parameter: 	-
+// Return:    	-
+//--------------------------------------------------------------------------------------------------
+void RT_Leave(void)
+{
+   if(!saved) return;
+
+   pthread_setschedparam(pthread_self(),saved_policy,&saved_param);
+   pthread_setaffinity_np(pthread_self(),sizeof(saved_cpus),&saved_cpus);
+   if(locked)
+   {
+      pthread_mutex_lock(&lock_lock);
+      if(--lock_users == 0)
+      {
+         if(mlocked) munlockall();
+         mlocked = 0;
+         mallopt(M_TRIM_THRESHOLD,DEFAULT_TRIM_THRESHOLD);
+         mallopt(M_MMAP_MAX,DEFAULT_MMAP_MAX);
+      }
+      pthread_mutex_unlock(&lock_lock);
+      locked = 0;
+   }
+   saved = 0;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Name:	RT_Prefault
+// Function:  	Touch the stack the thread will use, so it is resident and locked
+//
+// Parameter: 	size in kB
+// Return:    	-
+//--------------------------------------------------------------------------------------------------
+__attribute__((noinline)) static void RT_Prefault(uint32_t stack_kb)
+{
+   volatile uint8_t *stack = alloca(stack_kb * 1024);
+   uint32_t i;
+
+   for(i=0;i<stack_kb * 1024;i+=1024) stack[i] = 0;
+}
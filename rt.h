@@ -0,0 +1,53 @@
+//--------------------------------------------------------------------------------------------------
+//
+// Filename:    rt.h
+// Description: Real-time execution of the thread that drives the bit-banged buses
+//              A bus thread that is preempted in the middle of a byte stretches the clock of the
+//              sensor, which then shows up as CRC errors and retries. RT_Enter() pins the
+//              calling thread to one core (best one isolated with isolcpus=), gives it a
+//              SCHED_FIFO priority and locks and prefaults the memory of the process. Combine it
+//              with SHT21_SetRealtime() so the transactions of the sensor make no system call
+//              either. The achieved jitter is in the bus statistics, see SHT21_GetStats().
+//
+// Author:      agent
+// History:     17.10.2026 Initial version
+//--------------------------------------------------------------------------------------------------
+
+#ifndef RT_H
+#define RT_H
+
+//=== Includes =====================================================================================
+
+#include <stdint.h>
+
+//=== Preprocessing directives (#define) ===========================================================
+
+#define RT_DEFAULT_PRIO		50		// SCHED_FIFO priority, below the kernel's IRQ threads
+#define RT_DEFAULT_STACK_KB	64		// stack prefaulted by RT_Enter()
+
+// Error bits of RT_Enter(), the other settings are applied anyway
+#define RT_ERR_AFFINITY		0x01		// thread not pinned to the core
+#define RT_ERR_SCHED		0x02		// SCHED_FIFO not granted (needs CAP_SYS_NICE)
+#define RT_ERR_MLOCK		0x04		// memory not locked (needs CAP_IPC_LOCK / RLIMIT_MEMLOCK)
+
+//=== Type definitions (typedef) ===================================================================
+
+typedef struct
+{
+   int16_t cpu;			// core to pin the thread to, -1 = leave the affinity
+   uint8_t priority;		// SCHED_FIFO priority 1..99, 0 = leave the scheduling policy
+   uint8_t lock_memory;		// 1 = lock and prefault all memory of the process
+   uint32_t stack_kb;		// stack to prefault, 0 = RT_DEFAULT_STACK_KB
+} RT_Config;
+
+//=== Global constants (extern) ====================================================================
+
+//=== Global variables (extern) ====================================================================
+
+//=== Global function prototypes ===================================================================
+
+void    RT_DefaultConfig(RT_Config *cfg,int16_t cpu);
+uint8_t RT_Enter(const RT_Config *cfg);
+void    RT_Leave(void);
+
+#endif
@@ -0,0 +1,264 @@
+//--------------------------------------------------------------------------------------------------
+//
+// Filename:    shmring.c
+// Description: Ring buffer of sensor samples in a shared memory segment
+//              Single writer, many readers, no locks. Sample n goes to slot n % slots. The
+//              writer marks the slot with sequence 2n+1 while filling it and 2n+2 when done,
+//              then advances head. A reader copies a slot between two reads of its sequence and
+//              keeps the copy only if both match the sample it expects.
+//
+// Open Source Licensing 
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// Author:      agent
+// History:     17.10.2026 Initial version
+//--------------------------------------------------------------------------------------------------
+
+//=== Includes =====================================================================================
+
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "shmring.h"
+
+//=== Preprocessing directives (#define) ===========================================================
+
+#define SHMR_MAGIC	0x53485452	// "SHTR"
+
+//=== Type definitions (typedef) ===================================================================
+
+//=== Global constants =============================================================================
+
+//=== Global variables =============================================================================
+
+//=== Local constants  =============================================================================
+
+//=== Local variables ==============================================================================
+
+//=== Local function prototypes ====================================================================
+
+static uint8_t SHMR_Copy(SHMR_Ring *r,uint64_t n,SHMR_Sample *s);
+
+//--------------------------------------------------------------------------------------------------
+// Name:	SHMR_Create
+// Function:  	Create (or take over) the ring as its writer
+//            
+// Parameter: 	handle, name of the shared memory object, number of slots (rounded up to a power
+//		of two, 0 = SHMR_DEFAULT_SLOTS)
+// Return:    	0=OK 1=ERROR
+//--------------------------------------------------------------------------------------------------
+uint8_t SHMR_Create(SHMR_Handle *h,const char *name,uint32_t slots)
+{
+   uint32_t n = 1;
+   int fd;
+   
+   if(slots == 0) slots = SHMR_DEFAULT_SLOTS;
+   while(n < slots) n <<= 1;
+   
+   h->ring = MAP_FAILED;
+   h->len = sizeof(SHMR_Ring) + (size_t)n * sizeof(SHMR_Sample);
+   
+   fd = shm_open(name,O_RDWR | O_CREAT,0644);
+   if(fd < 0) return 1;
+   if(ftruncate(fd,h->len) == 0)
+   {
+      h->ring = mmap(NULL,h->len,PROT_READ | PROT_WRITE,MAP_SHARED,fd,0);
+   }
+   close(fd);
+   if(h->ring == MAP_FAILED) return 1;
+   
+   // Readers attached to an older ring see it as invalid until it is set up again
+   __atomic_store_n(&h->ring->magic,0,__ATOMIC_RELEASE);
+   memset(h->ring->slot,0,(size_t)n * sizeof(SHMR_Sample));
+   h->ring->slots = n;
+   h->ring->head = 0;
+   __atomic_store_n(&h->ring->magic,SHMR_MAGIC,__ATOMIC_RELEASE);
+   return 0;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Name:	SHMR_Attach
+// Function:  	Map an existing ring read only
+//            
+// Parameter: 	handle, name of the shared memory object
+// Return:    	0=OK 1=ERROR (no such ring)
+//--------------------------------------------------------------------------------------------------
+uint8_t SHMR_Attach(SHMR_Handle *h,const char *name)
+{
+   struct stat st;
+   int fd;
+   
+   h->ring = MAP_FAILED;
+   
+   fd = shm_open(name,O_RDONLY,0);
+   if(fd < 0) return 1;
+   if(fstat(fd,&st) == 0 && (size_t)st.st_size >= sizeof(SHMR_Ring))
+   {
+      h->len = st.st_size;
+      h->ring = mmap(NULL,h->len,PROT_READ,MAP_SHARED,fd,0);
+   }
+   close(fd);
+   if(h->ring == MAP_FAILED) return 1;
+   
+   if(__atomic_load_n(&h->ring->magic,__ATOMIC_ACQUIRE) != SHMR_MAGIC ||
+      sizeof(SHMR_Ring) + (size_t)h->ring->slots * sizeof(SHMR_Sample) > h->len)
+   {
+      SHMR_Close(h);
+      return 1;
+   }
+   return 0;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Name:	SHMR_Close
+// Function:  	Unmap the ring, the shared memory object stays
+//            
+// Parameter: 	handle
+// Return:    	-
+//--------------------------------------------------------------------------------------------------
+void SHMR_Close(SHMR_Handle *h)
+{
+   if(h->ring != MAP_FAILED) munmap(h->ring,h->len);
+   h->ring = MAP_FAILED;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Name:	SHMR_Unlink
+// Function:  	Remove the shared memory object, mappings stay valid until closed
+//            
+// Parameter: 	name of the shared memory object
+// Return:    	-
+//--------------------------------------------------------------------------------------------------
+void SHMR_Unlink(const char *name)
+{
+   shm_unlink(name);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Name:	SHMR_Publish
+// Function:  	Append a sample (writer only)
+//            
+// Parameter: 	handle, sample (seq is ignored)
+// Return:    	-
+//--------------------------------------------------------------------------------------------------
+void SHMR_Publish(SHMR_Handle *h,const SHMR_Sample *s)
+{
+   SHMR_Ring *r = h->ring;
+   uint64_t n = r->head;
+   SHMR_Sample *slot = &r->slot[n & (r->slots - 1)];
+   
+   __atomic_store_n(&slot->seq,2*n + 1,__ATOMIC_RELAXED);
+   __atomic_thread_fence(__ATOMIC_RELEASE);
+   slot->time_us  = s->time_us;
+   slot->sensor   = s->sensor;
+   slot->error    = s->error;
+   slot->temp     = s->temp;
+   slot->humidity = s->humidity;
+   slot->reserved = 0;
+   __atomic_store_n(&slot->seq,2*n + 2,__ATOMIC_RELEASE);
+   __atomic_store_n(&r->head,n + 1,__ATOMIC_RELEASE);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Name:	SHMR_Head
+// Function:  	Number of samples written so far, the position after the newest sample
+//            
+// Parameter: 	handle
+// Return:    	head
+//--------------------------------------------------------------------------------------------------
+uint64_t SHMR_Head(SHMR_Handle *h)
+{
+   return __atomic_load_n(&h->ring->head,__ATOMIC_ACQUIRE);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Name:	SHMR_Latest
+// Function:  	Newest sample of a sensor
+//            
+// Parameter: 	handle, number of the sensor, sample
+// Return:    	0=OK 1=no sample of this sensor in the ring
+//--------------------------------------------------------------------------------------------------
+uint8_t SHMR_Latest(SHMR_Handle *h,uint8_t sensor,SHMR_Sample *s)
+{
+   SHMR_Ring *r = h->ring;
+   uint64_t head = SHMR_Head(h);
+   uint64_t n = head;
+   
+   while(n > 0 && head - n < r->slots)
+   {
+      n--;
+      if(SHMR_Copy(r,n,s) == 0 && s->sensor == sensor) return 0;
+   }
+   return 1;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Name:	SHMR_ReadFrom
+// Function:  	Read the samples from a position on, oldest first
+//		A position that has been overwritten already continues at the oldest sample still
+//		in the ring. Start with SHMR_Head() for new samples only, or 0 for the whole history.
+//            
+// Parameter: 	handle, position (updated), samples, max number of samples
+// Return:    	number of samples read
+//--------------------------------------------------------------------------------------------------
+uint32_t SHMR_ReadFrom(SHMR_Handle *h,uint64_t *pos,SHMR_Sample *s,uint32_t max)
+{
+   SHMR_Ring *r = h->ring;
+   uint64_t head = SHMR_Head(h);
+   uint64_t n = *pos;
+   uint32_t cnt = 0;
+   
+   if(n > head) n = head;
+   if(head - n > r->slots) n = head - r->slots;
+   
+   while(n < head && cnt < max)
+   {
+      if(SHMR_Copy(r,n,&s[cnt]) == 0) cnt++;
+      else if(head - n <= r->slots) break;	// being written
+      n++;
+   }
+   *pos = n;
+   return cnt;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Name:	SHMR_Copy
+// Function:  	Copy sample n out of the ring
+//            
+// Parameter: 	ring, sample number, copy
+// Return:    	0=OK 1=slot holds another sample (overwritten or being written)
+//--------------------------------------------------------------------------------------------------
+static uint8_t SHMR_Copy(SHMR_Ring *r,uint64_t n,SHMR_Sample *s)
+{
+   const SHMR_Sample *slot = &r->slot[n & (r->slots - 1)];
+   uint64_t seq;
+   
+   seq = __atomic_load_n(&slot->seq,__ATOMIC_ACQUIRE);
+   if(seq != 2*n + 2) return 1;
+   
+   s->time_us  = slot->time_us;
+   s->sensor   = slot->sensor;
+   s->error    = slot->error;
+   s->temp     = slot->temp;
+   s->humidity = slot->humidity;
+   
+   __atomic_thread_fence(__ATOMIC_ACQUIRE);
+   if(__atomic_load_n(&slot->seq,__ATOMIC_RELAXED) != seq) return 1;
+   s->seq = seq;
+   return 0;
+}
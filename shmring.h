@@ -0,0 +1,72 @@
+//--------------------------------------------------------------------------------------------------
+//
+// Filename:    shmring.h
+// Description: Ring buffer of sensor samples in a shared memory segment
+//              One process (the sampling daemon) writes, any number of processes read without
+//              locks, system calls or bus access. A reader detects slots overwritten while it
+//              was copying them by their sequence number.
+//              
+// Author:      agent
+// History:     17.10.2026 Initial version
+//--------------------------------------------------------------------------------------------------
+
+#ifndef SHMRING_H
+#define SHMRING_H
+
+//=== Includes =====================================================================================	
+
+#include <stdint.h>
+#include <stddef.h>
+
+//=== Preprocessing directives (#define) ===========================================================
+
+#define SHMR_DEFAULT_NAME	"/shtlib"	// shared memory object used by the daemon
+#define SHMR_DEFAULT_SLOTS	1024		// samples kept
+
+//=== Type definitions (typedef) ===================================================================
+
+// One sample of one sensor
+typedef struct
+{
+   uint64_t seq;		// written by SHMR_Publish()
+   uint64_t time_us;		// time of the measurement (CLOCK_REALTIME, in us)
+   uint8_t sensor;		// number of the sensor
+   uint8_t error;		// SHT21_ERR_xxx bits, values are invalid if not 0
+   int16_t temp;		// temperature (in 10th C)
+   uint16_t humidity;		// rel. humidity (in 10th %)
+   uint16_t reserved;
+} SHMR_Sample;
+
+// Layout of the shared memory segment
+typedef struct
+{
+   uint32_t magic;
+   uint32_t slots;		// number of slots, a power of two
+   uint64_t head;		// number of samples ever written
+   SHMR_Sample slot[];
+} SHMR_Ring;
+
+// A mapping of the ring
+typedef struct
+{
+   SHMR_Ring *ring;
+   size_t len;			// size of the mapping
+} SHMR_Handle;
+
+//=== Global constants (extern) ====================================================================
+
+//=== Global variables (extern) ====================================================================
+
+//=== Global function prototypes ===================================================================
+
+uint8_t  SHMR_Create(SHMR_Handle *h,const char *name,uint32_t slots);
+uint8_t  SHMR_Attach(SHMR_Handle *h,const char *name);
+void     SHMR_Close(SHMR_Handle *h);
+void     SHMR_Unlink(const char *name);
+
+void     SHMR_Publish(SHMR_Handle *h,const SHMR_Sample *s);
+uint8_t  SHMR_Latest(SHMR_Handle *h,uint8_t sensor,SHMR_Sample *s);
+uint32_t SHMR_ReadFrom(SHMR_Handle *h,uint64_t *pos,SHMR_Sample *s,uint32_t max);
+uint64_t SHMR_Head(SHMR_Handle *h);
+
+#endif
@@ -1,293 +1,2410 @@
-//------------------------------------------------------------------------------
-//
-// Filename:    sht21.c
-// Description: This file is part of the libsht library. 
-//              Implements the specific functions to read the Sensirion SHT21
-//              temperature and humidity sensor using the simulated I2C protocol
-//
-// Open Source Licensing 
-//
-// This program is free software: you can redistribute it and/or modify
-// it under the terms of the GNU General Public License as published by
-// the Free Software Foundation, either version 3 of the License, or
-// (at your option) any later version.
-//
-// This program is distributed in the hope that it will be useful,
-// but WITHOUT ANY WARRANTY; without even the implied warranty of
-// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
-// GNU General Public License for more details.
-//
-// You should have received a copy of the GNU General Public License
-// along with this program.  If not, see <http://www.gnu.org/licenses/>.
-//
-//              
-// Author:      Martin Steppuhn, Ondrej Wisniewski
-// History:     14.09.2012 (MS) Initial version "Quick and Dirty" 
-//              23.04.2015 (OW) Added SHT21_Init()
-//              24.04.2015 (OW) Changed humidity calculation, code cleanup
-//              27.04.2015 (OW) Added SHT21_Cleanup()
-//              26.05.2015 (OW) Optimised calculation for sensor value conversion
-//------------------------------------------------------------------------------
-
-/**** Includes ****************************************************************/
-
-#include <stdint.h>
-#include <unistd.h>
-#include "bcm2835.h"
-#include "i2c.h"
-
-/**** Preprocessing directives (#define) **************************************/
-
-/**** Type definitions (typedef) **********************************************/
-
-/**** Global constants ********************************************************/
-
-/**** Global variables ********************************************************/
-
-/**** Local constants  ********************************************************/
-
-// SHT21 I2C address
-#define I2C_ADDR      0x40
-
-// Sensor commands
-#define CMD_TMP_HLD   0xE3
-#define CMD_HUM_HLD   0xE5
-#define CMD_TMP_NOHLD 0xF3
-#define CMD_HUM_NOHLD 0xF5
-#define CMD_WR_REG    0xE6
-#define CMD_RD_REG    0xE7
-#define CMD_SOFT_RST  0xFE
-
-
-/**** Local variables *********************************************************/
-
-static uint8_t lib_initialised=0;
-
-
-/**** Local function prototypes ***********************************************/
-
-static uint8_t SHT21_CalcCrc(uint8_t *data,uint8_t nbrOfBytes);
-
-
-//------------------------------------------------------------------------------
-// Name:      SHT21_Init
-// Function:  Initialise the SHT library
-//            
-// Parameter: uint8_t scl : pin used for clock line
-//            uint8_t sda : pin used for data line
-//
-// Return:     0: SUCCESS
-//            >0: ERROR
-//------------------------------------------------------------------------------
-uint8_t SHT21_Init(uint8_t scl,uint8_t sda)
-{
-   if (!lib_initialised)
-   {
-      if (bcm2835_init() == 0)
-      {
-         return 1;
-      }
-      
-      lib_initialised = 1;
-   }
-   
-   SI2C_SetPort(scl, sda);
-   return 0;
-}
-
-//------------------------------------------------------------------------------
-// Name:      SHT21_Cleanup
-// Function:  Cleanup resources used by SHT library
-//            
-// Parameter: None
-//            
-// Return:     0: SUCCESS
-//            >0: ERROR
-//------------------------------------------------------------------------------
-uint8_t SHT21_Cleanup(void)
-{
-   if (lib_initialised)
-   {
-      if (bcm2835_close() == 0)
-      {
-         return 1;
-      }
-      lib_initialised = 0;
-   }
-   
-   return 0;
-}
-
-//------------------------------------------------------------------------------
-// Name:      SHT21_Read
-// Function:  Read temperature and humidity from SHT21 sensor
-//            
-// Parameter: int16_t *temp      : temperature (in 10th C)
-//            uint16_t *humidity : rel. humidity (in 10th %)
-//
-// Return:     0: SUCCESS
-//            >0: ERROR
-//------------------------------------------------------------------------------
-uint8_t SHT21_Read(int16_t *temp, uint16_t *humidity)
-{
-   uint8_t error;
-   uint8_t d[3];
-   uint8_t timeout;
-   uint32_t val;
-   
-   error = 0;
-   
-   //=== Software reset =============================================
-   
-   SI2C_Start();
-   error |= SI2C_SendByte((I2C_ADDR << 1) + 0);	// Addr + WR
-   error |=SI2C_SendByte(CMD_SOFT_RST);		// Soft reset
-   SI2C_Stop();
-   
-   usleep(15000);
-   
-   //=== User register ======================================================== 
-   
-   SI2C_Start();
-   error |= SI2C_SendByte((I2C_ADDR << 1) + 0);	// Addr + WR
-   error |= SI2C_SendByte(CMD_RD_REG);		// Read user register
-   SI2C_Start();
-   error |= SI2C_SendByte((I2C_ADDR << 1) + 1);	// Addr + RD
-   d[0] = SI2C_ReadByte(1);			
-   d[1] = SI2C_ReadByte(0);
-   SI2C_Stop();  
-   
-   if(d[0] == 0) 
-   {
-      error |= 0x02;
-   }
-   else if(d[1] == SHT21_CalcCrc(d,1))
-   {
-      SI2C_Start();
-      error |= SI2C_SendByte((I2C_ADDR << 1) + 0);	// Addr + WR
-      error |= SI2C_SendByte(CMD_WR_REG);		// User register
-      error |= SI2C_SendByte(d[0]);			// Value 
-      SI2C_Stop();
-   }
-   else
-   {
-      error |= 0x04;
-   }
-   
-   //=== Temperature ===========================================================  	
-   
-   SI2C_Start();
-   error |= SI2C_SendByte((I2C_ADDR << 1) + 0);
-   error |= SI2C_SendByte(CMD_TMP_HLD);
-   SI2C_Start();
-   error |= SI2C_SendByte((I2C_ADDR << 1) + 1);
-   SI2C_SetSclState(1);
-   
-   timeout = 100;
-   while(SI2C_GetSclState()  == 0 && timeout)
-   {
-      usleep(1000);
-      timeout--;
-   }
-   if(timeout == 0) error |= 0x08;
-   
-   d[0] = SI2C_ReadByte(1);
-   d[1] = SI2C_ReadByte(1);
-   d[2] = SI2C_ReadByte(0);
-   SI2C_Stop();
-   
-   if(d[2] == SHT21_CalcCrc(d,2))
-   {
-      val = d[0];
-      val <<= 8;
-      val += d[1];
-      val &= 0xFFFC;      
-     
-      // Convert raw value from sensor to one tenth of a Celsius temperature
-      // From datasheet chapter 6.1:
-      //   T = -46,85 + 175,72 * St/65535
-      // Optimise for integer fixed point arithmetic:
-      //   100 * T = -4685 + 17572*St/2^16
-      //   100 * T = 4393*St/2^14 - 4685
-      val = ((val * 4393) >> 14) - 4685;
-      *temp = (int16_t)(val/10);      
-   }
-   else
-   {
-      error |= 0x10;
-   }
-   
-   //=== Humidity ==============================================================
-   
-   SI2C_Start();
-   error |= SI2C_SendByte((I2C_ADDR << 1) + 0);
-   error |= SI2C_SendByte(CMD_HUM_HLD);
-   SI2C_Start();
-   error |= SI2C_SendByte((I2C_ADDR << 1) + 1);
-   SI2C_SetSclState(1);
-   timeout = 100;
-   while(SI2C_GetSclState() == 0 && timeout)
-   {
-      usleep(1000);
-      timeout--;
-   }
-   if(timeout == 0) error |= 0x20;
-   
-   d[0] = SI2C_ReadByte(1);
-   d[1] = SI2C_ReadByte(1);
-   d[2] = SI2C_ReadByte(0);
-   SI2C_Stop();
-   
-   
-   if(d[2] == SHT21_CalcCrc(d,2))
-   {
-      val = d[0];
-      val <<= 8;
-      val += d[1];
-      val &= 0xFFFC;
-      
-      // Convert raw value from sensor to one tenth of a percent relative humidity
-      // From datasheet chapter 6.1:
-      //   RH = -6 + 125*Srh/2^16
-      // Optimise for integer fixed point arithmetic:
-      //   10 * RH = -60 + 1250*Srh/2^16
-      //   10 * RH = 625*Srh/2^15 - 60
-      val = ((625 * val) >> 15) - 60;
-      *humidity = (uint16_t)val;
-   }
-   else
-   {
-      error |= 0x40;
-   }
-   return(error);
-}
-
-//------------------------------------------------------------------------------
-// Name:      SHT21_CalcCrc
-// Function:  
-//            
-// Parameter: uint8_t *data      : pointer to data buffer
-//            uint8_t nbrOfBytes : number of bytes
-// Return:    
-//------------------------------------------------------------------------------
-static uint8_t SHT21_CalcCrc(uint8_t *data,uint8_t nbrOfBytes)
-{
-   // CRC
-   //const u16t POLYNOMIAL = 0x131; //P(x)=x^8+x^5+x^4+1 = 100110001
-   
-   uint8_t byteCtr,bit,crc;
-   
-   crc = 0;
-   
-   //calculates 8-Bit checksum with given polynomial
-   for (byteCtr = 0; byteCtr < nbrOfBytes; ++byteCtr)
-   { 
-      crc ^= (data[byteCtr]);
-      for (bit = 8; bit > 0; --bit)
-      {
-         if (crc & 0x80) crc = (crc << 1) ^ 0x131;
-         else 		crc = (crc << 1);
-      }
-   }
-   return(crc);
-}
+//------------------------------------------------------------------------------
+//
+// Filename:    sht21.c
+// Description: This file is part of the libsht library. 
+//              Implements the specific functions to read the Sensirion SHT21
+//              temperature and humidity sensor using the simulated I2C protocol
+//
+// Open Source Licensing 
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+//              
+// Author:      Martin Steppuhn, Ondrej Wisniewski, agent
+// History:     14.09.2012 (MS) Initial version "Quick and Dirty" 
+//              23.04.2015 (OW) Added SHT21_Init()
+//              24.04.2015 (OW) Changed humidity calculation, code cleanup
+//              27.04.2015 (OW) Added SHT21_Cleanup()
+//              26.05.2015 (OW) Optimised calculation for sensor value conversion
+//              17.10.2026 (AG) Added session API SHT21_Open()/SHT21_ReadDev()
+//              17.10.2026 (AG) Added split-phase API SHT21_Start()/SHT21_Fetch()
+//              17.10.2026 (AG) Sessions own their bus context, no global port
+//              17.10.2026 (AG) Added SHT21_ReadMulti() for parallel buses
+//              17.10.2026 (AG) Sensors talk through a transport, added BSC
+//              17.10.2026 (AG) Added i2c-dev transport
+//              17.10.2026 (AG) Added pipelined multi-sensor SHT21_Sweep()
+//              17.10.2026 (AG) Selectable measurement resolution
+//              17.10.2026 (AG) Table driven CRC, added SHT21_CheckFrames()
+//              17.10.2026 (AG) Added batch conversions, fixed negative temperatures
+//              17.10.2026 (AG) Added GPIO character device transport
+//              17.10.2026 (AG) Per sensor and per bus statistics
+//              17.10.2026 (AG) Added SHT21_SetRealtime()
+//              17.10.2026 (AG) Thread-safe library, added worker pool SHT21_Pool
+//              17.10.2026 (AG) Hold master mode on i2c-dev only where the adapter supports it
+//              17.10.2026 (AG) Jitter recorded only in real-time mode
+//              17.10.2026 (AG) SHT21_Fetch() reports bus errors at once, not as busy
+//              17.10.2026 (AG) Added SHT21_SetResolutionMulti()
+//------------------------------------------------------------------------------
+
+/**** Includes ****************************************************************/
+
+#include <stdint.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include "bcm2835.h"
+#include "i2cbus.h"
+#include "i2c.h"
+#include "bsc.h"
+#include "i2cdev.h"
+#include "mi2c.h"
+#include "sht21.h"
+
+// SIMD paths: SSE2 is always there on x86-64, SSSE3 and AVX2 are checked at
+// run time, NEON is used if the compiler targets it
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SHT21_SIMD_X86
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define SHT21_SIMD_NEON
+#endif
+
+/**** Preprocessing directives (#define) **************************************/
+
+/**** Type definitions (typedef) **********************************************/
+
+/**** Global constants ********************************************************/
+
+/**** Global variables ********************************************************/
+
+/**** Local constants  ********************************************************/
+
+// Transport of a session that is not open, every transfer fails
+static uint8_t SHT21_NoTransfer(void *ctx, I2C_Msg *msgs, uint8_t n);
+static const I2C_Ops closed_ops = { "none", 0, SHT21_NoTransfer };
+
+// SHT21 I2C address
+#define I2C_ADDR      0x40
+
+// Sensor commands
+#define CMD_TMP_HLD   0xE3
+#define CMD_HUM_HLD   0xE5
+#define CMD_TMP_NOHLD 0xF3
+#define CMD_HUM_NOHLD 0xF5
+#define CMD_WR_REG    0xE6
+#define CMD_RD_REG    0xE7
+#define CMD_SOFT_RST  0xFE
+
+// Maximum conversion times from datasheet (14 bit T, 12 bit RH) in us
+#define TMP_CONV_US   85000
+#define HUM_CONV_US   29000
+
+// Polling interval and give-up time for a pending result in us
+// A result is given up once it is overdue by its own conversion time, but
+// at most FETCH_TMO_US after it was due.
+#define FETCH_POLL_US 1000
+#define FETCH_TMO_US  100000
+
+// Resolution and end of battery (read only) bits of the user register
+#define USER_REG_RES  0x81
+#define USER_REG_BATT 0x40
+
+// Fixed point conversions of the batch functions, y = (x * MUL) >> 16 - OFS
+// with the status bits of x cleared
+//   100 * T  = 17572*St/2^16 - 4685
+//   10 * RH  = 1250*Srh/2^16 - 60
+#define CONV_T_MUL    17572
+#define CONV_T_OFS    4685
+#define CONV_H_MUL    1250
+#define CONV_H_OFS    60
+
+// Float conversions, y = x * SCALE + OFS (status bits cleared)
+#define CONV_T_SCALE  (175.72f / 65536.0f)
+#define CONV_T_OFSF   (-46.85f)
+#define CONV_H_SCALE  (125.0f / 65536.0f)
+#define CONV_H_OFSF   (-6.0f)
+
+// States of a sensor in SHT21_Sweep()
+#define SWEEP_TRIG_T  0
+#define SWEEP_WAIT_T  1
+#define SWEEP_TRIG_H  2
+#define SWEEP_WAIT_H  3
+#define SWEEP_DONE    4
+
+
+// Maximum conversion times of the resolutions (in us), index is bit 7 and
+// bit 0 of the user register: RH12/T14, RH8/T12, RH10/T13, RH11/T11
+static const uint32_t tmp_conv_us[4] = { TMP_CONV_US, 22000, 43000, 11000 };
+static const uint32_t hum_conv_us[4] = { HUM_CONV_US,  4000,  9000, 15000 };
+
+// CRC-8 of the sensor, P(x)=x^8+x^5+x^4+1 (0x131), initial value 0
+// crc_table[x] is the CRC of the single byte x. The CRC is linear, so the
+// CRC of a two byte frame is crc_table[crc_table[b0]] ^ crc_table[b1], and
+// each lookup splits into one of the low and one of the high nibble
+// (crc_lo/crc_hi for a byte, crc2_lo/crc2_hi for a byte followed by another).
+static const uint8_t crc_table[256] =
+{
+   0x00, 0x31, 0x62, 0x53, 0xC4, 0xF5, 0xA6, 0x97, 0xB9, 0x88, 0xDB, 0xEA, 0x7D, 0x4C, 0x1F, 0x2E,
+   0x43, 0x72, 0x21, 0x10, 0x87, 0xB6, 0xE5, 0xD4, 0xFA, 0xCB, 0x98, 0xA9, 0x3E, 0x0F, 0x5C, 0x6D,
+   0x86, 0xB7, 0xE4, 0xD5, 0x42, 0x73, 0x20, 0x11, 0x3F, 0x0E, 0x5D, 0x6C, 0xFB, 0xCA, 0x99, 0xA8,
+   0xC5, 0xF4, 0xA7, 0x96, 0x01, 0x30, 0x63, 0x52, 0x7C, 0x4D, 0x1E, 0x2F, 0xB8, 0x89, 0xDA, 0xEB,
+   0x3D, 0x0C, 0x5F, 0x6E, 0xF9, 0xC8, 0x9B, 0xAA, 0x84, 0xB5, 0xE6, 0xD7, 0x40, 0x71, 0x22, 0x13,
+   0x7E, 0x4F, 0x1C, 0x2D, 0xBA, 0x8B, 0xD8, 0xE9, 0xC7, 0xF6, 0xA5, 0x94, 0x03, 0x32, 0x61, 0x50,
+   0xBB, 0x8A, 0xD9, 0xE8, 0x7F, 0x4E, 0x1D, 0x2C, 0x02, 0x33, 0x60, 0x51, 0xC6, 0xF7, 0xA4, 0x95,
+   0xF8, 0xC9, 0x9A, 0xAB, 0x3C, 0x0D, 0x5E, 0x6F, 0x41, 0x70, 0x23, 0x12, 0x85, 0xB4, 0xE7, 0xD6,
+   0x7A, 0x4B, 0x18, 0x29, 0xBE, 0x8F, 0xDC, 0xED, 0xC3, 0xF2, 0xA1, 0x90, 0x07, 0x36, 0x65, 0x54,
+   0x39, 0x08, 0x5B, 0x6A, 0xFD, 0xCC, 0x9F, 0xAE, 0x80, 0xB1, 0xE2, 0xD3, 0x44, 0x75, 0x26, 0x17,
+   0xFC, 0xCD, 0x9E, 0xAF, 0x38, 0x09, 0x5A, 0x6B, 0x45, 0x74, 0x27, 0x16, 0x81, 0xB0, 0xE3, 0xD2,
+   0xBF, 0x8E, 0xDD, 0xEC, 0x7B, 0x4A, 0x19, 0x28, 0x06, 0x37, 0x64, 0x55, 0xC2, 0xF3, 0xA0, 0x91,
+   0x47, 0x76, 0x25, 0x14, 0x83, 0xB2, 0xE1, 0xD0, 0xFE, 0xCF, 0x9C, 0xAD, 0x3A, 0x0B, 0x58, 0x69,
+   0x04, 0x35, 0x66, 0x57, 0xC0, 0xF1, 0xA2, 0x93, 0xBD, 0x8C, 0xDF, 0xEE, 0x79, 0x48, 0x1B, 0x2A,
+   0xC1, 0xF0, 0xA3, 0x92, 0x05, 0x34, 0x67, 0x56, 0x78, 0x49, 0x1A, 0x2B, 0xBC, 0x8D, 0xDE, 0xEF,
+   0x82, 0xB3, 0xE0, 0xD1, 0x46, 0x77, 0x24, 0x15, 0x3B, 0x0A, 0x59, 0x68, 0xFF, 0xCE, 0x9D, 0xAC
+};
+
+static const uint8_t crc_lo[16] =
+{
+   0x00, 0x31, 0x62, 0x53, 0xC4, 0xF5, 0xA6, 0x97, 0xB9, 0x88, 0xDB, 0xEA, 0x7D, 0x4C, 0x1F, 0x2E
+};
+
+static const uint8_t crc_hi[16] =
+{
+   0x00, 0x43, 0x86, 0xC5, 0x3D, 0x7E, 0xBB, 0xF8, 0x7A, 0x39, 0xFC, 0xBF, 0x47, 0x04, 0xC1, 0x82
+};
+
+static const uint8_t crc2_lo[16] =
+{
+   0x00, 0xF4, 0xD9, 0x2D, 0x83, 0x77, 0x5A, 0xAE, 0x37, 0xC3, 0xEE, 0x1A, 0xB4, 0x40, 0x6D, 0x99
+};
+
+static const uint8_t crc2_hi[16] =
+{
+   0x00, 0x6E, 0xDC, 0xB2, 0x89, 0xE7, 0x55, 0x3B, 0x23, 0x4D, 0xFF, 0x91, 0xAA, 0xC4, 0x76, 0x18
+};
+
+/**** Local variables *********************************************************/
+
+// Reference of the library to the mapped peripherals, held until SHT21_Cleanup(),
+// so sessions opened and closed in turn do not map them each time
+static uint8_t lib_initialised=0;
+static pthread_mutex_t lib_lock=PTHREAD_MUTEX_INITIALIZER;
+
+// Sensor used by SHT21_Init()/SHT21_Read(), shared by all threads
+static SHT21_Dev lib_dev;
+static uint8_t lib_dev_open=0;
+static pthread_mutex_t lib_dev_lock=PTHREAD_MUTEX_INITIALIZER;
+
+
+/**** Local function prototypes ***********************************************/
+
+static uint8_t SHT21_LibInit(void);
+static void SHT21_LibRelease(void);
+static uint8_t SHT21_Attach(SHT21_Dev *dev, const SHT21_Config *cfg);
+static uint8_t SHT21_DevSetup(SHT21_Dev *dev);
+static void SHT21_InitStats(SHT21_Dev *dev);
+static void SHT21_Detach(SHT21_Dev *dev);
+static uint8_t SHT21_Reset(SHT21_Dev *dev);
+static uint8_t SHT21_Setup(SHT21_Dev *dev, uint8_t resolution, uint8_t *user_reg);
+static uint8_t SHT21_Measure(SHT21_Dev *dev, uint8_t meas, uint8_t resolution, uint16_t *raw);
+static uint8_t SHT21_ReadValues(SHT21_Dev *dev, uint8_t resolution, int16_t *temp,
+                                uint16_t *humidity);
+static uint32_t SHT21_ConvTime(uint8_t meas, uint8_t resolution);
+static uint32_t SHT21_FetchTimeout(uint32_t conv);
+static uint8_t SHT21_BusError(uint8_t err, uint8_t err_tmo);
+static uint8_t SHT21_SweepStep(SHT21_Dev *dev, uint8_t state, int16_t *temp,
+                               uint16_t *humidity, uint8_t *error);
+static uint32_t SHT21_MeasureMulti(MI2C_Bus *bus, uint8_t cmd, uint8_t err_tmo,
+                                   uint8_t err_crc, uint16_t *raw, uint8_t *errors);
+static void *SHT21_PoolWorker(void *arg);
+static uint8_t SHT21_SameBus(SHT21_Dev *a, SHT21_Dev *b);
+static int16_t SHT21_ConvTemp(uint16_t raw);
+static uint16_t SHT21_ConvHum(uint16_t raw);
+static uint64_t SHT21_Now(void);
+static uint8_t SHT21_CalcCrc(uint8_t *data,uint8_t nbrOfBytes);
+#ifdef SHT21_SIMD_X86
+static uint32_t SHT21_CheckFramesSsse3(const uint8_t *frames, uint32_t n, uint8_t *valid);
+#endif
+#ifdef SHT21_SIMD_NEON
+static uint32_t SHT21_CheckFramesNeon(const uint8_t *frames, uint32_t n, uint8_t *valid);
+#endif
+static void SHT21_ConvFixed(const uint16_t *raw, uint16_t *out, uint32_t n,
+                            uint16_t mul, uint16_t ofs, uint8_t sat);
+static void SHT21_ConvFloat(const uint16_t *raw, float *out, uint32_t n,
+                            float scale, float ofs);
+#ifdef SHT21_SIMD_X86
+static uint32_t SHT21_ConvFixedAvx2(const uint16_t *raw, uint16_t *out, uint32_t n,
+                                    uint16_t mul, uint16_t ofs, uint8_t sat);
+static uint32_t SHT21_ConvFloatAvx2(const uint16_t *raw, float *out, uint32_t n,
+                                    float scale, float ofs);
+#endif
+
+
+//------------------------------------------------------------------------------
+// Name:      SHT21_Init
+// Function:  Initialise the SHT library
+//            
+// Parameter: uint8_t scl : pin used for clock line
+//            uint8_t sda : pin used for data line
+//
+// Return:     0: SUCCESS
+//            >0: ERROR
+//------------------------------------------------------------------------------
+uint8_t SHT21_Init(uint8_t scl,uint8_t sda)
+{
+   SHT21_Config cfg = { SHT21_TR_GPIO, scl, sda, 0 };
+   uint8_t error;
+   
+   pthread_mutex_lock(&lib_dev_lock);
+   if (lib_dev_open)
+   {
+      SHT21_Close(&lib_dev);
+   }
+   error = SHT21_Attach(&lib_dev, &cfg);
+   lib_dev_open = (error == 0);
+   pthread_mutex_unlock(&lib_dev_lock);
+   
+   return(error);
+}
+
+//------------------------------------------------------------------------------
+// Name:      SHT21_Cleanup
+// Function:  Cleanup resources used by SHT library
+//            
+// Parameter: None
+//            
+// Return:     0: SUCCESS
+//            >0: ERROR
+//------------------------------------------------------------------------------
+uint8_t SHT21_Cleanup(void)
+{
+   uint8_t error = 0;
+   
+   pthread_mutex_lock(&lib_dev_lock);
+   if (lib_dev_open)
+   {
+      SHT21_Close(&lib_dev);
+      lib_dev_open = 0;
+   }
+   pthread_mutex_unlock(&lib_dev_lock);
+   
+   pthread_mutex_lock(&lib_lock);
+   if (lib_initialised)
+   {
+      if (bcm2835_close() == 0)
+      {
+         error = 1;
+      }
+      else
+      {
+         lib_initialised = 0;
+      }
+   }
+   pthread_mutex_unlock(&lib_lock);
+   
+   return(error);
+}
+
+//------------------------------------------------------------------------------
+// Name:      SHT21_Read
+// Function:  Read temperature and humidity from SHT21 sensor
+//            The sensor is reset and its user register is rewritten before
+//            every measurement. Use SHT21_Open()/SHT21_ReadDev() to avoid
+//            this overhead when reading the same sensor repeatedly.
+//            There is one such sensor per process, calls from several
+//            threads take turns.
+//            
+// Parameter: int16_t *temp      : temperature (in 10th C)
+//            uint16_t *humidity : rel. humidity (in 10th %)
+//
+// Return:     0: SUCCESS
+//            >0: ERROR
+//------------------------------------------------------------------------------
+uint8_t SHT21_Read(int16_t *temp, uint16_t *humidity)
+{
+   uint8_t error;
+   uint8_t user_reg;
+   uint64_t start;
+   
+   pthread_mutex_lock(&lib_dev_lock);
+   start = SHT21_Now();
+   error  = SHT21_Reset(&lib_dev);
+   error |= SHT21_Setup(&lib_dev, SHT21_RES_RH12_T14, &user_reg);
+   error |= SHT21_ReadValues(&lib_dev, SHT21_RES_RH12_T14, temp, humidity);
+   
+   STAT_Record(&lib_dev.stats.read, SHT21_Now() - start);
+   pthread_mutex_unlock(&lib_dev_lock);
+   return(error);
+}
+
+//------------------------------------------------------------------------------
+// Name:      SHT21_Open
+// Function:  Open a measurement session on an SHT21 sensor
+//            The sensor is reset and set up once here. Subsequent calls to
+//            SHT21_ReadDev() only perform the measurements, unless an error
+//            occurred, in which case the reset and setup are repeated.
+//            
+// Parameter: SHT21_Dev *dev : session handle to initialise
+//            uint8_t scl    : pin used for clock line
+//            uint8_t sda    : pin used for data line
+//
+// Return:     0: SUCCESS
+//            >0: ERROR (the setup is retried on the next read)
+//------------------------------------------------------------------------------
+uint8_t SHT21_Open(SHT21_Dev *dev, uint8_t scl, uint8_t sda)
+{
+   SHT21_Config cfg = { SHT21_TR_GPIO, scl, sda, 0 };
+   
+   return SHT21_OpenConfig(dev, &cfg);
+}
+
+//------------------------------------------------------------------------------
+// Name:      SHT21_OpenConfig
+// Function:  Open a measurement session on a sensor connected through one of
+//            the built-in transports, see SHT21_Open()
+//            
+// Parameter: SHT21_Dev *dev           : session handle to initialise
+//            const SHT21_Config *cfg  : transport and its settings
+//
+// Return:     0: SUCCESS
+//            >0: ERROR (the setup is retried on the next read,
+//                unless the transport could not be opened)
+//------------------------------------------------------------------------------
+uint8_t SHT21_OpenConfig(SHT21_Dev *dev, const SHT21_Config *cfg)
+{
+   if (SHT21_Attach(dev, cfg) != 0)
+   {
+      return SHT21_ERR_NACK;
+   }
+   
+   return SHT21_DevSetup(dev);
+}
+
+//------------------------------------------------------------------------------
+// Name:      SHT21_OpenBus
+// Function:  Open a measurement session on a sensor connected through a
+//            transport supplied by the caller, see SHT21_Open()
+//            
+// Parameter: SHT21_Dev *dev     : session handle to initialise
+//            const I2C_Ops *ops : transport operations
+//            void *ctx          : context passed to the operations
+//
+// Return:     0: SUCCESS
+//            >0: ERROR (the setup is retried on the next read)
+//------------------------------------------------------------------------------
+uint8_t SHT21_OpenBus(SHT21_Dev *dev, const I2C_Ops *ops, void *ctx)
+{
+   dev->transport = SHT21_TR_CUSTOM;
+   dev->bus.ops = ops;
+   dev->bus.ctx = ctx;
+   dev->user_reg = 0;
+   dev->resolution = SHT21_RES_RH12_T14;
+   dev->need_setup = 1;
+   dev->meas = SHT21_MEAS_NONE;
+   dev->ready_at = 0;
+   SHT21_InitStats(dev);
+   
+   return SHT21_DevSetup(dev);
+}
+
+//------------------------------------------------------------------------------
+// Name:      SHT21_ReadDev
+// Function:  Read temperature and humidity from an opened SHT21 sensor
+//            
+// Parameter: SHT21_Dev *dev     : session handle
+//            int16_t *temp      : temperature (in 10th C)
+//            uint16_t *humidity : rel. humidity (in 10th %)
+//
+// Return:     0: SUCCESS
+//            >0: ERROR
+//------------------------------------------------------------------------------
+uint8_t SHT21_ReadDev(SHT21_Dev *dev, int16_t *temp, uint16_t *humidity)
+{
+   uint8_t error;
+   uint64_t start = SHT21_Now();
+   
+   if (dev->need_setup)
+   {
+      STAT_Inc(&dev->stats.retries);
+      error = SHT21_DevSetup(dev);
+      if (error)
+      {
+         STAT_Record(&dev->stats.read, SHT21_Now() - start);
+         return(error);
+      }
+   }
+   
+   error = SHT21_ReadValues(dev, dev->resolution, temp, humidity);
+   if (error)
+   {
+      // Sensor may have lost its state, start over on the next read
+      dev->need_setup = 1;
+   }
+   STAT_Record(&dev->stats.read, SHT21_Now() - start);
+   return(error);
+}
+
+//------------------------------------------------------------------------------
+// Name:      SHT21_Close
+// Function:  Close a measurement session
+//            The peripherals stay mapped while other sessions use them and
+//            until SHT21_Cleanup(). The handle is left closed, so closing
+//            it again does nothing.
+//            
+// Parameter: SHT21_Dev *dev : session handle
+//
+// Return:    None
+//------------------------------------------------------------------------------
+void SHT21_Close(SHT21_Dev *dev)
+{
+   if (dev->transport == SHT21_TR_GPIO)
+   {
+      SHT21_LibRelease();
+   }
+   else if (dev->transport == SHT21_TR_BSC)
+   {
+      BSC_Close(&dev->port.bsc);
+      SHT21_LibRelease();
+   }
+   else if (dev->transport == SHT21_TR_I2CDEV)
+   {
+      I2CDEV_Close(&dev->port.i2cdev);
+   }
+   else if (dev->transport == SHT21_TR_GPIOCHIP)
+   {
+      MI2C_Close(&dev->port.gpiochip);
+   }
+   SHT21_Detach(dev);
+}
+
+//------------------------------------------------------------------------------
+// Name:      SHT21_SetResolution
+// Function:  Select the measurement resolution of a session
+//            The user register of the sensor is updated right away, and
+//            again after every reset of the sensor. Conversion waits and
+//            timeouts follow the datasheet maximum of the resolution.
+//            
+// Parameter: SHT21_Dev *dev     : session handle
+//            uint8_t resolution : SHT21_RES_xxx
+//
+// Return:     0: SUCCESS
+//            >0: ERROR (the setup is retried on the next read)
+//------------------------------------------------------------------------------
+uint8_t SHT21_SetResolution(SHT21_Dev *dev, uint8_t resolution)
+{
+   uint8_t error;
+   
+   dev->resolution = resolution & USER_REG_RES;
+   
+   error = SHT21_Setup(dev, dev->resolution, &dev->user_reg);
+   if (error)
+   {
+      dev->need_setup = 1;
+   }
+   return(error);
+}
+
+//------------------------------------------------------------------------------
+// Name:      SHT21_SetRealtime
+// Function:  Run the transactions of a session without system calls
+//            The bit-banged bus then busy-polls the clock while the sensor
+//            stretches it in hold master mode, instead of sleeping on a
+//            line event. Meant for a thread set up with RT_Enter() on a
+//            core of its own. The jitter histogram is recorded only in
+//            real-time mode, it costs two clock reads and a lookup of the
+//            transaction per transaction.
+//            
+// Parameter: SHT21_Dev *dev : session handle
+//            uint8_t on     : 1 = real-time mode, 0 = normal
+//
+// Return:     0: SUCCESS
+//            >0: ERROR (transport without real-time mode)
+//------------------------------------------------------------------------------
+uint8_t SHT21_SetRealtime(SHT21_Dev *dev, uint8_t on)
+{
+   if (dev->transport != SHT21_TR_GPIO)
+   {
+      return 1;
+   }
+   
+   dev->port.gpio.spin = on;
+   dev->port.gpio.jitter = on ? &dev->bus_stats.jitter : NULL;
+   return 0;
+}
+
+//------------------------------------------------------------------------------
+// Name:      SHT21_GetStats
+// Function:  Copy the statistics of a session
+//            Every counter is read atomically, the copy is not a snapshot of
+//            all of them at the same instant.
+//            
+// Parameter: SHT21_Dev *dev     : session handle
+//            SHT21_Stats *stats : copy of the sensor statistics (or NULL)
+//            I2C_Stats *bus     : copy of the bus statistics (or NULL)
+//
+// Return:    None
+//------------------------------------------------------------------------------
+void SHT21_GetStats(SHT21_Dev *dev, SHT21_Stats *stats, I2C_Stats *bus)
+{
+   if (stats)
+   {
+      STAT_Copy(stats, &dev->stats, sizeof(*stats));
+   }
+   if (bus)
+   {
+      STAT_Copy(bus, &dev->bus_stats, sizeof(*bus));
+   }
+}
+
+//------------------------------------------------------------------------------
+// Name:      SHT21_ResetStats
+// Function:  Set the statistics of a session to zero
+//            
+// Parameter: SHT21_Dev *dev : session handle
+//
+// Return:    None
+//------------------------------------------------------------------------------
+void SHT21_ResetStats(SHT21_Dev *dev)
+{
+   STAT_Clear(&dev->stats, sizeof(dev->stats));
+   STAT_Clear(&dev->bus_stats, sizeof(dev->bus_stats));
+}
+
+//------------------------------------------------------------------------------
+// Name:      SHT21_GetLibStats
+// Function:  Copy the statistics of the sensor of SHT21_Init()/SHT21_Read()
+//            
+// Parameter: SHT21_Stats *stats : copy of the sensor statistics (or NULL)
+//            I2C_Stats *bus     : copy of the bus statistics (or NULL)
+//
+// Return:    None
+//------------------------------------------------------------------------------
+void SHT21_GetLibStats(SHT21_Stats *stats, I2C_Stats *bus)
+{
+   SHT21_GetStats(&lib_dev, stats, bus);
+}
+
+//------------------------------------------------------------------------------
+// Name:      SHT21_Start
+// Function:  Trigger a measurement in no hold master mode and return
+//            immediately. The bus is free while the sensor converts, the
+//            result is picked up later with SHT21_Fetch() or SHT21_Collect().
+//            
+// Parameter: SHT21_Dev *dev : session handle
+//            uint8_t meas   : SHT21_MEAS_TEMP or SHT21_MEAS_HUM
+//
+// Return:     0: SUCCESS
+//            >0: ERROR
+//------------------------------------------------------------------------------
+uint8_t SHT21_Start(SHT21_Dev *dev, uint8_t meas)
+{
+   uint8_t cmd;
+   uint8_t error;
+   
+   if (dev->need_setup)
+   {
+      STAT_Inc(&dev->stats.retries);
+      error = SHT21_DevSetup(dev);
+      if (error)
+      {
+         return(error);
+      }
+   }
+   
+   cmd = (meas == SHT21_MEAS_TEMP) ? CMD_TMP_NOHLD : CMD_HUM_NOHLD;
+   error = SHT21_BusError(I2C_Write(&dev->bus, I2C_ADDR, &cmd, 1), 0);
+   
+   if (error)
+   {
+      STAT_Inc(&dev->stats.nack_cmd);
+      dev->meas = SHT21_MEAS_NONE;
+      dev->need_setup = 1;
+      return(error);
+   }
+   
+   dev->meas = meas;
+   dev->started_at = SHT21_Now();
+   dev->ready_at = dev->started_at + SHT21_ConvTime(meas, dev->resolution);
+   return 0;
+}
+
+//------------------------------------------------------------------------------
+// Name:      SHT21_Fetch
+// Function:  Pick up the result of a measurement started with SHT21_Start()
+//            Does not wait: while the sensor is still converting it does
+//            not acknowledge its address and SHT21_ERR_BUSY is returned.
+//            Any other bus error ends the measurement at once.
+//            
+// Parameter: SHT21_Dev *dev : session handle
+//            int16_t *value : temperature (in 10th C) or
+//                             rel. humidity (in 10th %)
+//
+// Return:     0: SUCCESS
+//            SHT21_ERR_BUSY: result not available yet, try again later
+//            other: ERROR (no measurement pending, bus error, timeout or
+//                   CRC mismatch)
+//------------------------------------------------------------------------------
+uint8_t SHT21_Fetch(SHT21_Dev *dev, int16_t *value)
+{
+   uint8_t d[3];
+   uint8_t meas;
+   uint8_t error;
+   uint16_t raw;
+   uint64_t now;
+   
+   meas = dev->meas;
+   if (meas == SHT21_MEAS_NONE)
+   {
+      return SHT21_ERR_NACK;
+   }
+   
+   error = I2C_Read(&dev->bus, I2C_ADDR, d, 3);
+   if (error & ~I2C_ERR_NACK)
+   {
+      // Transport failure, not a sensor that is still converting
+      dev->meas = SHT21_MEAS_NONE;
+      dev->need_setup = 1;
+      return SHT21_ERR_NACK;
+   }
+   if (error)	// NACK while busy
+   {
+      if (SHT21_Now() < dev->ready_at +
+                        SHT21_FetchTimeout(SHT21_ConvTime(meas, dev->resolution)))
+      {
+         STAT_Inc(&dev->stats.busy_polls);
+         return SHT21_ERR_BUSY;
+      }
+      STAT_Inc(&dev->stats.timeouts);
+      dev->meas = SHT21_MEAS_NONE;
+      dev->need_setup = 1;
+      return (meas == SHT21_MEAS_TEMP) ? SHT21_ERR_T_TIMEOUT : SHT21_ERR_H_TIMEOUT;
+   }
+   
+   now = SHT21_Now();
+   dev->meas = SHT21_MEAS_NONE;
+   
+   if (d[2] != SHT21_CalcCrc(d,2))
+   {
+      STAT_Inc(&dev->stats.crc_errors);
+      dev->need_setup = 1;
+      return (meas == SHT21_MEAS_TEMP) ? SHT21_ERR_T_CRC : SHT21_ERR_H_CRC;
+   }
+   
+   STAT_Inc(&dev->stats.measurements);
+   STAT_Record(&dev->stats.conv_wait, now - dev->started_at);
+   raw = ((uint16_t)d[0] << 8 | d[1]) & 0xFFFC;
+   if (meas == SHT21_MEAS_TEMP)
+   {
+      *value = SHT21_ConvTemp(raw);
+   }
+   else
+   {
+      *value = (int16_t)SHT21_ConvHum(raw);
+   }
+   return 0;
+}
+
+//------------------------------------------------------------------------------
+// Name:      SHT21_Remaining
+// Function:  Time until the pending result of a sensor is due
+//            
+// Parameter: SHT21_Dev *dev : session handle
+//
+// Return:    remaining conversion time (in us), 0 if due or none pending
+//------------------------------------------------------------------------------
+uint32_t SHT21_Remaining(SHT21_Dev *dev)
+{
+   uint64_t now;
+   
+   if (dev->meas == SHT21_MEAS_NONE)
+   {
+      return 0;
+   }
+   
+   now = SHT21_Now();
+   return (now < dev->ready_at) ? (uint32_t)(dev->ready_at - now) : 0;
+}
+
+//------------------------------------------------------------------------------
+// Name:      SHT21_Collect
+// Function:  Harvest the pending results of several sensors
+//            Sleeps until the earliest result is due, fetches every due
+//            sensor and reports it through the callback, until no sensor
+//            has a pending measurement any more.
+//            
+// Parameter: SHT21_Dev **devs   : session handles
+//            uint8_t n          : number of session handles
+//            SHT21_Callback cb  : called once per finished measurement
+//            void *arg          : passed through to the callback
+//
+// Return:    number of measurements that failed
+//------------------------------------------------------------------------------
+uint8_t SHT21_Collect(SHT21_Dev **devs, uint8_t n, SHT21_Callback cb, void *arg)
+{
+   uint8_t i;
+   uint8_t meas;
+   uint8_t error;
+   uint8_t pending;
+   uint8_t failed = 0;
+   uint32_t wait;
+   uint32_t rem;
+   int16_t value = 0;
+   
+   do
+   {
+      // Sleep until the next result is due
+      wait = FETCH_TMO_US;
+      pending = 0;
+      for (i = 0; i < n; i++)
+      {
+         if (devs[i]->meas == SHT21_MEAS_NONE) continue;
+         pending++;
+         rem = SHT21_Remaining(devs[i]);
+         if (rem < wait) wait = rem;
+      }
+      if (!pending) break;
+      usleep(wait ? wait : FETCH_POLL_US);
+      
+      for (i = 0; i < n; i++)
+      {
+         meas = devs[i]->meas;
+         if (meas == SHT21_MEAS_NONE || SHT21_Remaining(devs[i])) continue;
+         
+         error = SHT21_Fetch(devs[i], &value);
+         if (error == SHT21_ERR_BUSY) continue;
+         if (error) failed++;
+         if (cb) cb(devs[i], meas, error, value, arg);
+      }
+   } while (1);
+   
+   return failed;
+}
+
+//------------------------------------------------------------------------------
+// Name:      SHT21_Sweep
+// Function:  Read temperature and humidity from several sensors on separate
+//            buses, overlapping their conversions
+//            Each sensor runs its own sequence (trigger T, wait, fetch T,
+//            trigger RH, wait, fetch RH). Whenever one of them is due it is
+//            advanced as far as it gets without waiting, the others keep
+//            converting meanwhile, so a sweep takes about as long as one
+//            sensor's two conversions, independent of the number of sensors.
+//            
+// Parameter: SHT21_Dev **devs   : session handles
+//            uint8_t n          : number of session handles
+//            int16_t *temp      : temperatures (in 10th C), one per sensor
+//            uint16_t *humidity : rel. humidities (in 10th %), one per sensor
+//            uint8_t *errors    : error bits, one per sensor
+//
+// Return:     0: SUCCESS
+//            >0: ERROR (error bits of all sensors ORed together)
+//------------------------------------------------------------------------------
+uint8_t SHT21_Sweep(SHT21_Dev **devs, uint8_t n, int16_t *temp, uint16_t *humidity,
+                    uint8_t *errors)
+{
+   uint8_t state[256];
+   uint8_t i;
+   uint8_t pending;
+   uint8_t error = 0;
+   uint32_t wait;
+   uint32_t rem;
+   
+   for (i = 0; i < n; i++)
+   {
+      state[i] = SWEEP_TRIG_T;
+      errors[i] = 0;
+   }
+   
+   do
+   {
+      wait = FETCH_TMO_US;
+      pending = 0;
+      for (i = 0; i < n; i++)
+      {
+         if (state[i] == SWEEP_DONE) continue;
+         
+         state[i] = SHT21_SweepStep(devs[i], state[i], &temp[i], &humidity[i], &errors[i]);
+         if (state[i] == SWEEP_DONE) continue;
+         
+         pending++;
+         rem = SHT21_Remaining(devs[i]);
+         if (rem < wait) wait = rem;
+      }
+      if (!pending) break;
+      
+      // Sleep until the next result is due
+      usleep(wait ? wait : FETCH_POLL_US);
+   } while (1);
+   
+   for (i = 0; i < n; i++)
+   {
+      error |= errors[i];
+   }
+   return error;
+}
+
+//------------------------------------------------------------------------------
+// Name:      SHT21_PoolStart
+// Function:  Start worker threads that share the sweeps of SHT21_PoolSweep()
+//            
+// Parameter: SHT21_Pool *pool   : pool to initialise
+//            uint8_t nthreads   : number of workers (1..SHT21_POOL_THREADS)
+//            const RT_Config *rt: settings of the workers, NULL for none
+//
+// Return:     0: SUCCESS
+//            >0: ERROR (no worker could be started)
+//------------------------------------------------------------------------------
+uint8_t SHT21_PoolStart(SHT21_Pool *pool, uint8_t nthreads, const RT_Config *rt)
+{
+   uint8_t i;
+   
+   if (nthreads == 0) nthreads = 1;
+   if (nthreads > SHT21_POOL_THREADS) nthreads = SHT21_POOL_THREADS;
+   
+   pthread_mutex_init(&pool->lock, NULL);
+   pthread_cond_init(&pool->go, NULL);
+   pthread_cond_init(&pool->done, NULL);
+   pool->realtime = (rt != NULL);
+   if (rt)
+   {
+      pool->rt = *rt;
+   }
+   pool->started = 0;
+   pool->round = 0;
+   pool->busy = 0;
+   pool->stop = 0;
+   pool->n = 0;
+   
+   for (i = 0; i < nthreads; i++)
+   {
+      if (pthread_create(&pool->thread[i], NULL, SHT21_PoolWorker, pool) != 0)
+      {
+         break;
+      }
+   }
+   pool->nthreads = i;
+   
+   if (i == 0)
+   {
+      pthread_mutex_destroy(&pool->lock);
+      pthread_cond_destroy(&pool->go);
+      pthread_cond_destroy(&pool->done);
+      return 1;
+   }
+   return 0;
+}
+
+//------------------------------------------------------------------------------
+// Name:      SHT21_PoolSweep
+// Function:  Read temperature and humidity from several sensors, spread
+//            over the workers of a pool
+//            Sensors are handed out in turn, except that a sensor sharing
+//            a bus with an earlier one goes to the worker of that one, as
+//            their transactions would take turns anyway.
+//            
+// Parameter: SHT21_Pool *pool   : pool started by SHT21_PoolStart()
+//            SHT21_Dev **devs   : session handles
+//            uint8_t n          : number of session handles
+//            int16_t *temp      : temperatures (in 10th C), one per sensor
+//            uint16_t *humidity : rel. humidities (in 10th %), one per sensor
+//            uint8_t *errors    : error bits, one per sensor
+//
+// Return:     0: SUCCESS
+//            >0: ERROR (error bits of all sensors ORed together)
+//------------------------------------------------------------------------------
+uint8_t SHT21_PoolSweep(SHT21_Pool *pool, SHT21_Dev **devs, uint8_t n, int16_t *temp,
+                        uint16_t *humidity, uint8_t *errors)
+{
+   uint8_t i, j;
+   uint8_t next = 0;
+   uint8_t error = 0;
+   
+   pthread_mutex_lock(&pool->lock);
+   for (i = 0; i < n; i++)
+   {
+      for (j = 0; j < i && !SHT21_SameBus(devs[i], devs[j]); j++);
+      if (j < i)
+      {
+         pool->owner[i] = pool->owner[j];
+      }
+      else
+      {
+         pool->owner[i] = next;
+         next = (next + 1) % pool->nthreads;
+      }
+   }
+   pool->devs = devs;
+   pool->n = n;
+   pool->temp = temp;
+   pool->humidity = humidity;
+   pool->errors = errors;
+   pool->busy = pool->nthreads;
+   pool->round++;
+   pthread_cond_broadcast(&pool->go);
+   
+   while (pool->busy)
+   {
+      pthread_cond_wait(&pool->done, &pool->lock);
+   }
+   pthread_mutex_unlock(&pool->lock);
+   
+   for (i = 0; i < n; i++)
+   {
+      error |= errors[i];
+   }
+   return error;
+}
+
+//------------------------------------------------------------------------------
+// Name:      SHT21_PoolStop
+// Function:  Stop the workers of a pool and wait for them to exit
+//            
+// Parameter: SHT21_Pool *pool   : pool started by SHT21_PoolStart()
+//
+// Return:    None
+//------------------------------------------------------------------------------
+void SHT21_PoolStop(SHT21_Pool *pool)
+{
+   uint8_t i;
+   
+   pthread_mutex_lock(&pool->lock);
+   pool->stop = 1;
+   pthread_cond_broadcast(&pool->go);
+   pthread_mutex_unlock(&pool->lock);
+   
+   for (i = 0; i < pool->nthreads; i++)
+   {
+      pthread_join(pool->thread[i], NULL);
+   }
+   pthread_mutex_destroy(&pool->lock);
+   pthread_cond_destroy(&pool->go);
+   pthread_cond_destroy(&pool->done);
+}
+
+//------------------------------------------------------------------------------
+// Name:      SHT21_OpenMulti
+// Function:  Set up a parallel bus of several sensors
+//            All sensors share one SCL line, or each has its own SCL line
+//            (GPIO 0-31 only). They are all read in a single transaction
+//            by SHT21_ReadMulti(). The library is initialised if needed.
+//            
+// Parameter: MI2C_Bus *bus      : parallel bus to initialise
+//            const uint8_t *scl : SCL pins (1 shared or one per sensor)
+//            uint8_t nscl       : number of SCL pins
+//            const uint8_t *sda : SDA pins, one per sensor
+//            uint8_t n          : number of sensors
+//
+// Return:     0: SUCCESS
+//            >0: ERROR
+//------------------------------------------------------------------------------
+uint8_t SHT21_OpenMulti(MI2C_Bus *bus, const uint8_t *scl, uint8_t nscl,
+                        const uint8_t *sda, uint8_t n)
+{
+   if (SHT21_LibInit() != 0)
+   {
+      return 1;
+   }
+   
+   if (MI2C_Init(bus, scl, nscl, sda, n) != 0)
+   {
+      SHT21_LibRelease();
+      return 1;
+   }
+   return 0;
+}
+
+//------------------------------------------------------------------------------
+// Name:      SHT21_OpenMultiChip
+// Function:  Set up a parallel bus of several sensors on lines of the GPIO
+//            character device. Needs no mapped registers, so the library is
+//            not initialised.
+//            
+// Parameter: MI2C_Bus *bus      : parallel bus to initialise
+//            uint8_t chip       : N of /dev/gpiochipN
+//            const uint8_t *scl : SCL lines (1 shared or one per sensor)
+//            uint8_t nscl       : number of SCL lines
+//            const uint8_t *sda : SDA lines, one per sensor
+//            uint8_t n          : number of sensors
+//
+// Return:     0: SUCCESS
+//            >0: ERROR
+//------------------------------------------------------------------------------
+uint8_t SHT21_OpenMultiChip(MI2C_Bus *bus, uint8_t chip, const uint8_t *scl, uint8_t nscl,
+                            const uint8_t *sda, uint8_t n)
+{
+   return MI2C_InitChip(bus, chip, scl, nscl, sda, n);
+}
+
+//------------------------------------------------------------------------------
+// Name:      SHT21_CloseMulti
+// Function:  Release the lines of a parallel bus
+//            
+// Parameter: MI2C_Bus *bus      : parallel bus
+//
+// Return:    None
+//------------------------------------------------------------------------------
+void SHT21_CloseMulti(MI2C_Bus *bus)
+{
+   if (bus->lines.fd < 0)
+   {
+      SHT21_LibRelease();	// set up by SHT21_OpenMulti()
+   }
+   MI2C_Close(bus);
+}
+
+//------------------------------------------------------------------------------
+// Name:      SHT21_ReadMulti
+// Function:  Read temperature and humidity from all sensors of a parallel bus
+//            at the same time. Commands are sent to all sensors at once and
+//            their answers are sampled together, so a sweep over n sensors
+//            takes as long as reading a single one.
+//            
+// Parameter: MI2C_Bus *bus      : parallel bus set up by SHT21_OpenMulti()
+//            int16_t *temp      : temperatures (in 10th C), one per sensor
+//            uint16_t *humidity : rel. humidities (in 10th %), one per sensor
+//            uint8_t *errors    : error bits, one per sensor
+//
+// Return:     0: SUCCESS
+//            >0: ERROR (error bits of all sensors ORed together)
+//------------------------------------------------------------------------------
+uint8_t SHT21_ReadMulti(MI2C_Bus *bus, int16_t *temp, uint16_t *humidity, uint8_t *errors)
+{
+   uint8_t i;
+   uint8_t error = 0;
+   uint32_t valid;
+   uint16_t raw[MI2C_MAX_LINES];
+   
+   for (i = 0; i < bus->n; i++)
+   {
+      errors[i] = 0;
+   }
+   
+   valid = SHT21_MeasureMulti(bus, CMD_TMP_NOHLD, SHT21_ERR_T_TIMEOUT, SHT21_ERR_T_CRC, raw, errors);
+   for (i = 0; i < bus->n; i++)
+   {
+      if (valid & ((uint32_t)1 << i)) temp[i] = SHT21_ConvTemp(raw[i]);
+   }
+   
+   valid = SHT21_MeasureMulti(bus, CMD_HUM_NOHLD, SHT21_ERR_H_TIMEOUT, SHT21_ERR_H_CRC, raw, errors);
+   for (i = 0; i < bus->n; i++)
+   {
+      if (valid & ((uint32_t)1 << i)) humidity[i] = SHT21_ConvHum(raw[i]);
+      error |= errors[i];
+   }
+   
+   return(error);
+}
+
+//------------------------------------------------------------------------------
+// Name:      SHT21_SetResolutionMulti
+// Function:  Select the measurement resolution of all sensors of a parallel
+//            bus. The user registers are read together and written back in
+//            one transaction, so they have to agree apart from the
+//            resolution bits and the end of battery status; otherwise
+//            nothing is written. SHT21_ReadMulti() waits for the
+//            conversion times of the resolution once all sensors took it.
+//            
+// Parameter: MI2C_Bus *bus      : parallel bus set up by SHT21_OpenMulti()
+//            uint8_t resolution : SHT21_RES_xxx
+//            uint8_t *errors    : error bits, one per sensor
+//
+// Return:     0: SUCCESS
+//            >0: ERROR (error bits of all sensors ORed together, the bus
+//                keeps its previous resolution)
+//------------------------------------------------------------------------------
+uint8_t SHT21_SetResolutionMulti(MI2C_Bus *bus, uint8_t resolution, uint8_t *errors)
+{
+   uint8_t i;
+   uint8_t error = 0;
+   uint8_t d[2][MI2C_MAX_LINES];
+   uint8_t frame[2];
+   uint8_t user_reg = 0;
+   uint8_t have_reg = 0;
+   uint32_t nack;
+   
+   resolution &= USER_REG_RES;
+   for (i = 0; i < bus->n; i++)
+   {
+      errors[i] = 0;
+   }
+   
+   SI2C_LockBanks(bus->banks);
+   MI2C_Start(bus);
+   nack  = MI2C_SendByte(bus, (I2C_ADDR << 1) + 0);	// Addr + WR
+   nack |= MI2C_SendByte(bus, CMD_RD_REG);
+   MI2C_Start(bus);
+   nack |= MI2C_SendByte(bus, (I2C_ADDR << 1) + 1);	// Addr + RD
+   MI2C_ReadByte(bus, 1, d[0]);
+   MI2C_ReadByte(bus, 0, d[1]);
+   MI2C_Stop(bus);
+   SI2C_UnlockBanks(bus->banks);
+   
+   for (i = 0; i < bus->n; i++)
+   {
+      frame[0] = d[0][i];
+      frame[1] = d[1][i];
+      if (nack & ((uint32_t)1 << i))
+      {
+         errors[i] |= SHT21_ERR_NACK;
+      }
+      else if (frame[0] == 0)
+      {
+         errors[i] |= SHT21_ERR_REG;
+      }
+      else if (frame[1] != SHT21_CalcCrc(frame,1))
+      {
+         errors[i] |= SHT21_ERR_REG_CRC;
+      }
+      else if (!have_reg)
+      {
+         user_reg = (frame[0] & ~(USER_REG_RES | USER_REG_BATT)) | resolution;
+         have_reg = 1;
+      }
+      else if (user_reg != ((frame[0] & ~(USER_REG_RES | USER_REG_BATT)) | resolution))
+      {
+         errors[i] |= SHT21_ERR_REG;
+      }
+      error |= errors[i];
+   }
+   
+   if (error == 0)
+   {
+      SI2C_LockBanks(bus->banks);
+      MI2C_Start(bus);
+      nack  = MI2C_SendByte(bus, (I2C_ADDR << 1) + 0);	// Addr + WR
+      nack |= MI2C_SendByte(bus, CMD_WR_REG);		// User register
+      nack |= MI2C_SendByte(bus, user_reg);		// Value
+      MI2C_Stop(bus);
+      SI2C_UnlockBanks(bus->banks);
+      
+      for (i = 0; i < bus->n; i++)
+      {
+         if (nack & ((uint32_t)1 << i))
+         {
+            errors[i] |= SHT21_ERR_NACK;
+            error |= SHT21_ERR_NACK;
+         }
+      }
+   }
+   
+   if (error == 0)
+   {
+      bus->resolution = resolution;
+   }
+   return(error);
+}
+
+//------------------------------------------------------------------------------
+// Name:      SHT21_CheckFrames
+// Function:  Validate the CRC of many raw measurement frames in one pass
+//            Uses SSSE3 or NEON table lookups on 16 or 8 frames at a time
+//            where the CPU has them, the CRC table otherwise.
+//            
+// Parameter: const uint8_t *frames : frames of 3 bytes (MSB, LSB, CRC)
+//            uint32_t n            : number of frames
+//            uint8_t *valid        : 1 per valid frame, 0 per invalid one
+//                                    (NULL if not needed)
+//
+// Return:    number of valid frames
+//------------------------------------------------------------------------------
+uint32_t SHT21_CheckFrames(const uint8_t *frames, uint32_t n, uint8_t *valid)
+{
+   uint32_t i = 0;
+   uint32_t cnt = 0;
+   uint8_t ok;
+   
+#ifdef SHT21_SIMD_X86
+   if (n >= 16 && __builtin_cpu_supports("ssse3"))
+   {
+      i = n & ~15;
+      cnt = SHT21_CheckFramesSsse3(frames, i, valid);
+   }
+#endif
+#ifdef SHT21_SIMD_NEON
+   i = n & ~7;
+   cnt = SHT21_CheckFramesNeon(frames, i, valid);
+#endif
+   
+   for (; i < n; i++)
+   {
+      ok = (crc_table[crc_table[frames[3*i]] ^ frames[3*i + 1]] == frames[3*i + 2]);
+      if (valid) valid[i] = ok;
+      cnt += ok;
+   }
+   return cnt;
+}
+
+//------------------------------------------------------------------------------
+// Name:      SHT21_BatchTemp
+// Function:  Convert raw temperature values to 100th C
+//            
+// Parameter: const uint16_t *raw : raw sensor values
+//            int16_t *temp       : temperatures (in 100th C)
+//            uint32_t n          : number of values
+//
+// Return:    None
+//------------------------------------------------------------------------------
+void SHT21_BatchTemp(const uint16_t *raw, int16_t *temp, uint32_t n)
+{
+   SHT21_ConvFixed(raw, (uint16_t *)temp, n, CONV_T_MUL, CONV_T_OFS, 0);
+}
+
+//------------------------------------------------------------------------------
+// Name:      SHT21_BatchHum
+// Function:  Convert raw humidity values to 10th %, values below 0 % read 0
+//            
+// Parameter: const uint16_t *raw : raw sensor values
+//            uint16_t *humidity  : rel. humidities (in 10th %)
+//            uint32_t n          : number of values
+//
+// Return:    None
+//------------------------------------------------------------------------------
+void SHT21_BatchHum(const uint16_t *raw, uint16_t *humidity, uint32_t n)
+{
+   SHT21_ConvFixed(raw, humidity, n, CONV_H_MUL, CONV_H_OFS, 1);
+}
+
+//------------------------------------------------------------------------------
+// Name:      SHT21_BatchTempFloat
+// Function:  Convert raw temperature values to C
+//            
+// Parameter: const uint16_t *raw : raw sensor values
+//            float *temp         : temperatures (in C)
+//            uint32_t n          : number of values
+//
+// Return:    None
+//------------------------------------------------------------------------------
+void SHT21_BatchTempFloat(const uint16_t *raw, float *temp, uint32_t n)
+{
+   SHT21_ConvFloat(raw, temp, n, CONV_T_SCALE, CONV_T_OFSF);
+}
+
+//------------------------------------------------------------------------------
+// Name:      SHT21_BatchHumFloat
+// Function:  Convert raw humidity values to %
+//            
+// Parameter: const uint16_t *raw : raw sensor values
+//            float *humidity     : rel. humidities (in %)
+//            uint32_t n          : number of values
+//
+// Return:    None
+//------------------------------------------------------------------------------
+void SHT21_BatchHumFloat(const uint16_t *raw, float *humidity, uint32_t n)
+{
+   SHT21_ConvFloat(raw, humidity, n, CONV_H_SCALE, CONV_H_OFSF);
+}
+
+//------------------------------------------------------------------------------
+// Name:      SHT21_LibInit
+// Function:  Take a reference to the mapped peripherals for a session,
+//            released by SHT21_LibRelease(). The first call also takes the
+//            reference of the library, released by SHT21_Cleanup().
+//            
+// Parameter: None
+//
+// Return:     0: SUCCESS
+//            >0: ERROR
+//------------------------------------------------------------------------------
+static uint8_t SHT21_LibInit(void)
+{
+   uint8_t error = 0;
+   
+   pthread_mutex_lock(&lib_lock);
+   if (!lib_initialised)
+   {
+      if (bcm2835_init() == 0)
+      {
+         error = 1;
+      }
+      else
+      {
+         lib_initialised = 1;
+      }
+   }
+   if (!error && bcm2835_init() == 0)
+   {
+      error = 1;
+   }
+   pthread_mutex_unlock(&lib_lock);
+   
+   return(error);
+}
+
+//------------------------------------------------------------------------------
+// Name:      SHT21_LibRelease
+// Function:  Drop the reference of a session taken by SHT21_LibInit()
+//            
+// Parameter: None
+//
+// Return:    None
+//------------------------------------------------------------------------------
+static void SHT21_LibRelease(void)
+{
+   bcm2835_close();
+}
+
+//------------------------------------------------------------------------------
+// Name:      SHT21_Attach
+// Function:  Connect a session handle to one of the built-in transports
+//            
+// Parameter: SHT21_Dev *dev           : session handle to initialise
+//            const SHT21_Config *cfg  : transport and its settings
+//
+// Return:     0: SUCCESS
+//            >0: ERROR
+//------------------------------------------------------------------------------
+static uint8_t SHT21_Attach(SHT21_Dev *dev, const SHT21_Config *cfg)
+{
+   // Closed until the transport is open, so a failed attach leaves a
+   // handle whose reads fail and whose close does nothing
+   SHT21_Detach(dev);
+   dev->user_reg = 0;
+   dev->resolution = cfg->resolution & USER_REG_RES;
+   dev->meas = SHT21_MEAS_NONE;
+   dev->ready_at = 0;
+   SHT21_InitStats(dev);
+   
+   // Only the transports on the BCM2835 registers need them mapped
+   if ((cfg->transport == SHT21_TR_GPIO || cfg->transport == SHT21_TR_BSC) &&
+       SHT21_LibInit() != 0)
+   {
+      return 1;
+   }
+   
+   switch (cfg->transport)
+   {
+      case SHT21_TR_GPIO:
+         SI2C_Init(&dev->port.gpio, cfg->scl, cfg->sda);
+         if (cfg->speed)
+         {
+            SI2C_SetSpeed(&dev->port.gpio, cfg->speed);
+         }
+         dev->port.gpio.stretch = &dev->bus_stats.stretch;
+         dev->bus.ops = &SI2C_Ops;
+         dev->bus.ctx = &dev->port.gpio;
+         break;
+         
+      case SHT21_TR_BSC:
+         if (BSC_Init(&dev->port.bsc, cfg->speed) != 0)
+         {
+            SHT21_LibRelease();
+            return 1;
+         }
+         dev->bus.ops = &BSC_Ops;
+         dev->bus.ctx = &dev->port.bsc;
+         break;
+         
+      case SHT21_TR_I2CDEV:
+         if (I2CDEV_Open(&dev->port.i2cdev, cfg->adapter) != 0)
+         {
+            return 1;
+         }
+         if (cfg->hold == SHT21_HOLD_ON ||
+             (cfg->hold == SHT21_HOLD_AUTO && dev->port.i2cdev.stretch))
+         {
+            dev->bus.ops = &I2CDEV_HoldOps;
+         }
+         else
+         {
+            dev->bus.ops = &I2CDEV_Ops;
+         }
+         dev->bus.ctx = &dev->port.i2cdev;
+         break;
+         
+      case SHT21_TR_GPIOCHIP:
+         if (MI2C_InitChip(&dev->port.gpiochip, cfg->adapter, &cfg->scl, 1, &cfg->sda, 1) != 0)
+         {
+            return 1;
+         }
+         if (cfg->speed)
+         {
+            MI2C_SetSpeed(&dev->port.gpiochip, cfg->speed);
+         }
+         dev->bus.ops = &MI2C_Ops;
+         dev->bus.ctx = &dev->port.gpiochip;
+         break;
+         
+      default:
+         return 1;
+   }
+   
+   dev->transport = cfg->transport;
+   return 0;
+}
+
+//------------------------------------------------------------------------------
+// Name:      SHT21_Detach
+// Function:  Mark a session handle closed, see SHT21_NoTransfer()
+//            
+// Parameter: SHT21_Dev *dev : session handle
+//
+// Return:    None
+//------------------------------------------------------------------------------
+static void SHT21_Detach(SHT21_Dev *dev)
+{
+   dev->transport = SHT21_TR_NONE;
+   dev->bus.ops = &closed_ops;
+   dev->bus.ctx = NULL;
+   dev->need_setup = 1;
+}
+
+//------------------------------------------------------------------------------
+// Name:      SHT21_NoTransfer
+// Function:  Transport operation of a closed session handle
+//            
+// Parameter: void *ctx, I2C_Msg *msgs, uint8_t n : unused
+//
+// Return:    I2C_ERR_BUS
+//------------------------------------------------------------------------------
+static uint8_t SHT21_NoTransfer(void *ctx, I2C_Msg *msgs, uint8_t n)
+{
+   (void)ctx;
+   (void)msgs;
+   (void)n;
+   return I2C_ERR_BUS;
+}
+
+//------------------------------------------------------------------------------
+// Name:      SHT21_InitStats
+// Function:  Clear the statistics of a session and let its bus count into
+//            them
+//            
+// Parameter: SHT21_Dev *dev : session handle
+//
+// Return:    None
+//------------------------------------------------------------------------------
+static void SHT21_InitStats(SHT21_Dev *dev)
+{
+   STAT_Clear(&dev->stats, sizeof(dev->stats));
+   STAT_Clear(&dev->bus_stats, sizeof(dev->bus_stats));
+   dev->bus.stats = &dev->bus_stats;
+}
+
+//------------------------------------------------------------------------------
+// Name:      SHT21_DevSetup
+// Function:  Reset the sensor of a session and set up its user register
+//            
+// Parameter: SHT21_Dev *dev : session handle
+//
+// Return:     0: SUCCESS
+//            >0: ERROR
+//------------------------------------------------------------------------------
+static uint8_t SHT21_DevSetup(SHT21_Dev *dev)
+{
+   uint8_t error;
+   
+   error  = SHT21_Reset(dev);
+   error |= SHT21_Setup(dev, dev->resolution, &dev->user_reg);
+   
+   dev->need_setup = (error != 0);
+   return(error);
+}
+
+//------------------------------------------------------------------------------
+// Name:      SHT21_Reset
+// Function:  Issue a soft reset and wait for the sensor to come up again
+//            
+// Parameter: SHT21_Dev *dev : session handle
+//
+// Return:     0: SUCCESS
+//            >0: ERROR
+//------------------------------------------------------------------------------
+static uint8_t SHT21_Reset(SHT21_Dev *dev)
+{
+   uint8_t cmd = CMD_SOFT_RST;
+   uint8_t error;
+   
+   error = SHT21_BusError(I2C_Write(&dev->bus, I2C_ADDR, &cmd, 1), 0);
+   if (error)
+   {
+      STAT_Inc(&dev->stats.nack_cmd);
+   }
+   
+   usleep(15000);
+   
+   return(error);
+}
+
+//------------------------------------------------------------------------------
+// Name:      SHT21_Setup
+// Function:  Read the user register and write it back to the sensor with
+//            the resolution bits set, keeping the reserved bits
+//            
+// Parameter: SHT21_Dev *dev     : session handle
+//            uint8_t resolution : SHT21_RES_xxx
+//            uint8_t *user_reg  : user register value written to the sensor
+//
+// Return:     0: SUCCESS
+//            >0: ERROR
+//------------------------------------------------------------------------------
+static uint8_t SHT21_Setup(SHT21_Dev *dev, uint8_t resolution, uint8_t *user_reg)
+{
+   uint8_t error;
+   uint8_t cmd = CMD_RD_REG;
+   uint8_t d[2] = { 0, 0 };
+   
+   error = SHT21_BusError(I2C_WriteRead(&dev->bus, I2C_ADDR, &cmd, 1, d, 2), 0);
+   
+   if(d[0] == 0) 
+   {
+      error |= SHT21_ERR_REG;
+   }
+   else if(d[1] == SHT21_CalcCrc(d,1))
+   {
+      *user_reg = (d[0] & ~USER_REG_RES) | resolution;
+      
+      d[1] = *user_reg;			// Value
+      d[0] = CMD_WR_REG;			// User register
+      error |= SHT21_BusError(I2C_Write(&dev->bus, I2C_ADDR, d, 2), 0);
+   }
+   else
+   {
+      STAT_Inc(&dev->stats.crc_errors);
+      error |= SHT21_ERR_REG_CRC;
+   }
+   
+   if (error & SHT21_ERR_NACK)
+   {
+      STAT_Inc(&dev->stats.nack_reg);
+   }
+   return(error);
+}
+
+//------------------------------------------------------------------------------
+// Name:      SHT21_Measure
+// Function:  Run one measurement and wait for its result
+//            In hold master mode if the transport supports clock stretching,
+//            otherwise in no hold master mode, polling the sensor.
+//            
+// Parameter: SHT21_Dev *dev     : session handle
+//            uint8_t meas       : SHT21_MEAS_TEMP or SHT21_MEAS_HUM
+//            uint8_t resolution : SHT21_RES_xxx the sensor is set up for
+//            uint16_t *raw      : raw sensor value (status bits cleared)
+//
+// Return:     0: SUCCESS
+//            >0: ERROR
+//------------------------------------------------------------------------------
+static uint8_t SHT21_Measure(SHT21_Dev *dev, uint8_t meas, uint8_t resolution, uint16_t *raw)
+{
+   I2C_Bus *bus = &dev->bus;
+   uint8_t error;
+   uint8_t err_tmo;
+   uint8_t err_crc;
+   uint8_t cmd;
+   uint8_t d[3] = { 0xFF, 0xFF, 0xFF };
+   uint32_t conv;
+   uint64_t start;
+   uint64_t deadline;
+   
+   if (meas == SHT21_MEAS_TEMP)
+   {
+      err_tmo = SHT21_ERR_T_TIMEOUT;
+      err_crc = SHT21_ERR_T_CRC;
+   }
+   else
+   {
+      err_tmo = SHT21_ERR_H_TIMEOUT;
+      err_crc = SHT21_ERR_H_CRC;
+   }
+   
+   start = SHT21_Now();
+   if (bus->ops->stretch)
+   {
+      cmd = (meas == SHT21_MEAS_TEMP) ? CMD_TMP_HLD : CMD_HUM_HLD;
+      error = I2C_WriteRead(bus, I2C_ADDR, &cmd, 1, d, 3);
+      if (error & (I2C_ERR_NACK | I2C_ERR_BUS))
+      {
+         STAT_Inc(&dev->stats.nack_cmd);
+      }
+   }
+   else
+   {
+      cmd = (meas == SHT21_MEAS_TEMP) ? CMD_TMP_NOHLD : CMD_HUM_NOHLD;
+      error = I2C_Write(bus, I2C_ADDR, &cmd, 1);
+      if (error)
+      {
+         STAT_Inc(&dev->stats.nack_cmd);
+      }
+      else
+      {
+         // Sensor does not acknowledge its address until the result is ready
+         conv = SHT21_ConvTime(meas, resolution);
+         deadline = start + conv + SHT21_FetchTimeout(conv);
+         do
+         {
+            usleep(FETCH_POLL_US);
+            error = I2C_Read(bus, I2C_ADDR, d, 3);
+            if (error == I2C_ERR_NACK)
+            {
+               STAT_Inc(&dev->stats.busy_polls);
+            }
+         } while (error == I2C_ERR_NACK && SHT21_Now() < deadline);
+         
+         if (error == I2C_ERR_NACK)
+         {
+            error = I2C_ERR_TIMEOUT;
+         }
+      }
+   }
+   if (error & I2C_ERR_TIMEOUT)
+   {
+      STAT_Inc(&dev->stats.timeouts);
+   }
+   error = SHT21_BusError(error, err_tmo);
+   
+   if(!(error & SHT21_ERR_NACK) && d[2] == SHT21_CalcCrc(d,2))
+   {
+      *raw = ((uint16_t)d[0] << 8 | d[1]) & 0xFFFC;
+      if (!error)
+      {
+         STAT_Inc(&dev->stats.measurements);
+         STAT_Record(&dev->stats.conv_wait, SHT21_Now() - start);
+      }
+   }
+   else
+   {
+      if(!error)
+      {
+         STAT_Inc(&dev->stats.crc_errors);
+      }
+      error |= err_crc;
+   }
+   return(error);
+}
+
+//------------------------------------------------------------------------------
+// Name:      SHT21_ReadValues
+// Function:  Measure temperature and humidity and convert them
+//            
+// Parameter: SHT21_Dev *dev     : session handle
+//            uint8_t resolution : SHT21_RES_xxx the sensor is set up for
+//            int16_t *temp      : temperature (in 10th C)
+//            uint16_t *humidity : rel. humidity (in 10th %)
+//
+// Return:     0: SUCCESS
+//            >0: ERROR
+//------------------------------------------------------------------------------
+static uint8_t SHT21_ReadValues(SHT21_Dev *dev, uint8_t resolution, int16_t *temp,
+                                uint16_t *humidity)
+{
+   uint8_t error;
+   uint8_t err;
+   uint16_t raw;
+   
+   //=== Temperature ===========================================================  	
+   
+   error = SHT21_Measure(dev, SHT21_MEAS_TEMP, resolution, &raw);
+   if (!(error & SHT21_ERR_T_CRC))
+   {
+      *temp = SHT21_ConvTemp(raw);
+   }
+   
+   //=== Humidity ==============================================================
+   
+   err = SHT21_Measure(dev, SHT21_MEAS_HUM, resolution, &raw);
+   if (!(err & SHT21_ERR_H_CRC))
+   {
+      *humidity = SHT21_ConvHum(raw);
+   }
+   error |= err;
+   
+   return(error);
+}
+
+//------------------------------------------------------------------------------
+// Name:      SHT21_ConvTime
+// Function:  Maximum conversion time of a measurement from the datasheet
+//            
+// Parameter: uint8_t meas       : SHT21_MEAS_TEMP or SHT21_MEAS_HUM
+//            uint8_t resolution : SHT21_RES_xxx
+//
+// Return:    conversion time (in us)
+//------------------------------------------------------------------------------
+static uint32_t SHT21_ConvTime(uint8_t meas, uint8_t resolution)
+{
+   uint8_t i = ((resolution >> 6) & 0x02) | (resolution & 0x01);
+   
+   return (meas == SHT21_MEAS_TEMP) ? tmp_conv_us[i] : hum_conv_us[i];
+}
+
+//------------------------------------------------------------------------------
+// Name:      SHT21_FetchTimeout
+// Function:  Time to keep polling for a result after it was due
+//            
+// Parameter: uint32_t conv : conversion time (in us)
+//
+// Return:    timeout (in us)
+//------------------------------------------------------------------------------
+static uint32_t SHT21_FetchTimeout(uint32_t conv)
+{
+   return (conv < FETCH_TMO_US) ? conv : FETCH_TMO_US;
+}
+
+//------------------------------------------------------------------------------
+// Name:      SHT21_BusError
+// Function:  Translate the error bits of a transport operation
+//            
+// Parameter: uint8_t err      : I2C_ERR_xxx bits
+//            uint8_t err_tmo  : error bit to report on a clock stretching
+//                               timeout
+//
+// Return:    SHT21_ERR_xxx bits
+//------------------------------------------------------------------------------
+static uint8_t SHT21_BusError(uint8_t err, uint8_t err_tmo)
+{
+   uint8_t error = 0;
+   
+   if (err & (I2C_ERR_NACK | I2C_ERR_BUS)) error |= SHT21_ERR_NACK;
+   if (err & I2C_ERR_TIMEOUT) error |= err_tmo ? err_tmo : SHT21_ERR_NACK;
+   return(error);
+}
+
+//------------------------------------------------------------------------------
+// Name:      SHT21_SweepStep
+// Function:  Advance one sensor of SHT21_Sweep() until it has to wait for a
+//            conversion or is done
+//            
+// Parameter: SHT21_Dev *dev     : session handle
+//            uint8_t state      : SWEEP_xxx state of the sensor
+//            int16_t *temp      : temperature (in 10th C)
+//            uint16_t *humidity : rel. humidity (in 10th %)
+//            uint8_t *error     : error bits of the sensor
+//
+// Return:    new state
+//------------------------------------------------------------------------------
+static uint8_t SHT21_SweepStep(SHT21_Dev *dev, uint8_t state, int16_t *temp,
+                               uint16_t *humidity, uint8_t *error)
+{
+   int16_t value = 0;
+   uint8_t err;
+   
+   do
+   {
+      switch (state)
+      {
+         case SWEEP_TRIG_T:
+         case SWEEP_TRIG_H:
+            err = SHT21_Start(dev, state == SWEEP_TRIG_T ? SHT21_MEAS_TEMP : SHT21_MEAS_HUM);
+            if (err)
+            {
+               *error |= err;
+               return SWEEP_DONE;
+            }
+            state++;
+            break;
+            
+         case SWEEP_WAIT_T:
+         case SWEEP_WAIT_H:
+            if (SHT21_Remaining(dev))
+            {
+               return state;
+            }
+            err = SHT21_Fetch(dev, &value);
+            if (err == SHT21_ERR_BUSY)
+            {
+               return state;
+            }
+            if (err)
+            {
+               *error |= err;
+               return SWEEP_DONE;
+            }
+            if (state == SWEEP_WAIT_T)
+            {
+               *temp = value;
+               state = SWEEP_TRIG_H;
+            }
+            else
+            {
+               *humidity = (uint16_t)value;
+               state = SWEEP_DONE;
+            }
+            break;
+      }
+   } while (state != SWEEP_DONE);
+   
+   return state;
+}
+
+//------------------------------------------------------------------------------
+// Name:      SHT21_PoolWorker
+// Function:  Worker thread of a pool: sweep the sensors assigned to it each
+//            time SHT21_PoolSweep() hands out a sweep
+//            
+// Parameter: void *arg : pool
+//
+// Return:    NULL
+//------------------------------------------------------------------------------
+static void *SHT21_PoolWorker(void *arg)
+{
+   SHT21_Pool *pool = arg;
+   SHT21_Dev *devs[256];
+   int16_t temp[256];
+   uint16_t humidity[256];
+   uint8_t errors[256];
+   uint8_t idx[256];
+   RT_Config rt;
+   uint32_t round = 0;
+   uint8_t me, i, m;
+   
+   pthread_mutex_lock(&pool->lock);
+   me = pool->started++;
+   pthread_mutex_unlock(&pool->lock);
+   
+   if (pool->realtime)
+   {
+      rt = pool->rt;
+      if (rt.cpu >= 0)
+      {
+         rt.cpu += me;
+      }
+      RT_Enter(&rt);
+   }
+   
+   pthread_mutex_lock(&pool->lock);
+   while (1)
+   {
+      while (!pool->stop && pool->round == round)
+      {
+         pthread_cond_wait(&pool->go, &pool->lock);
+      }
+      if (pool->stop) break;
+      round = pool->round;
+      
+      m = 0;
+      for (i = 0; i < pool->n; i++)
+      {
+         if (pool->owner[i] != me) continue;
+         idx[m] = i;
+         devs[m++] = pool->devs[i];
+      }
+      pthread_mutex_unlock(&pool->lock);
+      
+      if (m)
+      {
+         SHT21_Sweep(devs, m, temp, humidity, errors);
+      }
+      for (i = 0; i < m; i++)
+      {
+         pool->temp[idx[i]] = temp[i];
+         pool->humidity[idx[i]] = humidity[i];
+         pool->errors[idx[i]] = errors[i];
+      }
+      
+      pthread_mutex_lock(&pool->lock);
+      if (--pool->busy == 0)
+      {
+         pthread_cond_signal(&pool->done);
+      }
+   }
+   pthread_mutex_unlock(&pool->lock);
+   
+   if (pool->realtime)
+   {
+      RT_Leave();
+   }
+   return NULL;
+}
+
+//------------------------------------------------------------------------------
+// Name:      SHT21_SameBus
+// Function:  Check whether the transactions of two sessions take turns:
+//            bit-banged buses with pins in a common GPFSEL register, or both
+//            on the BSC controller
+//            
+// Parameter: SHT21_Dev *a, *b : session handles
+//
+// Return:    1: same bus, 0: independent buses
+//------------------------------------------------------------------------------
+static uint8_t SHT21_SameBus(SHT21_Dev *a, SHT21_Dev *b)
+{
+   if (a->transport != b->transport) return 0;
+   
+   switch (a->transport)
+   {
+      case SHT21_TR_GPIO:
+         return (a->port.gpio.banks & b->port.gpio.banks) != 0;
+      case SHT21_TR_BSC:
+         return 1;
+      default:
+         return 0;
+   }
+}
+
+//------------------------------------------------------------------------------
+// Name:      SHT21_MeasureMulti
+// Function:  Run one measurement on all sensors of a parallel bus
+//            The measurement is triggered in no hold master mode on all
+//            sensors at once, then the sensors are polled together until
+//            each of them has delivered its result or the conversion time
+//            of the bus resolution has run out.
+//            
+// Parameter: MI2C_Bus *bus     : parallel bus the sensors are connected to
+//            uint8_t cmd       : no hold master measurement command
+//            uint8_t err_tmo   : error bit to report on timeout
+//            uint8_t err_crc   : error bit to report on CRC mismatch
+//            uint16_t *raw     : raw sensor values (status bits cleared)
+//            uint8_t *errors   : error bits per sensor (ORed in)
+//
+// Return:    mask of the sensors which delivered a valid value
+//------------------------------------------------------------------------------
+static uint32_t SHT21_MeasureMulti(MI2C_Bus *bus, uint8_t cmd, uint8_t err_tmo,
+                                   uint8_t err_crc, uint16_t *raw, uint8_t *errors)
+{
+   uint8_t i;
+   uint8_t d[3][MI2C_MAX_LINES];
+   uint8_t frame[3];
+   uint32_t all;
+   uint32_t nack;
+   uint32_t acked;
+   uint32_t pending;
+   uint32_t valid = 0;
+   uint32_t conv;
+   uint64_t deadline;
+   
+   all = (bus->n == 32) ? 0xFFFFFFFF : (((uint32_t)1 << bus->n) - 1);
+   
+   SI2C_LockBanks(bus->banks);
+   MI2C_Start(bus);
+   nack  = MI2C_SendByte(bus, (I2C_ADDR << 1) + 0);	// Addr + WR
+   nack |= MI2C_SendByte(bus, cmd);
+   MI2C_Stop(bus);
+   SI2C_UnlockBanks(bus->banks);
+   
+   for (i = 0; i < bus->n; i++)
+   {
+      if (nack & ((uint32_t)1 << i)) errors[i] |= SHT21_ERR_NACK;
+   }
+   
+   pending = all & ~nack;
+   conv = SHT21_ConvTime((cmd == CMD_TMP_NOHLD) ? SHT21_MEAS_TEMP : SHT21_MEAS_HUM, bus->resolution);
+   deadline = SHT21_Now() + conv + SHT21_FetchTimeout(conv);
+   
+   while (pending)
+   {
+      usleep(FETCH_POLL_US);
+      
+      // Sensors still converting do not acknowledge and ignore the rest
+      SI2C_LockBanks(bus->banks);
+      MI2C_Start(bus);
+      acked = pending & ~MI2C_SendByte(bus, (I2C_ADDR << 1) + 1);
+      if (acked)
+      {
+         MI2C_ReadByte(bus, 1, d[0]);
+         MI2C_ReadByte(bus, 1, d[1]);
+         MI2C_ReadByte(bus, 0, d[2]);
+      }
+      MI2C_Stop(bus);
+      SI2C_UnlockBanks(bus->banks);
+      
+      for (i = 0; i < bus->n; i++)
+      {
+         if (!(acked & ((uint32_t)1 << i))) continue;
+         
+         frame[0] = d[0][i];
+         frame[1] = d[1][i];
+         frame[2] = d[2][i];
+         if (frame[2] == SHT21_CalcCrc(frame,2))
+         {
+            raw[i] = ((uint16_t)frame[0] << 8 | frame[1]) & 0xFFFC;
+            valid |= (uint32_t)1 << i;
+         }
+         else
+         {
+            errors[i] |= err_crc;
+         }
+      }
+      pending &= ~acked;
+      
+      if (pending && SHT21_Now() > deadline)
+      {
+         for (i = 0; i < bus->n; i++)
+         {
+            if (pending & ((uint32_t)1 << i)) errors[i] |= err_tmo;
+         }
+         break;
+      }
+   }
+   return valid;
+}
+
+//------------------------------------------------------------------------------
+// Name:      SHT21_ConvTemp
+// Function:  Convert a raw temperature value
+//            
+// Parameter: uint16_t raw : raw sensor value (status bits cleared)
+//
+// Return:    temperature (in 10th C)
+//------------------------------------------------------------------------------
+static int16_t SHT21_ConvTemp(uint16_t raw)
+{
+   int32_t val = raw;
+   
+   // Convert raw value from sensor to one tenth of a Celsius temperature
+   // From datasheet chapter 6.1:
+   //   T = -46,85 + 175,72 * St/65535
+   // Optimise for integer fixed point arithmetic:
+   //   100 * T = -4685 + 17572*St/2^16
+   //   100 * T = 4393*St/2^14 - 4685
+   val = ((val * 4393) >> 14) - 4685;
+   return (int16_t)(val/10);
+}
+
+//------------------------------------------------------------------------------
+// Name:      SHT21_ConvHum
+// Function:  Convert a raw humidity value
+//            
+// Parameter: uint16_t raw : raw sensor value (status bits cleared)
+//
+// Return:    rel. humidity (in 10th %)
+//------------------------------------------------------------------------------
+static uint16_t SHT21_ConvHum(uint16_t raw)
+{
+   uint32_t val = raw;
+   
+   // Convert raw value from sensor to one tenth of a percent relative humidity
+   // From datasheet chapter 6.1:
+   //   RH = -6 + 125*Srh/2^16
+   // Optimise for integer fixed point arithmetic:
+   //   10 * RH = -60 + 1250*Srh/2^16
+   //   10 * RH = 625*Srh/2^15 - 60
+   val = (625 * val) >> 15;
+   return (val > 60) ? (uint16_t)(val - 60) : 0;
+}
+
+//------------------------------------------------------------------------------
+// Name:      SHT21_CalcCrc
+// Function:  Calculate the CRC-8 of the sensor over a buffer
+//            
+// Parameter: uint8_t *data      : pointer to data buffer
+//            uint8_t nbrOfBytes : number of bytes
+// Return:    CRC
+//------------------------------------------------------------------------------
+static uint8_t SHT21_CalcCrc(uint8_t *data,uint8_t nbrOfBytes)
+{
+   uint8_t byteCtr,crc;
+   
+   crc = 0;
+   
+   for (byteCtr = 0; byteCtr < nbrOfBytes; ++byteCtr)
+   { 
+      crc = crc_table[crc ^ data[byteCtr]];
+   }
+   return(crc);
+}
+
+#ifdef SHT21_SIMD_X86
+//------------------------------------------------------------------------------
+// Name:      SHT21_CheckFramesSsse3
+// Function:  SHT21_CheckFrames() for a multiple of 16 frames with SSSE3
+//            The 48 bytes of 16 frames are split into the MSB, LSB and CRC
+//            vectors with byte shuffles, the CRCs are looked up per nibble.
+//            
+// Parameter: const uint8_t *frames : frames of 3 bytes (MSB, LSB, CRC)
+//            uint32_t n            : number of frames (multiple of 16)
+//            uint8_t *valid        : 1 per valid frame (NULL if not needed)
+//
+// Return:    number of valid frames
+//------------------------------------------------------------------------------
+__attribute__((target("ssse3")))
+static uint32_t SHT21_CheckFramesSsse3(const uint8_t *frames, uint32_t n, uint8_t *valid)
+{
+   int8_t sel[3][3][16];
+   uint8_t k, v, j;
+   uint32_t i;
+   uint32_t cnt = 0;
+   __m128i shuf[3][3];
+   __m128i in[3];
+   __m128i b[3];
+   __m128i nib = _mm_set1_epi8(0x0F);
+   __m128i lo = _mm_loadu_si128((const __m128i *)crc_lo);
+   __m128i hi = _mm_loadu_si128((const __m128i *)crc_hi);
+   __m128i lo2 = _mm_loadu_si128((const __m128i *)crc2_lo);
+   __m128i hi2 = _mm_loadu_si128((const __m128i *)crc2_hi);
+   __m128i crc, eq;
+   
+   // sel[k][v]: byte k of each frame taken from input vector v (-1 = none)
+   for (k = 0; k < 3; k++)
+   {
+      for (v = 0; v < 3; v++)
+      {
+         for (j = 0; j < 16; j++)
+         {
+            sel[k][v][j] = ((3*j + k) / 16 == v) ? (3*j + k) % 16 : -1;
+         }
+         shuf[k][v] = _mm_loadu_si128((const __m128i *)sel[k][v]);
+      }
+   }
+   
+   for (i = 0; i < n; i += 16)
+   {
+      in[0] = _mm_loadu_si128((const __m128i *)(frames + 3*i));
+      in[1] = _mm_loadu_si128((const __m128i *)(frames + 3*i + 16));
+      in[2] = _mm_loadu_si128((const __m128i *)(frames + 3*i + 32));
+      for (k = 0; k < 3; k++)
+      {
+         b[k] = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(in[0], shuf[k][0]),
+                                          _mm_shuffle_epi8(in[1], shuf[k][1])),
+                             _mm_shuffle_epi8(in[2], shuf[k][2]));
+      }
+      
+      crc = _mm_xor_si128(_mm_shuffle_epi8(lo2, _mm_and_si128(b[0], nib)),
+                          _mm_shuffle_epi8(hi2, _mm_and_si128(_mm_srli_epi16(b[0], 4), nib)));
+      crc = _mm_xor_si128(crc, _mm_shuffle_epi8(lo, _mm_and_si128(b[1], nib)));
+      crc = _mm_xor_si128(crc, _mm_shuffle_epi8(hi, _mm_and_si128(_mm_srli_epi16(b[1], 4), nib)));
+      eq = _mm_cmpeq_epi8(crc, b[2]);
+      
+      cnt += __builtin_popcount(_mm_movemask_epi8(eq));
+      if (valid)
+      {
+         _mm_storeu_si128((__m128i *)(valid + i), _mm_and_si128(eq, _mm_set1_epi8(1)));
+      }
+   }
+   return cnt;
+}
+#endif
+
+#ifdef SHT21_SIMD_NEON
+//------------------------------------------------------------------------------
+// Name:      SHT21_CheckFramesNeon
+// Function:  SHT21_CheckFrames() for a multiple of 8 frames with NEON
+//            The frames are split into MSB, LSB and CRC vectors by a
+//            de-interleaving load, the CRCs are looked up per nibble.
+//            
+// Parameter: const uint8_t *frames : frames of 3 bytes (MSB, LSB, CRC)
+//            uint32_t n            : number of frames (multiple of 8)
+//            uint8_t *valid        : 1 per valid frame (NULL if not needed)
+//
+// Return:    number of valid frames
+//------------------------------------------------------------------------------
+static uint32_t SHT21_CheckFramesNeon(const uint8_t *frames, uint32_t n, uint8_t *valid)
+{
+   uint8_t ok[8];
+   uint8_t j;
+   uint32_t i;
+   uint32_t cnt = 0;
+   uint8x8x3_t b;
+   uint8x8x2_t lo = { { vld1_u8(crc_lo), vld1_u8(crc_lo + 8) } };
+   uint8x8x2_t hi = { { vld1_u8(crc_hi), vld1_u8(crc_hi + 8) } };
+   uint8x8x2_t lo2 = { { vld1_u8(crc2_lo), vld1_u8(crc2_lo + 8) } };
+   uint8x8x2_t hi2 = { { vld1_u8(crc2_hi), vld1_u8(crc2_hi + 8) } };
+   uint8x8_t nib = vdup_n_u8(0x0F);
+   uint8x8_t crc;
+   
+   for (i = 0; i < n; i += 8)
+   {
+      b = vld3_u8(frames + 3*i);
+      
+      crc = veor_u8(vtbl2_u8(lo2, vand_u8(b.val[0], nib)), vtbl2_u8(hi2, vshr_n_u8(b.val[0], 4)));
+      crc = veor_u8(crc, vtbl2_u8(lo, vand_u8(b.val[1], nib)));
+      crc = veor_u8(crc, vtbl2_u8(hi, vshr_n_u8(b.val[1], 4)));
+      vst1_u8(ok, vand_u8(vceq_u8(crc, b.val[2]), vdup_n_u8(1)));
+      
+      for (j = 0; j < 8; j++)
+      {
+         cnt += ok[j];
+      }
+      if (valid)
+      {
+         vst1_u8(valid + i, vld1_u8(ok));
+      }
+   }
+   return cnt;
+}
+#endif
+
+//------------------------------------------------------------------------------
+// Name:      SHT21_ConvFixed
+// Function:  Fixed point conversion of raw values, y = ((x * mul) >> 16) - ofs
+//            with the status bits of x cleared. The product is the high
+//            half of a 16 x 16 bit multiplication, so the vector paths need
+//            no widening: 8 values per SSE2/NEON step, 16 per AVX2 step.
+//            
+// Parameter: const uint16_t *raw : raw sensor values
+//            uint16_t *out       : converted values
+//            uint32_t n          : number of values
+//            uint16_t mul        : factor
+//            uint16_t ofs        : offset
+//            uint8_t sat         : 1 to stop at 0, 0 to wrap (signed result)
+//
+// Return:    None
+//------------------------------------------------------------------------------
+static void SHT21_ConvFixed(const uint16_t *raw, uint16_t *out, uint32_t n,
+                            uint16_t mul, uint16_t ofs, uint8_t sat)
+{
+   uint32_t i = 0;
+   uint32_t val;
+   
+#ifdef SHT21_SIMD_X86
+   if (__builtin_cpu_supports("avx2"))
+   {
+      i = SHT21_ConvFixedAvx2(raw, out, n, mul, ofs, sat);
+   }
+#ifdef __SSE2__
+   else
+   {
+      __m128i vmask = _mm_set1_epi16((short)0xFFFC);
+      __m128i vmul = _mm_set1_epi16((short)mul);
+      __m128i vofs = _mm_set1_epi16((short)ofs);
+      __m128i x;
+      
+      for (; i + 8 <= n; i += 8)
+      {
+         x = _mm_loadu_si128((const __m128i *)(raw + i));
+         x = _mm_mulhi_epu16(_mm_and_si128(x, vmask), vmul);
+         x = sat ? _mm_subs_epu16(x, vofs) : _mm_sub_epi16(x, vofs);
+         _mm_storeu_si128((__m128i *)(out + i), x);
+      }
+   }
+#endif
+#endif
+#ifdef SHT21_SIMD_NEON
+   uint16x8_t vmask = vdupq_n_u16(0xFFFC);
+   uint16x4_t vmul = vdup_n_u16(mul);
+   uint16x8_t vofs = vdupq_n_u16(ofs);
+   uint16x8_t x;
+   
+   for (; i + 8 <= n; i += 8)
+   {
+      x = vandq_u16(vld1q_u16(raw + i), vmask);
+      x = vcombine_u16(vshrn_n_u32(vmull_u16(vget_low_u16(x), vmul), 16),
+                       vshrn_n_u32(vmull_u16(vget_high_u16(x), vmul), 16));
+      x = sat ? vqsubq_u16(x, vofs) : vsubq_u16(x, vofs);
+      vst1q_u16(out + i, x);
+   }
+#endif
+   
+   for (; i < n; i++)
+   {
+      val = ((uint32_t)(raw[i] & 0xFFFC) * mul) >> 16;
+      out[i] = (sat && val < ofs) ? 0 : (uint16_t)(val - ofs);
+   }
+}
+
+//------------------------------------------------------------------------------
+// Name:      SHT21_ConvFloat
+// Function:  Float conversion of raw values, y = x * scale + ofs with the
+//            status bits of x cleared. 4 values per SSE2/NEON step, 8 per
+//            AVX2 step.
+//            
+// Parameter: const uint16_t *raw : raw sensor values
+//            float *out          : converted values
+//            uint32_t n          : number of values
+//            float scale         : factor
+//            float ofs           : offset
+//
+// Return:    None
+//------------------------------------------------------------------------------
+static void SHT21_ConvFloat(const uint16_t *raw, float *out, uint32_t n,
+                            float scale, float ofs)
+{
+   uint32_t i = 0;
+   
+#ifdef SHT21_SIMD_X86
+   if (__builtin_cpu_supports("avx2"))
+   {
+      i = SHT21_ConvFloatAvx2(raw, out, n, scale, ofs);
+   }
+#ifdef __SSE2__
+   else
+   {
+      __m128i vmask = _mm_set1_epi16((short)0xFFFC);
+      __m128i zero = _mm_setzero_si128();
+      __m128 vscale = _mm_set1_ps(scale);
+      __m128 vofs = _mm_set1_ps(ofs);
+      __m128i x;
+      
+      for (; i + 8 <= n; i += 8)
+      {
+         x = _mm_and_si128(_mm_loadu_si128((const __m128i *)(raw + i)), vmask);
+         _mm_storeu_ps(out + i, _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(
+                       _mm_unpacklo_epi16(x, zero)), vscale), vofs));
+         _mm_storeu_ps(out + i + 4, _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(
+                       _mm_unpackhi_epi16(x, zero)), vscale), vofs));
+      }
+   }
+#endif
+#endif
+#ifdef SHT21_SIMD_NEON
+   uint16x4_t vmask = vdup_n_u16(0xFFFC);
+   float32x4_t vscale = vdupq_n_f32(scale);
+   float32x4_t vofs = vdupq_n_f32(ofs);
+   float32x4_t f;
+   
+   for (; i + 4 <= n; i += 4)
+   {
+      f = vcvtq_f32_u32(vmovl_u16(vand_u16(vld1_u16(raw + i), vmask)));
+      vst1q_f32(out + i, vaddq_f32(vmulq_f32(f, vscale), vofs));
+   }
+#endif
+   
+   for (; i < n; i++)
+   {
+      out[i] = (float)(raw[i] & 0xFFFC) * scale + ofs;
+   }
+}
+
+#ifdef SHT21_SIMD_X86
+//------------------------------------------------------------------------------
+// Name:      SHT21_ConvFixedAvx2 / SHT21_ConvFloatAvx2
+// Function:  AVX2 steps of SHT21_ConvFixed() / SHT21_ConvFloat()
+//            
+// Parameter: see SHT21_ConvFixed() / SHT21_ConvFloat()
+//
+// Return:    number of values converted, the rest is left to the caller
+//------------------------------------------------------------------------------
+__attribute__((target("avx2")))
+static uint32_t SHT21_ConvFixedAvx2(const uint16_t *raw, uint16_t *out, uint32_t n,
+                                    uint16_t mul, uint16_t ofs, uint8_t sat)
+{
+   uint32_t i;
+   __m256i vmask = _mm256_set1_epi16((short)0xFFFC);
+   __m256i vmul = _mm256_set1_epi16((short)mul);
+   __m256i vofs = _mm256_set1_epi16((short)ofs);
+   __m256i x;
+   
+   for (i = 0; i + 16 <= n; i += 16)
+   {
+      x = _mm256_loadu_si256((const __m256i *)(raw + i));
+      x = _mm256_mulhi_epu16(_mm256_and_si256(x, vmask), vmul);
+      x = sat ? _mm256_subs_epu16(x, vofs) : _mm256_sub_epi16(x, vofs);
+      _mm256_storeu_si256((__m256i *)(out + i), x);
+   }
+   return i;
+}
+
+__attribute__((target("avx2")))
+static uint32_t SHT21_ConvFloatAvx2(const uint16_t *raw, float *out, uint32_t n,
+                                    float scale, float ofs)
+{
+   uint32_t i;
+   __m128i vmask = _mm_set1_epi16((short)0xFFFC);
+   __m256 vscale = _mm256_set1_ps(scale);
+   __m256 vofs = _mm256_set1_ps(ofs);
+   __m256 f;
+   
+   for (i = 0; i + 8 <= n; i += 8)
+   {
+      f = _mm256_cvtepi32_ps(_mm256_cvtepu16_epi32(
+             _mm_and_si128(_mm_loadu_si128((const __m128i *)(raw + i)), vmask)));
+      _mm256_storeu_ps(out + i, _mm256_add_ps(_mm256_mul_ps(f, vscale), vofs));
+   }
+   return i;
+}
+#endif
+
+//------------------------------------------------------------------------------
+// Name:      SHT21_Now
+// Function:  Monotonic time stamp for conversion deadlines
+//            
+// Parameter: None
+// Return:    current time (in us)
+//------------------------------------------------------------------------------
+static uint64_t SHT21_Now(void)
+{
+   struct timespec ts;
+   
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
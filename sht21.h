@@ -1,65 +1,605 @@
-//------------------------------------------------------------------------------
-//
-// Filename:    sht21.h
-// Description: This file is part of the libsht library. 
-//              Declares the specific functions to read the Sensirion SHT21
-//              temperature and humidity sensor using the simulated I2C protocol
-//              
-// Author:      Martin Steppuhn, Ondrej Wisniewski
-// History:     26.11.2011 (MS) Initial version
-//              23.04.2015 (OW) Added SHT21_Init()
-//              24.04.2015 (OW) Code cleanup
-//              27.04.2015 (OW) Added SHT21_Cleanup()
-//------------------------------------------------------------------------------
-
-#ifndef SHT21_H
-#define SHT21_H
-
-/**** Includes ****************************************************************/
-
-/**** Preprocessing directives (#define) **************************************/
-
-/**** Type definitions (typedef) **********************************************/
-
-/**** Global constants (extern) ***********************************************/
-
-/**** Global variables (extern) ***********************************************/
-
-/**** Global function prototypes **********************************************/
-
-//------------------------------------------------------------------------------
-// Name:      SHT21_Init
-// Function:  Initialise the SHT library
-//            
-// Parameter: uint8_t scl : pin used for clock line
-//            uint8_t sda : pin used for data line
-//
-// Return:     0: SUCCESS
-//            >0: ERROR
-//------------------------------------------------------------------------------
-uint8_t SHT21_Init(uint8_t scl,uint8_t sda);
-
-//------------------------------------------------------------------------------
-// Name:      SHT21_Cleanup
-// Function:  Cleanup resources used by SHT library
-//            
-// Parameter: None
-//            
-// Return:     0: SUCCESS
-//            >0: ERROR
-//------------------------------------------------------------------------------
-uint8_t SHT21_Cleanup(void);
-
-//------------------------------------------------------------------------------
-// Name:      SHT21_Read
-// Function:  Read temperature and humidity from SHT21 sensor
-//            
-// Parameter: int16_t *temp      : temperature (in 10th C)
-//            uint16_t *humidity : rel. humidity (in 10th %)
-//
-// Return:     0: SUCCESS
-//            >0: ERROR
-//------------------------------------------------------------------------------
-uint8_t SHT21_Read(int16_t *temp,uint16_t *humidity);
-
-#endif
+//------------------------------------------------------------------------------
+//
+// Filename:    sht21.h
+// Description: This file is part of the libsht library. 
+//              Declares the specific functions to read the Sensirion SHT21
+//              temperature and humidity sensor using the simulated I2C protocol
+//              
+// Author:      Martin Steppuhn, Ondrej Wisniewski, agent
+// History:     26.11.2011 (MS) Initial version
+//              23.04.2015 (OW) Added SHT21_Init()
+//              24.04.2015 (OW) Code cleanup
+//              27.04.2015 (OW) Added SHT21_Cleanup()
+//              17.10.2026 (AG) Added session API SHT21_Open()/SHT21_ReadDev()
+//              17.10.2026 (AG) Added split-phase API SHT21_Start()/SHT21_Fetch()
+//              17.10.2026 (AG) Sessions own their bus context, no global port
+//              17.10.2026 (AG) Added SHT21_ReadMulti() for parallel buses
+//              17.10.2026 (AG) Sensors talk through a transport, added BSC
+//              17.10.2026 (AG) Added i2c-dev transport
+//              17.10.2026 (AG) Added pipelined multi-sensor SHT21_Sweep()
+//              17.10.2026 (AG) Added SHT21_SetResolution()
+//              17.10.2026 (AG) Added SHT21_CheckFrames()
+//              17.10.2026 (AG) Added batch conversions SHT21_BatchXxx()
+//              17.10.2026 (AG) Added GPIO character device transport
+//              17.10.2026 (AG) Added statistics SHT21_GetStats()
+//              17.10.2026 (AG) Added SHT21_SetRealtime()
+//              17.10.2026 (AG) Thread-safe library, added worker pool SHT21_Pool
+//              17.10.2026 (AG) Hold master mode selectable on i2c-dev
+//              17.10.2026 (AG) Added SHT21_SetResolutionMulti()
+//------------------------------------------------------------------------------
+
+#ifndef SHT21_H
+#define SHT21_H
+
+/**** Includes ****************************************************************/
+
+#include <stdint.h>
+#include <pthread.h>
+#include "i2cbus.h"
+#include "i2c.h"
+#include "bsc.h"
+#include "i2cdev.h"
+#include "mi2c.h"
+#include "rt.h"
+
+/**** Preprocessing directives (#define) **************************************/
+
+// Error bits returned by the read functions
+#define SHT21_ERR_NACK       0x01  // sensor did not acknowledge
+#define SHT21_ERR_REG        0x02  // invalid user register content
+#define SHT21_ERR_REG_CRC    0x04  // user register CRC mismatch
+#define SHT21_ERR_T_TIMEOUT  0x08  // temperature measurement timeout
+#define SHT21_ERR_T_CRC      0x10  // temperature CRC mismatch
+#define SHT21_ERR_H_TIMEOUT  0x20  // humidity measurement timeout
+#define SHT21_ERR_H_CRC      0x40  // humidity CRC mismatch
+#define SHT21_ERR_BUSY       0x80  // measurement still in progress
+
+// Measurements for the split-phase API
+#define SHT21_MEAS_TEMP      0
+#define SHT21_MEAS_HUM       1
+#define SHT21_MEAS_NONE      0xFF
+
+// Measurement resolutions (user register bits 7 and 0) and the maximum
+// conversion times of temperature / humidity from the datasheet
+#define SHT21_RES_RH12_T14   0x00  // 85 ms / 29 ms (power-on default)
+#define SHT21_RES_RH8_T12    0x01  // 22 ms /  4 ms
+#define SHT21_RES_RH10_T13   0x80  // 43 ms /  9 ms
+#define SHT21_RES_RH11_T11   0x81  // 11 ms / 15 ms
+
+// Transports of SHT21_OpenConfig()
+#define SHT21_TR_GPIO        0     // bit-banged on any two GPIO pins
+#define SHT21_TR_BSC         1     // BSC controller on GPIO 2/3 (native I2C)
+#define SHT21_TR_I2CDEV      2     // Linux i2c-dev interface /dev/i2c-N
+#define SHT21_TR_GPIOCHIP    3     // bit-banged through /dev/gpiochipN, any board
+#define SHT21_TR_NONE        0xFE  // not open: transport failed or closed
+#define SHT21_TR_CUSTOM      0xFF  // caller supplied, see SHT21_OpenBus()
+
+// Measurement mode of SHT21_OpenConfig() on SHT21_TR_I2CDEV
+#define SHT21_HOLD_AUTO      0     // hold master mode if the adapter supports
+                                   // long clock stretching (not on a BCM2835)
+#define SHT21_HOLD_ON        1     // hold master mode, one ioctl per measurement
+#define SHT21_HOLD_OFF       2     // no hold master mode, the sensor is polled
+
+#define SHT21_POOL_THREADS   16    // max worker threads of an SHT21_Pool
+
+/**** Type definitions (typedef) **********************************************/
+
+// Statistics of one sensor, see SHT21_GetStats()
+typedef struct
+{
+   uint64_t measurements;  // results read with a valid CRC
+   uint64_t nack_cmd;      // measurement or reset command not acknowledged
+   uint64_t nack_reg;      // user register access not acknowledged
+   uint64_t busy_polls;    // result polled while still converting (no ACK)
+   uint64_t crc_errors;    // result or user register with CRC mismatch
+   uint64_t timeouts;      // result not available within the timeout
+   uint64_t retries;       // reset and setup repeated after an error
+   STAT_Hist conv_wait;    // command until its result was read (in us)
+   STAT_Hist read;         // duration of SHT21_ReadDev()/SHT21_Read() (in us)
+} SHT21_Stats;
+
+// Session handle of one sensor, see SHT21_Open()
+// Sessions can be used from different threads, transactions on the same
+// physical bus are serialised by the transport. A session itself is used by
+// one thread at a time.
+typedef struct
+{
+   I2C_Bus bus;         // transport the sensor is connected to
+   union
+   {
+      SI2C_Bus gpio;    // context of SHT21_TR_GPIO
+      BSC_Bus bsc;      // context of SHT21_TR_BSC
+      I2CDEV_Bus i2cdev;// context of SHT21_TR_I2CDEV
+      MI2C_Bus gpiochip;// context of SHT21_TR_GPIOCHIP
+   } port;
+   uint8_t transport;   // SHT21_TR_xxx
+   uint8_t user_reg;    // user register content
+   uint8_t resolution;  // SHT21_RES_xxx
+   uint8_t need_setup;  // reset and setup pending
+   uint8_t meas;        // pending measurement, see SHT21_Start()
+   uint64_t started_at; // time the pending measurement was started (in us)
+   uint64_t ready_at;   // time the pending result is due (in us)
+   SHT21_Stats stats;   // statistics of the sensor
+   I2C_Stats bus_stats; // statistics of its transactions
+} SHT21_Dev;
+
+// Transport settings of SHT21_OpenConfig()
+typedef struct
+{
+   uint8_t transport;   // SHT21_TR_xxx
+   uint8_t scl;         // pin used for clock line (SHT21_TR_GPIO), or
+                        // line of the chip (SHT21_TR_GPIOCHIP)
+   uint8_t sda;         // pin or line used for data line, as scl
+   uint32_t speed;      // clock frequency in Hz, 0 for the default
+                        // (set by the kernel for SHT21_TR_I2CDEV)
+   uint8_t adapter;     // N of /dev/i2c-N (SHT21_TR_I2CDEV) or
+                        // of /dev/gpiochipN (SHT21_TR_GPIOCHIP)
+   uint8_t resolution;  // SHT21_RES_xxx, 0 for the power-on default
+   uint8_t hold;        // SHT21_HOLD_xxx (SHT21_TR_I2CDEV)
+} SHT21_Config;
+
+// Completion callback of SHT21_Collect()
+typedef void (*SHT21_Callback)(SHT21_Dev *dev, uint8_t meas, uint8_t error,
+                               int16_t value, void *arg);
+
+// Worker threads sweeping sensors in parallel, see SHT21_PoolStart()
+typedef struct
+{
+   pthread_t thread[SHT21_POOL_THREADS];
+   uint8_t nthreads;    // number of worker threads
+   uint8_t started;     // workers that took their number
+   RT_Config rt;        // settings of the workers, see SHT21_PoolStart()
+   uint8_t realtime;    // 1 = workers enter real-time mode with rt
+   pthread_mutex_t lock;
+   pthread_cond_t go;   // a sweep was handed out or the pool stops
+   pthread_cond_t done; // the last worker finished its share
+   uint32_t round;      // number of the current sweep
+   uint8_t busy;        // workers still at the current sweep
+   uint8_t stop;        // 1 = workers exit
+   SHT21_Dev **devs;    // current sweep, see SHT21_PoolSweep()
+   uint8_t n;
+   int16_t *temp;
+   uint16_t *humidity;
+   uint8_t *errors;
+   uint8_t owner[256];  // worker of each sensor
+} SHT21_Pool;
+
+/**** Global constants (extern) ***********************************************/
+
+/**** Global variables (extern) ***********************************************/
+
+/**** Global function prototypes **********************************************/
+
+//------------------------------------------------------------------------------
+// Name:      SHT21_Init
+// Function:  Initialise the SHT library
+//            
+// Parameter: uint8_t scl : pin used for clock line
+//            uint8_t sda : pin used for data line
+//
+// Return:     0: SUCCESS
+//            >0: ERROR
+//------------------------------------------------------------------------------
+uint8_t SHT21_Init(uint8_t scl,uint8_t sda);
+
+//------------------------------------------------------------------------------
+// Name:      SHT21_Cleanup
+// Function:  Cleanup resources used by SHT library
+//            
+// Parameter: None
+//            
+// Return:     0: SUCCESS
+//            >0: ERROR
+//------------------------------------------------------------------------------
+uint8_t SHT21_Cleanup(void);
+
+//------------------------------------------------------------------------------
+// Name:      SHT21_Read
+// Function:  Read temperature and humidity from SHT21 sensor
+//            
+// Parameter: int16_t *temp      : temperature (in 10th C)
+//            uint16_t *humidity : rel. humidity (in 10th %)
+//
+// Return:     0: SUCCESS
+//            >0: ERROR
+//------------------------------------------------------------------------------
+uint8_t SHT21_Read(int16_t *temp,uint16_t *humidity);
+
+//------------------------------------------------------------------------------
+// Name:      SHT21_Open
+// Function:  Open a measurement session on an SHT21 sensor
+//            The sensor is reset and set up only here and after read errors,
+//            so repeated reads through SHT21_ReadDev() cost just the
+//            two measurements. The library is initialised if needed.
+//            
+// Parameter: SHT21_Dev *dev : session handle to initialise
+//            uint8_t scl    : pin used for clock line
+//            uint8_t sda    : pin used for data line
+//
+// Return:     0: SUCCESS
+//            >0: ERROR (the setup is retried on the next read)
+//------------------------------------------------------------------------------
+uint8_t SHT21_Open(SHT21_Dev *dev,uint8_t scl,uint8_t sda);
+
+//------------------------------------------------------------------------------
+// Name:      SHT21_OpenConfig
+// Function:  Open a measurement session on a sensor connected through one of
+//            the built-in transports, see SHT21_Open()
+//            The BSC controller stretches the clock only for a limited time,
+//            so on that transport the measurements run in no hold master
+//            mode, polling the sensor. The i2c-dev transport needs neither
+//            root nor a BCM2835, only access to /dev/i2c-N. It polls the
+//            sensor as well unless cfg->hold selects hold master mode or
+//            the adapter is known to wait for long clock stretching; the
+//            kernel driver of the BCM2835 controller (/dev/i2c-1 on a
+//            Raspberry Pi) does not.
+//            
+// Parameter: SHT21_Dev *dev           : session handle to initialise
+//            const SHT21_Config *cfg  : transport and its settings
+//
+// Return:     0: SUCCESS
+//            >0: ERROR (the setup is retried on the next read,
+//                unless the transport could not be opened)
+//------------------------------------------------------------------------------
+uint8_t SHT21_OpenConfig(SHT21_Dev *dev,const SHT21_Config *cfg);
+
+//------------------------------------------------------------------------------
+// Name:      SHT21_OpenBus
+// Function:  Open a measurement session on a sensor connected through a
+//            transport supplied by the caller, see SHT21_Open()
+//            
+// Parameter: SHT21_Dev *dev     : session handle to initialise
+//            const I2C_Ops *ops : transport operations
+//            void *ctx          : context passed to the operations
+//
+// Return:     0: SUCCESS
+//            >0: ERROR (the setup is retried on the next read)
+//------------------------------------------------------------------------------
+uint8_t SHT21_OpenBus(SHT21_Dev *dev,const I2C_Ops *ops,void *ctx);
+
+//------------------------------------------------------------------------------
+// Name:      SHT21_ReadDev
+// Function:  Read temperature and humidity from an opened SHT21 sensor
+//            
+// Parameter: SHT21_Dev *dev     : session handle
+//            int16_t *temp      : temperature (in 10th C)
+//            uint16_t *humidity : rel. humidity (in 10th %)
+//
+// Return:     0: SUCCESS
+//            >0: ERROR
+//------------------------------------------------------------------------------
+uint8_t SHT21_ReadDev(SHT21_Dev *dev,int16_t *temp,uint16_t *humidity);
+
+//------------------------------------------------------------------------------
+// Name:      SHT21_Close
+// Function:  Close a measurement session
+//            The peripherals stay mapped while other sessions use them and
+//            until SHT21_Cleanup() is called. Closing twice does no harm,
+//            reads of a closed session fail with SHT21_ERR_NACK.
+//            
+// Parameter: SHT21_Dev *dev : session handle
+//
+// Return:    None
+//------------------------------------------------------------------------------
+void SHT21_Close(SHT21_Dev *dev);
+
+//------------------------------------------------------------------------------
+// Name:      SHT21_SetResolution
+// Function:  Select the measurement resolution of a session. Lower
+//            resolutions convert faster, e.g. SHT21_RES_RH8_T12 needs
+//            26 ms for both measurements instead of 114 ms.
+//            
+// Parameter: SHT21_Dev *dev     : session handle
+//            uint8_t resolution : SHT21_RES_xxx
+//
+// Return:     0: SUCCESS
+//            >0: ERROR (the setup is retried on the next read)
+//------------------------------------------------------------------------------
+uint8_t SHT21_SetResolution(SHT21_Dev *dev,uint8_t resolution);
+
+//------------------------------------------------------------------------------
+// Name:      SHT21_SetRealtime
+// Function:  Run the transactions of a session without system calls: the
+//            clock stretching of the sensor is busy-polled. Together with
+//            RT_Enter() on the thread reading the sensor this keeps bytes
+//            from being stretched by preemption, the achieved jitter is in
+//            the jitter histogram of SHT21_GetStats(), which is recorded
+//            only in real-time mode. Bit-banged transport (SHT21_TR_GPIO)
+//            only.
+//            
+// Parameter: SHT21_Dev *dev : session handle
+//            uint8_t on     : 1 = real-time mode, 0 = normal
+//
+// Return:     0: SUCCESS
+//            >0: ERROR (transport without real-time mode)
+//------------------------------------------------------------------------------
+uint8_t SHT21_SetRealtime(SHT21_Dev *dev,uint8_t on);
+
+//------------------------------------------------------------------------------
+// Name:      SHT21_GetStats
+// Function:  Copy the statistics of a session: counters of the sensor and
+//            of its transactions, latency histograms of the reads, the
+//            conversion waits, the transactions and the clock stretching
+//            (bit-banged transport in hold master mode). They are updated
+//            without locks and can be read at any time from any thread.
+//            Use STAT_Percentile() on the histograms of the copy.
+//            
+// Parameter: SHT21_Dev *dev     : session handle
+//            SHT21_Stats *stats : copy of the sensor statistics (or NULL)
+//            I2C_Stats *bus     : copy of the bus statistics (or NULL)
+//
+// Return:    None
+//------------------------------------------------------------------------------
+void SHT21_GetStats(SHT21_Dev *dev,SHT21_Stats *stats,I2C_Stats *bus);
+
+//------------------------------------------------------------------------------
+// Name:      SHT21_ResetStats
+// Function:  Set the statistics of a session to zero
+//            
+// Parameter: SHT21_Dev *dev : session handle
+//
+// Return:    None
+//------------------------------------------------------------------------------
+void SHT21_ResetStats(SHT21_Dev *dev);
+
+//------------------------------------------------------------------------------
+// Name:      SHT21_GetLibStats
+// Function:  Copy the statistics of the sensor of SHT21_Init()/SHT21_Read(),
+//            see SHT21_GetStats()
+//            
+// Parameter: SHT21_Stats *stats : copy of the sensor statistics (or NULL)
+//            I2C_Stats *bus     : copy of the bus statistics (or NULL)
+//
+// Return:    None
+//------------------------------------------------------------------------------
+void SHT21_GetLibStats(SHT21_Stats *stats,I2C_Stats *bus);
+
+//------------------------------------------------------------------------------
+// Name:      SHT21_Start
+// Function:  Trigger a measurement in no hold master mode and return
+//            immediately. The result is picked up later with SHT21_Fetch()
+//            or SHT21_Collect(), so conversions of several sensors can run
+//            at the same time.
+//            
+// Parameter: SHT21_Dev *dev : session handle
+//            uint8_t meas   : SHT21_MEAS_TEMP or SHT21_MEAS_HUM
+//
+// Return:     0: SUCCESS
+//            >0: ERROR
+//------------------------------------------------------------------------------
+uint8_t SHT21_Start(SHT21_Dev *dev,uint8_t meas);
+
+//------------------------------------------------------------------------------
+// Name:      SHT21_Fetch
+// Function:  Pick up the result of a measurement started with SHT21_Start()
+//            without waiting for it
+//            
+// Parameter: SHT21_Dev *dev : session handle
+//            int16_t *value : temperature (in 10th C) or
+//                             rel. humidity (in 10th %)
+//
+// Return:     0: SUCCESS
+//            SHT21_ERR_BUSY: result not available yet, try again later
+//            other: ERROR (no measurement pending, bus error, timeout or
+//                   CRC mismatch)
+//------------------------------------------------------------------------------
+uint8_t SHT21_Fetch(SHT21_Dev *dev,int16_t *value);
+
+//------------------------------------------------------------------------------
+// Name:      SHT21_Remaining
+// Function:  Time until the pending result of a sensor is due
+//            
+// Parameter: SHT21_Dev *dev : session handle
+//
+// Return:    remaining conversion time (in us), 0 if due or none pending
+//------------------------------------------------------------------------------
+uint32_t SHT21_Remaining(SHT21_Dev *dev);
+
+//------------------------------------------------------------------------------
+// Name:      SHT21_Collect
+// Function:  Harvest the pending results of several sensors, sleeping until
+//            the next one is due, until none is pending any more
+//            
+// Parameter: SHT21_Dev **devs   : session handles
+//            uint8_t n          : number of session handles
+//            SHT21_Callback cb  : called once per finished measurement
+//            void *arg          : passed through to the callback
+//
+// Return:    number of measurements that failed
+//------------------------------------------------------------------------------
+uint8_t SHT21_Collect(SHT21_Dev **devs,uint8_t n,SHT21_Callback cb,void *arg);
+
+//------------------------------------------------------------------------------
+// Name:      SHT21_Sweep
+// Function:  Read temperature and humidity from several sensors on separate
+//            buses. The conversions overlap: each sensor is triggered,
+//            fetched and triggered again as soon as it is ready, while the
+//            others keep converting, so a sweep takes about as long as
+//            reading a single sensor.
+//            
+// Parameter: SHT21_Dev **devs   : session handles
+//            uint8_t n          : number of session handles
+//            int16_t *temp      : temperatures (in 10th C), one per sensor
+//            uint16_t *humidity : rel. humidities (in 10th %), one per sensor
+//            uint8_t *errors    : error bits, one per sensor
+//
+// Return:     0: SUCCESS
+//            >0: ERROR (error bits of all sensors ORed together)
+//------------------------------------------------------------------------------
+uint8_t SHT21_Sweep(SHT21_Dev **devs,uint8_t n,int16_t *temp,uint16_t *humidity,
+                    uint8_t *errors);
+
+//------------------------------------------------------------------------------
+// Name:      SHT21_PoolStart
+// Function:  Start worker threads that share the sweeps of SHT21_PoolSweep()
+//            With rt the workers enter real-time mode (RT_Enter()), worker i
+//            pinned to core rt->cpu + i, so the buses are driven from
+//            separate cores.
+//            
+// Parameter: SHT21_Pool *pool   : pool to initialise
+//            uint8_t nthreads   : number of workers (1..SHT21_POOL_THREADS)
+//            const RT_Config *rt: settings of the workers, NULL for none
+//
+// Return:     0: SUCCESS
+//            >0: ERROR (no worker could be started)
+//------------------------------------------------------------------------------
+uint8_t SHT21_PoolStart(SHT21_Pool *pool,uint8_t nthreads,const RT_Config *rt);
+
+//------------------------------------------------------------------------------
+// Name:      SHT21_PoolSweep
+// Function:  Read temperature and humidity from several sensors, spread
+//            over the workers of a pool. Sensors that share a physical bus
+//            (or a GPFSEL register) go to the same worker, which reads its
+//            share with SHT21_Sweep(); sensors on independent buses are read
+//            in parallel.
+//            
+// Parameter: SHT21_Pool *pool   : pool started by SHT21_PoolStart()
+//            SHT21_Dev **devs   : session handles
+//            uint8_t n          : number of session handles
+//            int16_t *temp      : temperatures (in 10th C), one per sensor
+//            uint16_t *humidity : rel. humidities (in 10th %), one per sensor
+//            uint8_t *errors    : error bits, one per sensor
+//
+// Return:     0: SUCCESS
+//            >0: ERROR (error bits of all sensors ORed together)
+//------------------------------------------------------------------------------
+uint8_t SHT21_PoolSweep(SHT21_Pool *pool,SHT21_Dev **devs,uint8_t n,int16_t *temp,
+                        uint16_t *humidity,uint8_t *errors);
+
+//------------------------------------------------------------------------------
+// Name:      SHT21_PoolStop
+// Function:  Stop the workers of a pool and wait for them to exit
+//            
+// Parameter: SHT21_Pool *pool   : pool started by SHT21_PoolStart()
+//
+// Return:    None
+//------------------------------------------------------------------------------
+void SHT21_PoolStop(SHT21_Pool *pool);
+
+//------------------------------------------------------------------------------
+// Name:      SHT21_OpenMulti
+// Function:  Set up a parallel bus of several sensors, each on its own SDA
+//            pin. All sensors share one SCL line, or each has its own SCL
+//            line (GPIO 0-31 only). All pins must be in the same GPIO bank.
+//            The library is initialised if needed.
+//            
+// Parameter: MI2C_Bus *bus      : parallel bus to initialise
+//            const uint8_t *scl : SCL pins (1 shared or one per sensor)
+//            uint8_t nscl       : number of SCL pins
+//            const uint8_t *sda : SDA pins, one per sensor
+//            uint8_t n          : number of sensors
+//
+// Return:     0: SUCCESS
+//            >0: ERROR
+//------------------------------------------------------------------------------
+uint8_t SHT21_OpenMulti(MI2C_Bus *bus,const uint8_t *scl,uint8_t nscl,
+                        const uint8_t *sda,uint8_t n);
+
+//------------------------------------------------------------------------------
+// Name:      SHT21_OpenMultiChip
+// Function:  Set up a parallel bus of several sensors on lines of the GPIO
+//            character device /dev/gpiochipN. Works on any Linux board and
+//            with any lines of the chip, all of them are switched and
+//            sampled with one ioctl per clock edge.
+//            
+// Parameter: MI2C_Bus *bus      : parallel bus to initialise
+//            uint8_t chip       : N of /dev/gpiochipN
+//            const uint8_t *scl : SCL lines (1 shared or one per sensor)
+//            uint8_t nscl       : number of SCL lines
+//            const uint8_t *sda : SDA lines, one per sensor
+//            uint8_t n          : number of sensors
+//
+// Return:     0: SUCCESS
+//            >0: ERROR
+//------------------------------------------------------------------------------
+uint8_t SHT21_OpenMultiChip(MI2C_Bus *bus,uint8_t chip,const uint8_t *scl,uint8_t nscl,
+                            const uint8_t *sda,uint8_t n);
+
+//------------------------------------------------------------------------------
+// Name:      SHT21_CloseMulti
+// Function:  Release the lines of a parallel bus
+//            
+// Parameter: MI2C_Bus *bus      : parallel bus
+//
+// Return:    None
+//------------------------------------------------------------------------------
+void SHT21_CloseMulti(MI2C_Bus *bus);
+
+//------------------------------------------------------------------------------
+// Name:      SHT21_ReadMulti
+// Function:  Read temperature and humidity from all sensors of a parallel bus
+//            in a single transaction, so a sweep over n sensors takes as long
+//            as reading a single one
+//            
+// Parameter: MI2C_Bus *bus      : parallel bus set up by SHT21_OpenMulti()
+//            int16_t *temp      : temperatures (in 10th C), one per sensor
+//            uint16_t *humidity : rel. humidities (in 10th %), one per sensor
+//            uint8_t *errors    : error bits, one per sensor
+//
+// Return:     0: SUCCESS
+//            >0: ERROR (error bits of all sensors ORed together)
+//------------------------------------------------------------------------------
+uint8_t SHT21_ReadMulti(MI2C_Bus *bus,int16_t *temp,uint16_t *humidity,uint8_t *errors);
+
+//------------------------------------------------------------------------------
+// Name:      SHT21_SetResolutionMulti
+// Function:  Select the measurement resolution of all sensors of a parallel
+//            bus, written to them in one transaction. SHT21_ReadMulti()
+//            then waits only for the conversion times of that resolution.
+//            A bus starts out with the power-on default (RH12/T14).
+//            
+// Parameter: MI2C_Bus *bus      : parallel bus set up by SHT21_OpenMulti()
+//            uint8_t resolution : SHT21_RES_xxx
+//            uint8_t *errors    : error bits, one per sensor
+//
+// Return:     0: SUCCESS
+//            >0: ERROR (error bits of all sensors ORed together, the bus
+//                keeps its previous resolution)
+//------------------------------------------------------------------------------
+uint8_t SHT21_SetResolutionMulti(MI2C_Bus *bus,uint8_t resolution,uint8_t *errors);
+
+//------------------------------------------------------------------------------
+// Name:      SHT21_CheckFrames
+// Function:  Validate the CRC of many raw measurement frames in one pass,
+//            e.g. frames recorded from the bus for later replay
+//            
+// Parameter: const uint8_t *frames : frames of 3 bytes (MSB, LSB, CRC)
+//            uint32_t n            : number of frames
+//            uint8_t *valid        : 1 per valid frame, 0 per invalid one
+//                                    (NULL if not needed)
+//
+// Return:    number of valid frames
+//------------------------------------------------------------------------------
+uint32_t SHT21_CheckFrames(const uint8_t *frames,uint32_t n,uint8_t *valid);
+
+//------------------------------------------------------------------------------
+// Name:      SHT21_BatchTemp / SHT21_BatchHum
+// Function:  Convert arrays of raw sensor values (status bits are ignored),
+//            e.g. from recorded frames, with SSE2/AVX2 or NEON where the CPU
+//            has them. Temperatures come in 100th C, humidities in 10th %.
+//            
+// Parameter: const uint16_t *raw : raw sensor values
+//            int16_t *temp       : temperatures (in 100th C)
+//            uint16_t *humidity  : rel. humidities (in 10th %, 0 at least)
+//            uint32_t n          : number of values
+//
+// Return:    None
+//------------------------------------------------------------------------------
+void SHT21_BatchTemp(const uint16_t *raw,int16_t *temp,uint32_t n);
+void SHT21_BatchHum(const uint16_t *raw,uint16_t *humidity,uint32_t n);
+
+//------------------------------------------------------------------------------
+// Name:      SHT21_BatchTempFloat / SHT21_BatchHumFloat
+// Function:  Convert arrays of raw sensor values to C and % as float
+//            
+// Parameter: const uint16_t *raw : raw sensor values
+//            float *temp         : temperatures (in C)
+//            float *humidity     : rel. humidities (in %)
+//            uint32_t n          : number of values
+//
+// Return:    None
+//------------------------------------------------------------------------------
+void SHT21_BatchTempFloat(const uint16_t *raw,float *temp,uint32_t n);
+void SHT21_BatchHumFloat(const uint16_t *raw,float *humidity,uint32_t n);
+
+#endif
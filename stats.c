@@ -0,0 +1,138 @@
+//--------------------------------------------------------------------------------------------------
+//
+// Filename:    stats.c
+// Description: Counters and latency histograms of the buses and sensors
+//              Writers only ever add to the words of a statistics structure, readers copy it
+//              word by word. Both use relaxed atomic operations, so neither has to lock and a
+//              copy never contains a torn value.
+//
+// Open Source Licensing
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// Author:      agent
+// History:     17.10.2026 Initial version
+//--------------------------------------------------------------------------------------------------
+
+//=== Includes =====================================================================================
+
+#include <stdint.h>
+#include <stddef.h>
+#include "stats.h"
+#include "i2cbus.h"
+
+//=== Preprocessing directives (#define) ===========================================================
+
+//=== Type definitions (typedef) ===================================================================
+
+//=== Global constants =============================================================================
+
+//=== Global variables =============================================================================
+
+//=== Local constants  =============================================================================
+
+//=== Local variables ==============================================================================
+
+//=== Local function prototypes ====================================================================
+
+//--------------------------------------------------------------------------------------------------
+// Name:	STAT_Copy
+// Function:  	Take a copy of statistics that may be updated at the same time
+//
+// Parameter: 	destination, statistics structure (uint64_t only), its size
+// Return:    	-
+//--------------------------------------------------------------------------------------------------
+void STAT_Copy(void *dst,const void *src,size_t size)
+{
+   uint64_t *d = dst;
+   const uint64_t *s = src;
+   size_t i;
+
+   for(i=0;i<size/sizeof(uint64_t);i++)
+   {
+      d[i] = __atomic_load_n(&s[i],__ATOMIC_RELAXED);
+   }
+}
+
+//--------------------------------------------------------------------------------------------------
+// Name:	STAT_Clear
+// Function:  	Reset statistics to zero
+//		Events counted while the structure is cleared may be lost.
+//
+// Parameter: 	statistics structure (uint64_t only), its size
+// Return:    	-
+//--------------------------------------------------------------------------------------------------
+void STAT_Clear(void *stats,size_t size)
+{
+   uint64_t *d = stats;
+   size_t i;
+
+   for(i=0;i<size/sizeof(uint64_t);i++)
+   {
+      __atomic_store_n(&d[i],0,__ATOMIC_RELAXED);
+   }
+}
+
+//--------------------------------------------------------------------------------------------------
+// Name:	STAT_Percentile
+// Function:  	Percentile of a histogram (or of a copy of it)
+//		The result is the upper end of the bucket the percentile falls into, so it is
+//		at most twice the exact value, and never above the longest sample.
+//
+// Parameter: 	histogram, percentile in 1/1000 (500 = median, 990 = 99th percentile)
+// Return:    	duration in us, 0 if the histogram is empty
+//--------------------------------------------------------------------------------------------------
+uint64_t STAT_Percentile(const STAT_Hist *h,uint32_t permille)
+{
+   uint64_t count = 0;
+   uint64_t max = __atomic_load_n(&h->max_us,__ATOMIC_RELAXED);
+   uint64_t rank;
+   uint64_t n;
+   uint32_t k;
+
+   for(k=0;k<STAT_BUCKETS;k++)
+   {
+      count += __atomic_load_n(&h->bucket[k],__ATOMIC_RELAXED);
+   }
+   if(count == 0) return 0;
+
+   if(permille > 1000) permille = 1000;
+   rank = (count * permille + 999) / 1000;
+   if(rank == 0) rank = 1;
+
+   n = 0;
+   for(k=0;k<STAT_BUCKETS-1;k++)
+   {
+      n += __atomic_load_n(&h->bucket[k],__ATOMIC_RELAXED);
+      if(n >= rank) break;
+   }
+   if(k < STAT_BUCKETS-1 && ((uint64_t)1 << k) - 1 < max) return ((uint64_t)1 << k) - 1;
+   return max;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Name:	I2C_Count
+// Function:  	Count a transaction in the statistics of its bus, see I2C_Transfer()
+//
+// Parameter: 	bus statistics, I2C_ERR_xxx bits of the transaction, its duration in us
+// Return:    	-
+//--------------------------------------------------------------------------------------------------
+void I2C_Count(I2C_Stats *st,uint8_t error,uint64_t us)
+{
+   STAT_Record(&st->latency,us);
+   STAT_Inc(&st->transfers);
+   if(error & I2C_ERR_NACK) STAT_Inc(&st->nacks);
+   if(error & I2C_ERR_TIMEOUT) STAT_Inc(&st->timeouts);
+   if(error & I2C_ERR_BUS) STAT_Inc(&st->errors);
+}
@@ -0,0 +1,97 @@
+//--------------------------------------------------------------------------------------------------
+//
+// Filename:    stats.h
+// Description: Counters and latency histograms of the buses and sensors
+//              Updated with relaxed atomic operations on the hot path, no locks. A reader may
+//              take a copy at any time from any thread, it sees every counter at some value it
+//              had, not necessarily all of them at the same instant.
+//
+// Author:      agent
+// History:     17.10.2026 Initial version
+//--------------------------------------------------------------------------------------------------
+
+#ifndef STATS_H
+#define STATS_H
+
+//=== Includes =====================================================================================
+
+#include <stdint.h>
+#include <stddef.h>
+#include <time.h>
+
+//=== Preprocessing directives (#define) ===========================================================
+
+// Bucket 0 counts 0 us, bucket k (1..STAT_BUCKETS-1) counts 2^(k-1) to 2^k - 1 us, the last one
+// everything longer (about 1 s and up)
+#define STAT_BUCKETS	21
+
+//=== Type definitions (typedef) ===================================================================
+
+// Latency histogram on a log2 scale. Like all statistics structures it consists of uint64_t
+// only, see STAT_Copy().
+typedef struct
+{
+   uint64_t count;		// number of samples
+   uint64_t sum_us;		// sum of all samples
+   uint64_t max_us;		// longest sample
+   uint64_t bucket[STAT_BUCKETS];
+} STAT_Hist;
+
+//=== Global constants (extern) ====================================================================
+
+//=== Global variables (extern) ====================================================================
+
+//=== Global function prototypes ===================================================================
+
+void     STAT_Copy(void *dst,const void *src,size_t size);
+void     STAT_Clear(void *stats,size_t size);
+uint64_t STAT_Percentile(const STAT_Hist *h,uint32_t permille);
+
+//--------------------------------------------------------------------------------------------------
+// Name:	STAT_Now
+// Function:  	Time base of the statistics (CLOCK_MONOTONIC)
+//
+// Parameter: 	-
+// Return:    	time in us
+//--------------------------------------------------------------------------------------------------
+static inline uint64_t STAT_Now(void)
+{
+   struct timespec ts;
+
+   clock_gettime(CLOCK_MONOTONIC,&ts);
+   return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Name:	STAT_Inc
+// Function:  	Count an event
+//
+// Parameter: 	counter
+// Return:    	-
+//--------------------------------------------------------------------------------------------------
+static inline void STAT_Inc(uint64_t *counter)
+{
+   __atomic_fetch_add(counter,1,__ATOMIC_RELAXED);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Name:	STAT_Record
+// Function:  	Add a sample to a histogram
+//
+// Parameter: 	histogram, duration in us
+// Return:    	-
+//--------------------------------------------------------------------------------------------------
+static inline void STAT_Record(STAT_Hist *h,uint64_t us)
+{
+   uint64_t max = __atomic_load_n(&h->max_us,__ATOMIC_RELAXED);
+   uint32_t k = us ? 64 - __builtin_clzll(us) : 0;
+
+   if(k >= STAT_BUCKETS) k = STAT_BUCKETS - 1;
+   __atomic_fetch_add(&h->bucket[k],1,__ATOMIC_RELAXED);
+   __atomic_fetch_add(&h->sum_us,us,__ATOMIC_RELAXED);
+   __atomic_fetch_add(&h->count,1,__ATOMIC_RELAXED);
+   while(us > max &&
+         !__atomic_compare_exchange_n(&h->max_us,&max,us,1,__ATOMIC_RELAXED,__ATOMIC_RELAXED));
+}
+
+#endif
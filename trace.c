@@ -0,0 +1,207 @@
+//--------------------------------------------------------------------------------------------------
+//
+// Filename:    trace.c
+// Description: Trace of the bit-banged buses in a preallocated ring in memory
+//              Writers reserve event n with one atomic add and fill slot n % TRACE_SLOTS, the
+//              sequence number is cleared first and set to n+1 last. A reader keeps a copied
+//              slot only if it found the expected sequence number before and after copying, so
+//              it never has to stop the buses.
+//
+// Open Source Licensing
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// Author:      agent
+// History:     17.10.2026 Initial version
+//--------------------------------------------------------------------------------------------------
+
+//=== Includes =====================================================================================
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+#include "bcm2835.h"
+#include "trace.h"
+
+//=== Preprocessing directives (#define) ===========================================================
+
+#define TRACE_MAGIC	0x54544853	// "SHTT"
+
+//=== Type definitions (typedef) ===================================================================
+
+// Header of a saved trace, followed by the events
+typedef struct
+{
+   uint32_t magic;
+   uint32_t count;
+} TRACE_File;
+
+//=== Global constants =============================================================================
+
+//=== Global variables =============================================================================
+
+//=== Local constants  =============================================================================
+
+//=== Local variables ==============================================================================
+
+static TRACE_Event ring[TRACE_SLOTS];
+static uint64_t head;			// number of events ever recorded
+
+//=== Local function prototypes ====================================================================
+
+//--------------------------------------------------------------------------------------------------
+// Name:	TRACE_Now
+// Function:  	Timestamp of an event
+//		The free running system timer of the BCM2835 (1 MHz) is read without a system call.
+//		Where it is not mapped (/dev/gpiomem, simulation, other boards) CLOCK_MONOTONIC is
+//		used instead.
+//
+// Parameter: 	-
+// Return:    	time in us
+//--------------------------------------------------------------------------------------------------
+uint64_t TRACE_Now(void)
+{
+   struct timespec ts;
+   uint64_t t;
+
+   t = bcm2835_st_read();
+   if(t) return t;
+
+   clock_gettime(CLOCK_MONOTONIC,&ts);
+   return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Name:	TRACE_Record
+// Function:  	Add an event to the ring, overwriting the oldest one if it is full
+//
+// Parameter: 	clock pin of the bus, TRACE_xxx, byte, acknowledge (0 = ACK), time in us
+// Return:    	-
+//--------------------------------------------------------------------------------------------------
+void TRACE_Record(uint8_t bus,uint8_t type,uint8_t data,uint8_t ack,uint64_t time_us)
+{
+   uint64_t n = __atomic_fetch_add(&head,1,__ATOMIC_RELAXED);
+   TRACE_Event *e = &ring[n & (TRACE_SLOTS - 1)];
+
+   __atomic_store_n(&e->seq,0,__ATOMIC_RELAXED);
+   __atomic_thread_fence(__ATOMIC_RELEASE);
+   e->time_us = time_us;
+   e->bus = bus;
+   e->type = type;
+   e->data = data;
+   e->ack = ack;
+   __atomic_store_n(&e->seq,(uint32_t)(n + 1),__ATOMIC_RELEASE);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Name:	TRACE_Copy
+// Function:  	Copy the events in the ring, oldest first
+//		Events being written or overwritten while they are copied are left out.
+//
+// Parameter: 	destination, its size (in events)
+// Return:    	number of events copied
+//--------------------------------------------------------------------------------------------------
+uint32_t TRACE_Copy(TRACE_Event *ev,uint32_t max)
+{
+   uint64_t h = __atomic_load_n(&head,__ATOMIC_ACQUIRE);
+   uint64_t i = (h > max) ? h - max : 0;
+   uint32_t n = 0;
+   uint32_t seq;
+   TRACE_Event *e;
+
+   if(h - i > TRACE_SLOTS) i = h - TRACE_SLOTS;
+
+   for(;i<h;i++)
+   {
+      e = &ring[i & (TRACE_SLOTS - 1)];
+      seq = __atomic_load_n(&e->seq,__ATOMIC_ACQUIRE);
+      if(seq != (uint32_t)(i + 1)) continue;
+
+      ev[n] = *e;
+      __atomic_thread_fence(__ATOMIC_ACQUIRE);
+      if(__atomic_load_n(&e->seq,__ATOMIC_RELAXED) == seq) n++;
+   }
+   return n;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Name:	TRACE_Clear
+// Function:  	Drop all events recorded so far
+//
+// Parameter: 	-
+// Return:    	-
+//--------------------------------------------------------------------------------------------------
+void TRACE_Clear(void)
+{
+   uint32_t i;
+
+   for(i=0;i<TRACE_SLOTS;i++) __atomic_store_n(&ring[i].seq,0,__ATOMIC_RELAXED);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Name:	TRACE_Save
+// Function:  	Write the events in the ring to a file, see TRACE_Load()
+//
+// Parameter: 	file name
+// Return:    	0 = OK, 1 = error
+//--------------------------------------------------------------------------------------------------
+uint8_t TRACE_Save(const char *file)
+{
+   TRACE_File hdr = { TRACE_MAGIC, 0 };
+   TRACE_Event *ev;
+   FILE *f;
+   uint8_t error = 0;
+
+   ev = malloc(TRACE_SLOTS * sizeof(TRACE_Event));
+   if(ev == NULL) return 1;
+   hdr.count = TRACE_Copy(ev,TRACE_SLOTS);
+
+   f = fopen(file,"wb");
+   if(f == NULL)
+   {
+      free(ev);
+      return 1;
+   }
+   if(fwrite(&hdr,sizeof(hdr),1,f) != 1 ||
+      fwrite(ev,sizeof(TRACE_Event),hdr.count,f) != hdr.count) error = 1;
+   if(fclose(f) != 0) error = 1;
+
+   free(ev);
+   return error;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Name:	TRACE_Load
+// Function:  	Read events written by TRACE_Save()
+//
+// Parameter: 	file name, destination, its size (in events)
+// Return:    	number of events read, 0 if the file is not a trace
+//--------------------------------------------------------------------------------------------------
+uint32_t TRACE_Load(const char *file,TRACE_Event *ev,uint32_t max)
+{
+   TRACE_File hdr;
+   FILE *f;
+   uint32_t n = 0;
+
+   f = fopen(file,"rb");
+   if(f == NULL) return 0;
+
+   if(fread(&hdr,sizeof(hdr),1,f) == 1 && hdr.magic == TRACE_MAGIC)
+   {
+      n = fread(ev,sizeof(TRACE_Event),hdr.count < max ? hdr.count : max,f);
+   }
+   fclose(f);
+   return n;
+}
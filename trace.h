@@ -0,0 +1,59 @@
+//--------------------------------------------------------------------------------------------------
+//
+// Filename:    trace.h
+// Description: Trace of the bit-banged buses: bytes with their acknowledge, START, STOP and clock
+//              stretching, each with a timestamp, in a preallocated ring in memory
+//              Recording is compiled in with -DSHT_TRACE (make TRACE=1), otherwise the ring
+//              stays empty. Copy it with TRACE_Save() and look at it offline with
+//              example/shttrace (text or VCD).
+//
+// Author:      agent
+// History:     17.10.2026 Initial version
+//--------------------------------------------------------------------------------------------------
+
+#ifndef TRACE_H
+#define TRACE_H
+
+//=== Includes =====================================================================================
+
+#include <stdint.h>
+
+//=== Preprocessing directives (#define) ===========================================================
+
+#define TRACE_SLOTS	4096		// events kept, a power of two
+
+// Events
+#define TRACE_START	1		// START or repeated START
+#define TRACE_STOP	2		// STOP
+#define TRACE_WRITE	3		// byte sent by the master, ack from the device
+#define TRACE_READ	4		// byte read by the master, ack sent by it
+#define TRACE_STRETCH	5		// device holds the clock low
+#define TRACE_RELEASE	6		// ... and released it
+#define TRACE_TIMEOUT	7		// ... for too long
+
+//=== Type definitions (typedef) ===================================================================
+
+typedef struct
+{
+   uint64_t time_us;		// TRACE_Now()
+   uint32_t seq;		// number of the event + 1, written last
+   uint8_t bus;			// clock pin of the bus
+   uint8_t type;		// TRACE_xxx
+   uint8_t data;		// byte of TRACE_WRITE / TRACE_READ
+   uint8_t ack;			// 0 = ACK, 1 = NACK
+} TRACE_Event;
+
+//=== Global constants (extern) ====================================================================
+
+//=== Global variables (extern) ====================================================================
+
+//=== Global function prototypes ===================================================================
+
+uint64_t TRACE_Now(void);
+void     TRACE_Record(uint8_t bus,uint8_t type,uint8_t data,uint8_t ack,uint64_t time_us);
+uint32_t TRACE_Copy(TRACE_Event *ev,uint32_t max);
+void     TRACE_Clear(void);
+uint8_t  TRACE_Save(const char *file);
+uint32_t TRACE_Load(const char *file,TRACE_Event *ev,uint32_t max);
+
+#endif